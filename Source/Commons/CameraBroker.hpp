@@ -0,0 +1,186 @@
+#pragma once
+#include <JuceHeader.h> // for the camera device class
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "ParameterNaming.hpp"
+
+namespace HueShift {
+
+// reused frame images. An image is free again once nobody but the pool holds a reference to it (juce::Image is reference counted),
+// so consumers can keep the frame they're reading as long as they like without anything being copied for them.
+class FramePool {
+private:
+	std::vector<juce::Image> images{};
+	juce::Image overflow{}; // when every pooled image is taken, see Copy
+
+public:
+	// copies the pixels over, reusing destination if the size and format match
+	static void CopyPixels(const juce::Image& source, juce::Image& destination) {
+		if (!destination.isValid() || destination.getWidth() != source.getWidth() || destination.getHeight() != source.getHeight()
+			|| destination.getFormat() != source.getFormat())
+		{
+			destination = juce::Image(source.getFormat(), source.getWidth(), source.getHeight(), false);
+		}
+
+		const juce::Image::BitmapData from(source, juce::Image::BitmapData::readOnly);
+		const juce::Image::BitmapData to(destination, juce::Image::BitmapData::writeOnly);
+		if (from.pixelStride != to.pixelStride) { // different image types, doesn't happen with the devices we know
+			destination = source.createCopy();
+			return;
+		}
+
+		const auto bytesPerLine = static_cast<size_t>(from.width) * static_cast<size_t>(from.pixelStride);
+		for (int y = 0; y < from.height; y++) {
+			std::memcpy(to.getLinePointer(y), from.getLinePointer(y), bytesPerLine);
+		}
+	}
+
+	// a copy of source in an image nobody else holds. Only allocates while the consumers hold on to more frames than before,
+	// or when the size changes. Past CAMERA_FRAME_POOL_MAX images every frame gets a new one, something is holding on to frames.
+	const juce::Image& Copy(const juce::Image& source) {
+		for (auto& image : images) {
+			if (image.getReferenceCount() == 1) {
+				CopyPixels(source, image);
+				return image;
+			}
+		}
+
+		if (images.size() < CAMERA_FRAME_POOL_MAX) {
+			images.emplace_back();
+			CopyPixels(source, images.back());
+			return images.back();
+		}
+
+		overflow = source.createCopy();
+		return overflow;
+	}
+};
+
+class CameraBroker;
+
+// one opened device, shared by every feed (every plugin instance) that wants it. Each frame is copied once,
+// then every subscriber gets a reference to the same image.
+class SharedCamera : public CameraDevice::Listener {
+public:
+	class Receiver {
+	public:
+		virtual ~Receiver() = default;
+		// on the device's thread. frameId is unique in the process.
+		virtual void FrameReceived(const juce::Image& frame, uint64_t frameId) = 0;
+	};
+
+private:
+	std::atomic<uint64_t>& nextFrameId;
+	std::unique_ptr<CameraDevice> device;
+	const juce::String name;
+
+	std::mutex receiverGuard; // held while a frame is handed out, so an unsubscribed receiver never gets called again
+	std::vector<Receiver*> receivers{};
+	FramePool frames{}; // device thread only (under receiverGuard)
+
+public:
+	SharedCamera(CameraDevice* device, const juce::String& name, std::atomic<uint64_t>& nextFrameId)
+	: nextFrameId(nextFrameId), device(device), name(name)
+	{
+		this->device->addListener(this);
+	}
+
+	~SharedCamera() override {
+		device->removeListener(this); // waits for a frame that is being delivered
+	}
+
+	const juce::String& GetName() const {
+		return name;
+	}
+
+	void Subscribe(Receiver* receiver) {
+		const std::lock_guard<std::mutex> lock(receiverGuard);
+		receivers.push_back(receiver);
+	}
+
+	// after this returns the receiver isn't called anymore
+	void Unsubscribe(Receiver* receiver) {
+		const std::lock_guard<std::mutex> lock(receiverGuard);
+		receivers.erase(std::remove(receivers.begin(), receivers.end(), receiver), receivers.end());
+	}
+
+	// message thread only
+	Component* CreateViewer() {
+		return device->createViewerComponent();
+	}
+
+	void imageReceived(const juce::Image& image) override {
+		if (!image.isValid()) return;
+
+		// devices reuse their image for the next frame, so take one copy instead of a reference
+		const std::lock_guard<std::mutex> lock(receiverGuard);
+		if (receivers.empty()) return;
+
+		const auto& frame = frames.Copy(image);
+		const auto frameId = nextFrameId.fetch_add(1);
+		for (auto* receiver : receivers) receiver->FrameReceived(frame, frameId);
+	}
+};
+
+/*
+	Process wide (use it through a juce::SharedResourcePointer, like the NetworkReactor): opens every physical camera once,
+	no matter how many plugin instances want it. A camera stays open as long as somebody holds its SharedCamera.
+*/
+class CameraBroker {
+private:
+	std::mutex guard; // never held while a device opens
+	std::map<juce::String, std::weak_ptr<SharedCamera>> cameras{};
+	std::atomic<uint64_t> nextFrameId{1};
+
+	std::shared_ptr<SharedCamera> Find(const juce::String& name) {
+		for (auto camera = cameras.begin(); camera != cameras.end();) {
+			if (camera->second.expired()) camera = cameras.erase(camera);
+			else camera++;
+		}
+
+		auto found = cameras.find(name);
+		return found != cameras.end() ? found->second.lock() : nullptr;
+	}
+
+public:
+	// the open camera with that name, or opens it (index into CameraDevice::getAvailableDevices). nullptr if it can't be opened.
+	// Opening can take seconds, call it from a background thread.
+	std::shared_ptr<SharedCamera> Acquire(const juce::String& name, int index) {
+		{
+			const std::lock_guard<std::mutex> lock(guard);
+			if (auto camera = Find(name)) return camera;
+		}
+
+		auto* opened = CameraDevice::openDevice(
+			index,
+			0,      // min w
+			0,      // min h
+			8000,   // max w
+			8000,   // max h
+			true    // high quality mode
+		);
+		if (opened == nullptr) return nullptr;
+
+		const std::lock_guard<std::mutex> lock(guard);
+		if (auto camera = Find(name)) { // another instance was quicker
+			delete opened;
+			return camera;
+		}
+
+		auto camera = std::make_shared<SharedCamera>(opened, name, nextFrameId);
+		cameras[name] = camera;
+		return camera;
+	}
+
+	// for frames that don't come from a device
+	uint64_t NextFrameId() {
+		return nextFrameId.fetch_add(1);
+	}
+};
+
+}
@@ -0,0 +1,336 @@
+#pragma once
+#include <JuceHeader.h> // for the camera device class
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "CameraBroker.hpp"
+#include "ParameterNaming.hpp"
+#include "YuvFrame.hpp"
+
+namespace HueShift {
+
+/*
+	The camera, owned by the processor so frames keep coming in without an editor.
+
+	Listing and opening devices can take seconds, so both happen on the feed's own thread. The device list is cached,
+	and a newly opened device only takes over once it delivered its first frame, the old one keeps feeding the grid until then.
+
+	The devices themselves come from the process wide CameraBroker, so instances that pick the same camera share it.
+	Its frames are copied once into pooled images and every feed gets a reference: the newest one waits in latest,
+	the analysis holds the one it is reading. Nothing is allocated per frame unless the size or format changes.
+	JUCE's devices only deliver ARGB, a source that has the camera's own yuv planes hands them in through SubmitFrame
+	and the analysis reads them without converting.
+
+	A viewer component belongs to one device, so a replaced device stays alive until the viewer moved on (see CreateViewer).
+*/
+class CameraFeed : public juce::Thread {
+private:
+	// one device this feed uses
+	struct Source : public SharedCamera::Receiver {
+		CameraFeed& feed;
+		std::shared_ptr<SharedCamera> camera;
+		juce::String name;
+		int generation;
+		double openedSeconds;
+
+		Source(CameraFeed& feed, std::shared_ptr<SharedCamera> camera, const juce::String& name, int generation, double openedSeconds)
+		: feed(feed), camera(std::move(camera)), name(name), generation(generation), openedSeconds(openedSeconds)
+		{
+			this->camera->Subscribe(this);
+		}
+
+		~Source() override {
+			camera->Unsubscribe(this); // waits for a frame that is being delivered
+		}
+
+		void FrameReceived(const juce::Image& frame, uint64_t frameId) override {
+			feed.FrameReceived(generation, frame, frameId);
+		}
+	};
+
+	juce::SharedResourcePointer<CameraBroker> broker; // outlives the sources
+
+	// what the user asked for, any thread
+	std::mutex requestGuard;
+	juce::String selectedName{};
+	bool hasOpenRequest = false;
+	bool hasScanRequest = true;
+
+	// the devices, only changed by the feed's thread. Never held while a device opens.
+	mutable std::mutex deviceGuard;
+	std::unique_ptr<Source> active{}, pending{};
+	std::vector<std::unique_ptr<Source>> retired{};
+	int nextGeneration = 1;
+	int viewedGeneration = -1; // the device the viewer component was made for, -1 without a viewer
+
+	std::atomic<int> activeGeneration{0}, pendingGeneration{0}; // 0 is none
+
+	mutable std::mutex listGuard;
+	juce::StringArray devices{};
+	std::atomic<int> devicesVersion{0};
+
+	std::mutex frameGuard;
+	CameraFrame latest{};
+	uint64_t latestId = 0;
+	bool hasNewFrame = false;
+
+	// SubmitFrame's caller only
+	FramePool submittedFrames{};
+	YuvFramePool submittedYuvFrames{};
+
+	static double GetSeconds() {
+		return juce::Time::getMillisecondCounterHiRes() * 0.001;
+	}
+
+	// on the device's thread, frame is shared with the other feeds using the device
+	void FrameReceived(int generation, const juce::Image& frame, uint64_t frameId) {
+		if (generation != activeGeneration.load() && generation != pendingGeneration.load()) return; // replaced
+
+		bool tookOver = false;
+		{
+			const std::lock_guard<std::mutex> lock(frameGuard);
+			if (generation == pendingGeneration.load()) {
+				// first frame of the new device, from here on the old one is ignored
+				activeGeneration.store(generation);
+				pendingGeneration.store(0);
+				tookOver = true;
+			}
+			else if (generation != activeGeneration.load()) return;
+
+			latest.image = frame;
+			latest.yuv.reset();
+			latest.seconds = GetSeconds();
+			latestId = frameId;
+			hasNewFrame = true;
+		}
+
+		if (tookOver) notify(); // the feed's thread moves the old device out
+	}
+
+	void ScanDevices() {
+		auto found = CameraDevice::getAvailableDevices();
+
+		const std::lock_guard<std::mutex> lock(listGuard);
+		if (found == devices) return;
+		devices = found;
+		devicesVersion.fetch_add(1);
+	}
+
+	void OpenDevice(const juce::String& name) {
+		{
+			const std::lock_guard<std::mutex> lock(deviceGuard);
+			if (pending != nullptr && pending->name == name) return;
+			if (pending == nullptr && active != nullptr && active->name == name) return;
+		}
+
+		ScanDevices(); // the device might have just been plugged in
+		int index = -1;
+		{
+			const std::lock_guard<std::mutex> lock(listGuard);
+			index = devices.indexOf(name);
+		}
+		if (index < 0) {
+			std::cout << "Camera " << name << " not found\n";
+			return;
+		}
+
+		auto camera = broker->Acquire(name, index); // already open if another instance uses it
+		if (camera == nullptr) {
+			std::cout << "Camera could not be opened\n";
+			return;
+		}
+
+		const std::lock_guard<std::mutex> lock(deviceGuard);
+		if (pending != nullptr) retired.push_back(std::move(pending)); // never delivered anything, the newer one wins
+
+		pending = std::make_unique<Source>(*this, std::move(camera), name, nextGeneration++, GetSeconds());
+		pendingGeneration.store(pending->generation);
+		if (active == nullptr) Promote(); // nothing to keep running meanwhile
+	}
+
+	// the pending device becomes the active one. deviceGuard must be held.
+	void Promote() {
+		if (active != nullptr) retired.push_back(std::move(active));
+		active = std::move(pending);
+		activeGeneration.store(active->generation);
+		pendingGeneration.store(0);
+	}
+
+	// deviceGuard must be held
+	void UpdateDevices() {
+		if (pending != nullptr) {
+			const bool deliveredFrame = activeGeneration.load() == pending->generation;
+			if (deliveredFrame || GetSeconds() - pending->openedSeconds > CAMERA_FIRST_FRAME_TIMEOUT_SECONDS) Promote();
+		}
+
+		// a viewer component can't outlive its device
+		retired.erase(std::remove_if(retired.begin(), retired.end(), [this](const std::unique_ptr<Source>& source) {
+			return viewedGeneration < 0 || viewedGeneration > source->generation;
+		}), retired.end());
+	}
+
+public:
+	CameraFeed() : juce::Thread("HueShift Camera") {
+		startThread(juce::Thread::Priority::low);
+	}
+
+	~CameraFeed() override {
+		stopThread(10000); // might be stuck opening a device
+		Close();
+	}
+
+	// opens the device with that name in the background. The current one keeps running until the new one sends a frame,
+	// and stays if the new one can't be opened. Any thread.
+	void Open(const juce::String& name) {
+		{
+			const std::lock_guard<std::mutex> lock(requestGuard);
+			selectedName = name;
+			hasOpenRequest = true;
+		}
+		notify();
+	}
+
+	// closes every device right away. Only when nobody is viewing and the feed's thread is stopped, like on shutdown.
+	void Close() {
+		const std::lock_guard<std::mutex> lock(deviceGuard);
+		activeGeneration.store(0);
+		pendingGeneration.store(0);
+		active.reset();
+		pending.reset();
+		retired.clear();
+	}
+
+	// lists the devices again in the background, GetDevicesVersion changes if the list did
+	void RefreshDevices() {
+		{
+			const std::lock_guard<std::mutex> lock(requestGuard);
+			hasScanRequest = true;
+		}
+		notify();
+	}
+
+	// the cached device list, never waits for the OS
+	juce::StringArray GetDevices() const {
+		const std::lock_guard<std::mutex> lock(listGuard);
+		return devices;
+	}
+
+	int GetDevicesVersion() const {
+		return devicesVersion.load();
+	}
+
+	// what the user picked last, even if it isn't open yet. This is what gets saved.
+	juce::String GetSelectedName() {
+		const std::lock_guard<std::mutex> lock(requestGuard);
+		return selectedName;
+	}
+
+	// changes every time another device takes over, 0 without a device
+	int GetGeneration() const {
+		return activeGeneration.load();
+	}
+
+	// a viewer component for the current device, nullptr without one. generation is set to the device's generation,
+	// compare it with GetGeneration to know when to ask again. The device stays alive until the viewer
+	// asks for a new one or calls ViewerDeleted, so delete the old component first. Message thread only.
+	Component* CreateViewer(int& generation) {
+		const std::lock_guard<std::mutex> lock(deviceGuard);
+		generation = active != nullptr ? active->generation : 0;
+		viewedGeneration = active != nullptr ? active->generation : -1;
+		return active != nullptr ? active->camera->CreateViewer() : nullptr;
+	}
+
+	// after the viewer component was deleted
+	void ViewerDeleted() {
+		{
+			const std::lock_guard<std::mutex> lock(deviceGuard);
+			viewedGeneration = -1;
+		}
+		notify();
+	}
+
+	// a frame that doesn't come from a device (a test pattern, the soak test). It's handled like the newest device frame,
+	// until the device sends its next one. Only call from one thread at a time.
+	void SubmitFrame(const juce::Image& image) {
+		if (!image.isValid()) return;
+		const auto& frame = submittedFrames.Copy(image);
+		const auto frameId = broker->NextFrameId();
+
+		const std::lock_guard<std::mutex> lock(frameGuard);
+		latest.image = frame;
+		latest.yuv.reset();
+		latest.seconds = GetSeconds();
+		latestId = frameId;
+		hasNewFrame = true;
+	}
+
+	// the same for a source that has the planes in the camera's own format, they get analysed as they are
+	void SubmitFrame(const YuvFrameView& view) {
+		if (!view.IsValid()) return;
+		auto frame = submittedYuvFrames.Copy(view);
+		const auto frameId = broker->NextFrameId();
+
+		const std::lock_guard<std::mutex> lock(frameGuard);
+		latest.image = juce::Image();
+		latest.yuv = std::move(frame);
+		latest.seconds = GetSeconds();
+		latestId = frameId;
+		hasNewFrame = true;
+	}
+
+	// puts the newest frame into current, returns false (and leaves current alone) if there wasn't a new one.
+	// frameId is unique in the process, instances using the same camera see the same ids for the same frames.
+	// Drop the reference to the old frame (by calling this again) so its image can be reused. Only call from one thread.
+	bool TakeLatestFrame(CameraFrame& current, uint64_t& frameId) {
+		const std::lock_guard<std::mutex> lock(frameGuard);
+		if (!hasNewFrame) return false;
+
+		current = std::move(latest);
+		frameId = latestId;
+		latest = CameraFrame{};
+		hasNewFrame = false;
+		return true;
+	}
+
+	void run() override {
+		double lastScanSeconds = 0.0;
+
+		while (!threadShouldExit()) {
+			juce::String nameToOpen{};
+			bool shouldOpen = false, shouldScan = false;
+			{
+				const std::lock_guard<std::mutex> lock(requestGuard);
+				std::swap(shouldOpen, hasOpenRequest);
+				std::swap(shouldScan, hasScanRequest);
+				nameToOpen = selectedName;
+			}
+
+			// keep the list fresh while somebody might look at it
+			bool isViewed = false;
+			{
+				const std::lock_guard<std::mutex> lock(deviceGuard);
+				isViewed = viewedGeneration >= 0;
+			}
+			if (isViewed && GetSeconds() - lastScanSeconds > CAMERA_SCAN_SECONDS) shouldScan = true;
+
+			if (shouldScan) {
+				ScanDevices();
+				lastScanSeconds = GetSeconds();
+			}
+			if (shouldOpen && !nameToOpen.isEmpty()) OpenDevice(nameToOpen);
+
+			{
+				const std::lock_guard<std::mutex> lock(deviceGuard);
+				UpdateDevices();
+			}
+
+			wait(250.0);
+		}
+	}
+};
+
+}
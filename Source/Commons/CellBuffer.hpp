@@ -0,0 +1,73 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include "ParameterNaming.hpp"
+
+namespace HueShift {
+
+// what the analysis found out about one grid cell (or region)
+struct Cell {
+	juce::uint32 argb = 0xff000000;
+	float confidence = 0.f; // [0:1], see GridAnalyser. 0 for a cell that only got a preview (see CellDemand)
+	float motion = 0.f; // [0:1], how much the cell's brightness changed since the last frame
+
+	juce::Colour GetColour() const { return juce::Colour(argb); }
+	void SetColour(juce::Colour colour) { argb = colour.getARGB(); }
+};
+
+// the whole grid in one fixed size block, row major (left up to right down, the same order as the voices).
+// It never allocates, so the analysis can fill it every frame and the audio thread can copy it every block.
+struct CellBuffer {
+	juce::uint32 width = 0;
+	juce::uint32 height = 0;
+	juce::uint64 frameIndex = 0; // counts analysed frames, 0 means nothing was analysed yet
+	double timeSeconds = 0.0; // when the camera frame came in (Time::getMillisecondCounterHiRes in seconds), 0 if unknown
+	std::array<Cell, MAX_VOICES> cells{};
+
+	// clamps to MAX_VOICES cells by dropping rows, resets every cell.
+	void Resize(juce::uint32 newWidth, juce::uint32 newHeight) {
+		width = std::min(newWidth, juce::uint32(MAX_VOICES));
+		height = width == 0 ? 0 : std::min(newHeight, juce::uint32(MAX_VOICES) / width);
+		for (size_t i = 0; i < size(); i++) cells[i] = Cell{};
+	}
+
+	size_t size() const {
+		return static_cast<size_t>(width) * height;
+	}
+
+	Cell& at(size_t row, size_t column) { return cells[row * width + column]; }
+	const Cell& at(size_t row, size_t column) const { return cells[row * width + column]; }
+
+	Cell& operator[](size_t index) { return cells[index]; }
+	const Cell& operator[](size_t index) const { return cells[index]; }
+};
+
+// which cells the analysis has to get right this frame, indexed like the cells. The others only get a cheap preview,
+// a mean of a few samples, so the viewers and the network still see roughly what is there.
+struct CellDemand {
+	std::bitset<MAX_VOICES> full{};
+
+	static CellDemand All() {
+		CellDemand demand{};
+		demand.full.set();
+		return demand;
+	}
+
+	// true if every cell other needs in full is in full here as well
+	bool Covers(const CellDemand& other, size_t amountOfCells) const {
+		for (size_t i = 0; i < amountOfCells && i < MAX_VOICES; i++) {
+			if (other.full[i] && !full[i]) return false;
+		}
+		return true;
+	}
+
+	size_t CountFull(size_t amountOfCells) const {
+		size_t amount = 0;
+		for (size_t i = 0; i < amountOfCells && i < MAX_VOICES; i++) amount += full[i] ? 1 : 0;
+		return amount;
+	}
+};
+
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include "juce_core/juce_core.h"
 #include "juce_graphics/juce_graphics.h"
+#include <array>
 #include <vector>
 
 #ifndef C1
@@ -24,8 +25,8 @@ public:
 	static ColorInfo GetClosestColor(juce::Colour c){
 		auto hue = c.getHue(); // [0:1]
 
-		auto colors = GetColors();
-		for (auto& color : colors) {
+		const auto& colors = GetColors();
+		for (const auto& color : colors) {
 			if (color.hue.contains(hue)) return color;
 		}
 
@@ -33,8 +34,22 @@ public:
 		return red;
 	}
 
-	static std::vector<ColorInfo> GetColors() {
-		return std::vector<ColorInfo>({red, orange, yellow, green, cyan, blue, violet, pink});
+	// index into GetColors() for a hue in [0:1], same lookup as GetClosestColor.
+	static size_t GetBandIndex(float hue) {
+		const auto& colors = GetColors();
+		for (size_t i = 0; i < colors.size(); i++) {
+			if (colors[i].hue.contains(hue)) return i;
+		}
+		return 0; // red
+	}
+
+	float GetCentreHue() const {
+		return (hue.getStart() + hue.getEnd()) * 0.5f;
+	}
+
+	// ordered by hue, doesn't allocate so it's fine on the audio thread.
+	static const std::array<ColorInfo, 8>& GetColors() {
+		return colors;
 	}
 
 	static const ColorInfo red;
@@ -45,6 +60,9 @@ public:
 	static const ColorInfo blue;
 	static const ColorInfo violet;
 	static const ColorInfo pink;
+
+private:
+	static const std::array<ColorInfo, 8> colors;
 };
 
 inline const ColorInfo ColorInfo::red 		= 	ColorInfo(4.5f, 			juce::Range<float>(0.000f, 0.042f));
@@ -55,4 +73,6 @@ inline const ColorInfo ColorInfo::cyan 		= 	ColorInfo(6.0f, 			juce::Range<float
 inline const ColorInfo ColorInfo::blue 		= 	ColorInfo(6.666666666f, 	juce::Range<float>(0.494f, 0.694f));
 inline const ColorInfo ColorInfo::violet 	= 	ColorInfo(7.5f, 			juce::Range<float>(0.694f, 0.806f));
 inline const ColorInfo ColorInfo::pink 		= 	ColorInfo(8.333333333f, 	juce::Range<float>(0.806f, 0.944f));
+
+inline const std::array<ColorInfo, 8> ColorInfo::colors = {red, orange, yellow, green, cyan, blue, violet, pink};
 }
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+#include <array>
+#include <cstddef>
+
+namespace HueShift {
+
+// vector-like list with a fixed capacity that lives inline, so filling it never allocates.
+// push_back drops the value and returns false once it's full.
+template <typename T, size_t Capacity>
+class FixedList {
+private:
+	std::array<T, Capacity> items{};
+	size_t amount = 0;
+
+public:
+	bool push_back(const T& value) {
+		if (amount >= Capacity) return false;
+		items[amount++] = value;
+		return true;
+	}
+
+	void clear() {
+		amount = 0;
+	}
+
+	// keeps the order of the rest
+	void erase(size_t index) {
+		if (index >= amount) return;
+		for (size_t i = index; i + 1 < amount; i++) items[i] = items[i + 1];
+		amount--;
+	}
+
+	size_t size() const { return amount; }
+	bool empty() const { return amount == 0; }
+	static constexpr size_t capacity() { return Capacity; }
+
+	T& operator[](size_t index) { return items[index]; }
+	const T& operator[](size_t index) const { return items[index]; }
+
+	T* begin() { return items.data(); }
+	T* end() { return items.data() + amount; }
+	const T* begin() const { return items.data(); }
+	const T* end() const { return items.data() + amount; }
+};
+
+}
@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    Layout of the HueShift shared memory feed, plain C so any tool can read it.
+    The plugin creates it (POSIX shm) when built with HUESHIFT_SHM_FEED, the first
+    instance is called "/hueshift-1", the next "/hueshift-2" and so on.
+
+    Reading without locks:
+      frames and voices
+        1. count = frameWriteCount (acquire). 0 means nothing was published yet.
+        2. slot = frames[(count - 1) % HUESHIFT_FEED_SLOTS]
+        3. s1 = slot.sequence (acquire), skip if odd
+        4. copy the slot, then s2 = slot.sequence (acquire)
+        5. the copy is good if s1 == s2, otherwise start over
+      pulses
+        keep your own cursor i. Pulse i is published once pulseWriteCount > i and sits in
+        pulses[i % HUESHIFT_FEED_PULSE_CAPACITY] while pulseWriteCount - i < HUESHIFT_FEED_PULSE_CAPACITY.
+        Copy it, then load pulseWriteCount again (acquire fence first): if the condition doesn't
+        hold anymore the writer lapped you, the copy may be torn and the pulse is lost.
+
+    The writer never waits for readers, a slow reader just misses data.
+    A writer that crashed leaves its block behind, check that writerPid is still alive.
+    hueshift_feed_reader.c in Tools/FeedReader is a small example.
+
+  ==============================================================================
+*/
+
+#ifndef HUESHIFT_FEED_H
+#define HUESHIFT_FEED_H
+
+#include <stdint.h>
+
+#define HUESHIFT_FEED_MAGIC 0x44465348u /* "HSFD" little endian */
+#define HUESHIFT_FEED_VERSION 1u
+#define HUESHIFT_FEED_NAME_PREFIX "/hueshift-"
+#define HUESHIFT_FEED_MAX_CELLS 128 /* same as MAX_VOICES */
+#define HUESHIFT_FEED_SLOTS 4
+#define HUESHIFT_FEED_PULSE_CAPACITY 1024
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t argb;
+    float confidence;
+} hueshift_feed_cell;
+
+/* one analysed camera frame, written once per frame */
+typedef struct {
+    uint32_t sequence; /* odd while being written */
+    uint32_t width;
+    uint32_t height;
+    uint32_t reserved;
+    uint64_t frameIndex;
+    hueshift_feed_cell cells[HUESHIFT_FEED_MAX_CELLS]; /* row major, width * height used */
+} hueshift_feed_frame;
+
+/* voice state after an audio block, written once per block */
+typedef struct {
+    uint32_t sequence; /* odd while being written */
+    uint32_t numVoices;
+    uint64_t blockIndex;
+    uint64_t sampleTime; /* samples since the plugin was prepared, at the end of the block */
+    uint8_t enabled[HUESHIFT_FEED_MAX_CELLS / 8]; /* bit (i % 8) of byte (i / 8) */
+    uint8_t frozen[HUESHIFT_FEED_MAX_CELLS / 8];
+    uint8_t octaveIndexes[HUESHIFT_FEED_MAX_CELLS];
+    float frequencies[HUESHIFT_FEED_MAX_CELLS];
+} hueshift_feed_voices;
+
+/* a note the plugin sent */
+typedef struct {
+    uint64_t sampleTime;
+    uint16_t voice;
+    uint8_t isNoteOn;
+    uint8_t reserved[5];
+} hueshift_feed_pulse;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size; /* sizeof(hueshift_feed) of the writer */
+    uint32_t writerPid;
+
+    uint64_t frameWriteCount;
+    uint64_t voiceWriteCount;
+    uint64_t pulseWriteCount;
+
+    hueshift_feed_frame frames[HUESHIFT_FEED_SLOTS];
+    hueshift_feed_voices voices[HUESHIFT_FEED_SLOTS];
+    hueshift_feed_pulse pulses[HUESHIFT_FEED_PULSE_CAPACITY];
+} hueshift_feed;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HUESHIFT_FEED_H */
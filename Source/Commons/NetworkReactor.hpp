@@ -0,0 +1,649 @@
+#pragma once
+
+#include "JuceHeader.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "FixedList.hpp"
+#include "OscCodec.hpp"
+#include "ParameterNaming.hpp"
+#include "SpscQueue.hpp"
+#include "../DSP/MidiHandler.hpp"
+
+#if JUCE_LINUX
+#include <sys/epoll.h>
+#include <unistd.h>
+#elif JUCE_WINDOWS
+#include <winsock2.h>
+#else
+#include <poll.h>
+#endif
+
+namespace HueShift {
+
+// everything one wakeup of the reactor collected for one instance, already coalesced. Goes to the audio thread in one piece.
+struct CommandBatch {
+	FixedList<VoiceCommand, NETWORK_BATCH_SIZE> commands{};
+};
+
+using CommandQueue = SpscQueue<CommandBatch, NETWORK_QUEUE_SIZE>;
+static_assert(NETWORK_BATCH_SIZE * NETWORK_BATCHES_PER_BLOCK <= VOICE_COMMANDS_PER_BLOCK, "the audio thread has to fit the batches it drains per block");
+
+
+// waits on a few sockets at once. epoll on linux, poll everywhere else.
+class SocketPoller {
+private:
+#if JUCE_LINUX
+	int epollHandle = -1;
+#elif JUCE_WINDOWS
+	std::vector<WSAPOLLFD> handles{};
+	std::vector<int> tags{};
+#else
+	std::vector<pollfd> handles{};
+	std::vector<int> tags{};
+#endif
+
+public:
+	SocketPoller() {
+#if JUCE_LINUX
+		epollHandle = epoll_create1(EPOLL_CLOEXEC);
+#endif
+	}
+
+	~SocketPoller() {
+#if JUCE_LINUX
+		if (epollHandle >= 0) close(epollHandle);
+#endif
+	}
+
+	SocketPoller(const SocketPoller&) = delete;
+	SocketPoller& operator=(const SocketPoller&) = delete;
+
+	// tag comes back from Wait when the socket has something to read
+	void Add(int socketHandle, int tag) {
+		if (socketHandle < 0) return;
+#if JUCE_LINUX
+		epoll_event event{};
+		event.events = EPOLLIN;
+		event.data.u32 = static_cast<uint32_t>(tag);
+		epoll_ctl(epollHandle, EPOLL_CTL_ADD, socketHandle, &event);
+#elif JUCE_WINDOWS
+		WSAPOLLFD handle{};
+		handle.fd = static_cast<SOCKET>(socketHandle);
+		handle.events = POLLRDNORM;
+		handles.push_back(handle);
+		tags.push_back(tag);
+#else
+		handles.push_back({socketHandle, POLLIN, 0});
+		tags.push_back(tag);
+#endif
+	}
+
+	// blocks up to timeoutMs, then calls onReadable(tag) for every socket that can be read.
+	template <typename Callback>
+	void Wait(int timeoutMs, Callback&& onReadable) {
+#if JUCE_LINUX
+		std::array<epoll_event, 8> events{};
+		const int amount = epoll_wait(epollHandle, events.data(), static_cast<int>(events.size()), timeoutMs);
+		for (int i = 0; i < amount; i++) onReadable(static_cast<int>(events[i].data.u32));
+#else
+		if (handles.empty()) {
+			juce::Thread::sleep(timeoutMs);
+			return;
+		}
+	#if JUCE_WINDOWS
+		const int amount = WSAPoll(handles.data(), static_cast<ULONG>(handles.size()), timeoutMs);
+	#else
+		const int amount = poll(handles.data(), static_cast<nfds_t>(handles.size()), timeoutMs);
+	#endif
+		if (amount <= 0) return;
+		for (size_t i = 0; i < handles.size(); i++) {
+			if (handles[i].revents != 0) onReadable(tags[i]);
+			handles[i].revents = 0;
+		}
+#endif
+	}
+};
+
+
+// ==============================================================================
+
+
+// one per process, shared by every plugin instance through juce::SharedResourcePointer.
+// A single thread owns all the sockets (custom protocol, discovery and OSC) and sleeps in the poller until a packet comes in.
+// Commands are routed by instance id into each instance's lock-free queue, which its audio thread drains every block.
+class NetworkReactor :
+	public juce::Thread
+{
+private:
+	enum SocketTag {
+		hardwareTag,
+		discoveryTag,
+		oscTag
+	};
+
+	juce::DatagramSocket hardwareSocket{false};
+	juce::DatagramSocket discoverySocket{false};
+	juce::DatagramSocket oscSocket{false};
+	juce::DatagramSocket responseSocket{true}; // broadcasts the discovery reply
+	bool discoveryBound = false;
+	bool oscBound = false;
+	std::atomic<int> hardwarePort{-1};
+	std::atomic<int> oscPort{-1};
+
+	SocketPoller poller;
+	std::array<char, OSC_MAX_PACKET_BYTES> readBuffer{};
+
+	// a controller that gets the voice state fed back
+	struct Subscriber {
+		juce::String address{};
+		int port = 0;
+		double lastSeenSeconds = 0.0;
+		bool needsFullState = true; // gets the full state next feedback round instead of a delta
+	};
+
+	// one sender (ip and port), shared by every instance it talks to
+	struct Session {
+		juce::String address{};
+		int port = 0;
+		int id = 0;
+		double lastSeenSeconds = 0.0;
+		uint32_t highestSequence = 0;
+		uint64_t seenSequences = 0; // bit n: highestSequence - n arrived
+		bool hasSequence = false;
+	};
+
+	struct PendingCommand {
+		VoiceCommand command{};
+		int sessionId = 0;
+	};
+
+	struct Instance {
+		CommandQueue* commands = nullptr;
+		const MidiHandler* voices = nullptr;
+		FixedList<PendingCommand, NETWORK_BATCH_SIZE> pending{}; // this wakeup's commands, reactor thread only
+
+		// feedback, reactor thread only
+		std::vector<Subscriber> subscribers{};
+		VoiceStateSnapshot sentState{};
+		bool hasSentState = false;
+		uint16_t sequence = 0;
+		double lastPacketSeconds = 0.0;
+	};
+
+	std::mutex instancesGuard; // the reactor and (un)registering instances, never the audio thread
+	std::map<int, Instance> instances{};
+
+	std::vector<Session> sessions{}; // reactor thread only
+	int nextSessionId = 1;
+
+	std::array<uint8_t, FEEDBACK_HEADER_BYTES + 2 * MAX_VOICES> feedbackPacket{};
+	double lastFeedbackSeconds = 0.0;
+
+	// id 0 means the lowest instance. Call with instancesGuard held.
+	Instance* FindInstance(int instanceId) {
+		if (instances.empty()) return nullptr;
+
+		auto instance = instanceId == 0 ? instances.begin() : instances.find(instanceId);
+		return instance == instances.end() ? nullptr : &instance->second;
+	}
+
+	Session& GetSession(const juce::String& address, int port, double now) {
+		for (auto& session : sessions) {
+			if (session.port == port && session.address == address) {
+				session.lastSeenSeconds = now;
+				return session;
+			}
+		}
+
+		if (sessions.size() >= MAX_SESSIONS) {
+			auto oldest = std::min_element(sessions.begin(), sessions.end(), [](const Session& a, const Session& b) { return a.lastSeenSeconds < b.lastSeenSeconds; });
+			sessions.erase(oldest);
+		}
+
+		Session session{};
+		session.address = address;
+		session.port = port;
+		session.id = nextSessionId++;
+		session.lastSeenSeconds = now;
+		sessions.push_back(session);
+		return sessions.back();
+	}
+
+	/*
+		false if the sender already sent this sequence (a resent or doubled packet). Serial number arithmetic (RFC 1982), so the
+		count may wrap around. Late packets within NETWORK_SEQUENCE_WINDOW of the newest one are still taken, once.
+		0 starts the count over once it is further back than the window, inside it a 0 is just a sequence (a resend, or the wrap).
+	*/
+	static bool AcceptSequence(Session& session, uint32_t sequence) {
+		static_assert(NETWORK_SEQUENCE_WINDOW <= 64, "the window is one bit per sequence in a uint64_t");
+		const auto distance = static_cast<int32_t>(sequence - session.highestSequence); // > 0 is newer
+
+		const bool restarts = sequence == 0 && distance <= -NETWORK_SEQUENCE_WINDOW;
+		if (!session.hasSequence || restarts) {
+			session.highestSequence = sequence;
+			session.seenSequences = 1;
+			session.hasSequence = true;
+			return true;
+		}
+
+		if (distance > 0) {
+			session.seenSequences = distance >= NETWORK_SEQUENCE_WINDOW ? 1 : (session.seenSequences << distance) | 1u;
+			session.highestSequence = sequence;
+			return true;
+		}
+		if (distance <= -NETWORK_SEQUENCE_WINDOW) return false; // too old to tell, better lost than applied twice
+
+		const auto bit = uint64_t{1} << -distance;
+		if (session.seenSequences & bit) return false;
+		session.seenSequences |= bit;
+		return true;
+	}
+
+	enum class Field { freeze, octave, select, other };
+
+	static Field GetField(VoiceCommand::Type type) {
+		switch (type) {
+			case VoiceCommand::Type::toggleFreeze: case VoiceCommand::Type::setFreeze: return Field::freeze;
+			case VoiceCommand::Type::toggleOctave: case VoiceCommand::Type::setOctave: return Field::octave;
+			case VoiceCommand::Type::toggleSelect: case VoiceCommand::Type::setSelect: return Field::select;
+			default: return Field::other;
+		}
+	}
+
+	static bool IsSet(VoiceCommand::Type type) {
+		return type == VoiceCommand::Type::setFreeze || type == VoiceCommand::Type::setOctave || type == VoiceCommand::Type::setSelect;
+	}
+
+	// hands the instance's pending commands to its audio thread as one batch. Call with instancesGuard held.
+	static void Flush(Instance& instance) {
+		if (instance.pending.empty()) return;
+
+		CommandBatch batch{};
+		for (const auto& pending : instance.pending) batch.commands.push_back(pending.command);
+		instance.commands->Push(batch); // a full queue drops it, the audio thread is hopelessly behind then
+		instance.pending.clear();
+	}
+
+	// adds a command to this wakeup's batch, merging it with what's already there:
+	// a set replaces earlier commands for the same voice and field, the same toggle from another sender counts once
+	// and a toggle the same sender already sent this wakeup cancels out.
+	static void AddCommand(Instance& instance, const VoiceCommand& command, int sessionId) {
+		const auto field = GetField(command.type);
+		auto& pending = instance.pending;
+
+		if (field != Field::other) {
+			for (size_t i = pending.size(); i-- > 0;) {
+				const auto& earlier = pending[i];
+				if (earlier.command.index != command.index || GetField(earlier.command.type) != field) continue;
+
+				if (IsSet(command.type)) {
+					pending.erase(i);
+					continue;
+				}
+				if (IsSet(earlier.command.type)) break; // toggling after a set is a real change
+
+				if (earlier.sessionId == sessionId) pending.erase(i);
+				return;
+			}
+		}
+
+		if (pending.size() >= pending.capacity()) Flush(instance);
+		pending.push_back({command, sessionId});
+	}
+
+	// the sender of a command gets feedback from then on, starting with the full state
+	static Subscriber& Subscribe(Instance& instance, const juce::String& address, int port, double now) {
+		for (auto& subscriber : instance.subscribers) {
+			if (subscriber.port == port && subscriber.address == address) {
+				subscriber.lastSeenSeconds = now;
+				return subscriber;
+			}
+		}
+
+		if (instance.subscribers.size() >= FEEDBACK_MAX_SUBSCRIBERS) {
+			// make room by dropping whoever was quiet the longest
+			auto oldest = instance.subscribers.begin();
+			for (auto it = instance.subscribers.begin(); it != instance.subscribers.end(); ++it)
+				if (it->lastSeenSeconds < oldest->lastSeenSeconds) oldest = it;
+			instance.subscribers.erase(oldest);
+		}
+
+		instance.subscribers.push_back({address, port, now, true});
+		return instance.subscribers.back();
+	}
+
+	static uint8_t GetVoiceByte(const VoiceStateSnapshot& state, size_t index) {
+		return static_cast<uint8_t>((state.enabled[index] ? 1 : 0) | (state.frozen[index] ? 2 : 0) | ((state.octaveIndexes[index] & 7) << 2));
+	}
+
+	// fills feedbackPacket, returns its size. A full packet lists every voice, otherwise only the ones that differ from sentState.
+	size_t WriteFeedbackPacket(int instanceId, const Instance& instance, const VoiceStateSnapshot& state, bool full) {
+		const auto numVoices = std::min(state.numVoices, size_t(MAX_VOICES));
+		size_t size = FEEDBACK_HEADER_BYTES;
+
+		for (size_t i = 0; i < numVoices; i++) {
+			const auto voiceByte = GetVoiceByte(state, i);
+			if (!full && voiceByte == GetVoiceByte(instance.sentState, i)) continue;
+			feedbackPacket[size++] = static_cast<uint8_t>(i);
+			feedbackPacket[size++] = voiceByte;
+		}
+
+		feedbackPacket[0] = 'H';
+		feedbackPacket[1] = 'S';
+		feedbackPacket[2] = 'D';
+		feedbackPacket[3] = FEEDBACK_VERSION;
+		feedbackPacket[4] = static_cast<uint8_t>(instanceId);
+		feedbackPacket[5] = full ? 1 : 0;
+		feedbackPacket[6] = static_cast<uint8_t>(instance.sequence >> 8);
+		feedbackPacket[7] = static_cast<uint8_t>(instance.sequence);
+		feedbackPacket[8] = static_cast<uint8_t>(numVoices);
+		feedbackPacket[9] = static_cast<uint8_t>((size - FEEDBACK_HEADER_BYTES) / 2);
+		return size;
+	}
+
+	void SendFeedbackPacket(const Subscriber& subscriber, size_t size) {
+		hardwareSocket.write(subscriber.address, subscriber.port, feedbackPacket.data(), static_cast<int>(size));
+	}
+
+	// collects what changed over the last audio blocks into one packet per instance. Call with instancesGuard held.
+	void SendFeedback(double now) {
+		for (auto& [instanceId, instance] : instances) {
+			auto& subscribers = instance.subscribers;
+			subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(), [&](const Subscriber& subscriber) {
+				return now - subscriber.lastSeenSeconds > SESSION_TIMEOUT_SECONDS;
+			}), subscribers.end());
+
+			if (subscribers.empty() || instance.voices == nullptr) continue;
+
+			const auto state = instance.voices->GetVoiceState();
+			const bool full = !instance.hasSentState || state.numVoices != instance.sentState.numVoices; // after a reset the indexes mean something else
+			const bool anyResync = std::any_of(subscribers.begin(), subscribers.end(), [](const Subscriber& subscriber) { return subscriber.needsFullState; });
+
+			instance.sequence++;
+			auto size = WriteFeedbackPacket(instanceId, instance, state, full);
+			const bool isHeartbeat = !full && size == FEEDBACK_HEADER_BYTES; // a full packet with no voices (0 after a reset) still has to go out
+
+			// a resync moves sentState too, so everybody's deltas stay relative to the same state
+			if (isHeartbeat && !anyResync && now - instance.lastPacketSeconds < FEEDBACK_HEARTBEAT_SECONDS) {
+				instance.sequence--; // nothing to say
+				continue;
+			}
+
+			for (const auto& subscriber : subscribers)
+				if (!subscriber.needsFullState) SendFeedbackPacket(subscriber, size);
+
+			if (anyResync) {
+				size = WriteFeedbackPacket(instanceId, instance, state, true);
+				for (auto& subscriber : subscribers) {
+					if (!subscriber.needsFullState) continue;
+					SendFeedbackPacket(subscriber, size);
+					subscriber.needsFullState = false;
+				}
+			}
+
+			instance.sentState = state;
+			instance.hasSentState = true;
+			instance.lastPacketSeconds = now;
+		}
+	}
+
+	static bool ToCommandType(char letter, VoiceCommand::Type& type) {
+		switch (letter) {
+			case 'f': type = VoiceCommand::Type::toggleFreeze; return true;
+			case 'o': type = VoiceCommand::Type::toggleOctave; return true;
+			case 's': type = VoiceCommand::Type::toggleSelect; return true;
+			case 'F': type = VoiceCommand::Type::setFreeze; return true;
+			case 'O': type = VoiceCommand::Type::setOctave; return true;
+			case 'S': type = VoiceCommand::Type::setSelect; return true;
+			case 'c': type = VoiceCommand::Type::cameraHz; return true;
+			default: return false;
+		}
+	}
+
+	// reads digits from position up to end, -1 if there are none or too many
+	// up to 10 digits, so a whole uint32_t sequence fits
+	static int64_t ReadNumber(const char* data, size_t& position, size_t end) {
+		int64_t number = 0;
+		int digits = 0;
+		while (position < end && data[position] >= '0' && data[position] <= '9') {
+			if (++digits > 10) return -1;
+			number = number * 10 + (data[position++] - '0');
+		}
+		return digits == 0 ? -1 : number;
+	}
+
+	// [q-<sequence>;] then <letter>[#<id>]-<number>[=<value>]; as often as it fits, anything that doesn't parse is skipped up to the next postfix.
+	// The sender gets subscribed to the feedback of every instance it talks to. Call with instancesGuard held.
+	void HandleHardwarePacket(const char* data, size_t size, const juce::String& senderAddress, int senderPort) {
+		const double now = juce::Time::getMillisecondCounterHiRes() * 0.001;
+		auto& session = GetSession(senderAddress, senderPort, now);
+
+		size_t position = 0;
+		while (position < size) {
+			const auto* postfix = static_cast<const char*>(std::memchr(data + position, NUMBER_POSTFIX, size - position));
+			if (postfix == nullptr) return;
+			const auto end = static_cast<size_t>(postfix - data);
+
+			const char letter = data[position];
+			size_t cursor = position + 1;
+			int64_t instanceId = 0;
+			if (cursor < end && data[cursor] == INSTANCE_PREFIX) instanceId = ReadNumber(data, ++cursor, end);
+
+			int64_t number = -1, value = -1;
+			if (instanceId >= 0 && cursor < end && data[cursor] == NUMBER_PREFIX) number = ReadNumber(data, ++cursor, end);
+			if (number >= 0 && cursor < end && data[cursor] == VALUE_PREFIX) value = ReadNumber(data, ++cursor, end);
+			if (cursor != end) number = -1;
+
+			position = end + 1;
+			while (position < size && (data[position] == 0 || data[position] == '\n' || data[position] == ' ')) position++;
+			if (number < 0) continue;
+
+			if (letter == 'q') {
+				if (number > UINT32_MAX) continue;
+				if (!AcceptSequence(session, static_cast<uint32_t>(number))) return; // seen it, drop the whole packet
+				continue;
+			}
+			if (instanceId > INT32_MAX || number > INT32_MAX || value > INT32_MAX) continue;
+
+			VoiceCommand::Type type{};
+			const bool isResync = letter == 'r';
+			const bool isCommand = !isResync && ToCommandType(letter, type) && (!IsSet(type) || value >= 0);
+			auto* instance = isResync || isCommand ? FindInstance(static_cast<int>(instanceId)) : nullptr;
+			if (instance == nullptr) continue;
+
+			auto& subscriber = Subscribe(*instance, senderAddress, senderPort, now);
+			if (isResync) subscriber.needsFullState = true;
+			else AddCommand(*instance, {type, static_cast<int>(number), static_cast<int>(value)}, session.id);
+		}
+	}
+
+	// /hueshift[/<id>]/<command> index [value], with a value it's a set instead of a toggle. Call with instancesGuard held.
+	void HandleOscMessage(const OscMessage& message, int sessionId) {
+		static constexpr char prefix[] = "/hueshift/";
+		const char* address = message.GetAddress();
+		if (std::strncmp(address, prefix, sizeof(prefix) - 1) != 0) return;
+
+		const auto length = std::strlen(address);
+		size_t position = sizeof(prefix) - 1;
+		int instanceId = 0;
+		if (position < length && address[position] >= '0' && address[position] <= '9') {
+			const auto id = ReadNumber(address, position, length);
+			if (id < 0 || id > INT32_MAX || position >= length || address[position] != '/') return;
+			instanceId = static_cast<int>(id);
+			position++;
+		}
+
+		int32_t index = 0, value = 0;
+		if (!message.GetInt(0, index) || index < 0) return;
+		const bool isSet = message.GetInt(1, value);
+
+		VoiceCommand::Type type{};
+		const char* command = address + position;
+		if (std::strcmp(command, "freeze") == 0) type = isSet ? VoiceCommand::Type::setFreeze : VoiceCommand::Type::toggleFreeze;
+		else if (std::strcmp(command, "octave") == 0) type = isSet ? VoiceCommand::Type::setOctave : VoiceCommand::Type::toggleOctave;
+		else if (std::strcmp(command, "select") == 0) type = isSet ? VoiceCommand::Type::setSelect : VoiceCommand::Type::toggleSelect;
+		else return;
+
+		auto* instance = FindInstance(instanceId);
+		if (instance != nullptr) AddCommand(*instance, {type, index, value}, sessionId);
+	}
+
+	// one reply for every instance in this process: HS_<port>;<id>,<id>,...
+	void HandleDiscoveryPacket(const char* data, size_t size) {
+		if (size < DISCOVERY_RECEIVE_BYTES || std::memcmp(data, DISCOVERY_RECEIVE_MESSAGE, DISCOVERY_RECEIVE_BYTES) != 0) return;
+
+		const int port = hardwarePort.load();
+		std::string reply = (port < 10000) ? "0" + std::to_string(port) : std::to_string(port);
+		reply = std::string(DISCOVERY_RESPONSE_PREFIX) + reply + DISCOVERY_INSTANCES_PREFIX;
+		{
+			const std::lock_guard<std::mutex> lock(instancesGuard);
+			for (auto instance = instances.begin(); instance != instances.end(); ++instance) {
+				if (instance != instances.begin()) reply += ',';
+				reply += std::to_string(instance->first);
+			}
+		}
+
+		if (responseSocket.write("255.255.255.255", DISCOVERY_RESPONSE_PORT, reply.data(), static_cast<int>(reply.size())) == -1)
+			std::cerr << "couldn't send discovery reply!\n";
+	}
+
+	// reads everything that's waiting on the socket, so one wakeup handles a whole burst
+	template <typename Handler>
+	void Drain(juce::DatagramSocket& socket, Handler&& handler) {
+		juce::String senderAddress;
+		int senderPort = 0;
+
+		for (int packets = 0; packets < 64; packets++) {
+			const int bytesRead = socket.read(readBuffer.data(), static_cast<int>(readBuffer.size()), false, senderAddress, senderPort);
+			if (bytesRead <= 0) return;
+			handler(readBuffer.data(), static_cast<size_t>(bytesRead), senderAddress, senderPort);
+		}
+	}
+
+	// the fixed ports can be taken by something else, keep trying every now and then
+	void TryBindFixedPorts() {
+		if (!discoveryBound && discoverySocket.bindToPort(DISCOVERY_RECEIVE_PORT)) {
+			discoveryBound = true;
+			poller.Add(discoverySocket.getRawSocketHandle(), discoveryTag);
+			std::cout << "discovery receiver bound to port: " << DISCOVERY_RECEIVE_PORT << "\n";
+		}
+
+		if (!oscBound && oscSocket.bindToPort(OSC_RECEIVE_PORT)) {
+			oscBound = true;
+			oscPort = oscSocket.getBoundPort();
+			poller.Add(oscSocket.getRawSocketHandle(), oscTag);
+			std::cout << "osc bound to port: " << OSC_RECEIVE_PORT << "\n";
+		}
+	}
+
+public:
+	NetworkReactor() :
+		juce::Thread("HueShift Network")
+	{
+		discoverySocket.setEnablePortReuse(true);
+		responseSocket.setEnablePortReuse(true);
+
+		if (hardwareSocket.bindToPort(HARDWARE_PORT)) {
+			hardwarePort = hardwareSocket.getBoundPort();
+			poller.Add(hardwareSocket.getRawSocketHandle(), hardwareTag);
+			std::cout << "bound to port: " << hardwarePort.load() << "\n";
+		}
+
+		startThread(juce::Thread::Priority::high);
+	}
+
+	~NetworkReactor() override {
+		stopThread(3000);
+		hardwareSocket.shutdown();
+		discoverySocket.shutdown();
+		oscSocket.shutdown();
+		responseSocket.shutdown();
+	}
+
+	// gives the instance an id (the lowest free one, from 1) and starts routing its commands into queue.
+	// voices is read (lock free) for the feedback to controllers. Both have to stay alive until Unregister.
+	int Register(CommandQueue& queue, const MidiHandler& voices) {
+		const std::lock_guard<std::mutex> lock(instancesGuard);
+		int id = 1;
+		while (instances.count(id) != 0) id++;
+
+		auto& instance = instances[id];
+		instance.commands = &queue;
+		instance.voices = &voices;
+		return id;
+	}
+
+	// nothing touches the instance's queue or voices anymore once this returns.
+	void Unregister(int id) {
+		const std::lock_guard<std::mutex> lock(instancesGuard);
+		instances.erase(id);
+	}
+
+	// returns -1 when not bound.
+	int GetHardwarePort() const { return hardwarePort.load(); }
+	int GetOscPort() const { return oscPort.load(); }
+
+	void run() override {
+		double lastBindAttempt = -1.0e9;
+
+		while (!threadShouldExit()) {
+			const double now = juce::Time::getMillisecondCounterHiRes() * 0.001;
+			if ((!discoveryBound || !oscBound) && now - lastBindAttempt > 1.0) {
+				lastBindAttempt = now;
+				TryBindFixedPorts();
+			}
+
+			// wakes up for the next feedback round at the latest, otherwise the timeout is only there to notice threadShouldExit
+			const int untilFeedbackMs = static_cast<int>((lastFeedbackSeconds + 1.0 / FEEDBACK_HZ - now) * 1000.0);
+			poller.Wait(juce::jlimit(0, 100, untilFeedbackMs), [&](int tag) {
+				switch (tag) {
+					case hardwareTag:
+						Drain(hardwareSocket, [&](const char* data, size_t size, const juce::String& address, int port) {
+							const std::lock_guard<std::mutex> lock(instancesGuard);
+							HandleHardwarePacket(data, size, address, port);
+						});
+						break;
+					case oscTag:
+						Drain(oscSocket, [&](const char* data, size_t size, const juce::String& address, int port) {
+							const std::lock_guard<std::mutex> lock(instancesGuard);
+							const int sessionId = GetSession(address, port, now).id;
+							OscReader::Parse(data, size, [&](const OscMessage& message) { HandleOscMessage(message, sessionId); });
+						});
+						break;
+					case discoveryTag:
+						Drain(discoverySocket, [&](const char* data, size_t size, const juce::String&, int) { HandleDiscoveryPacket(data, size); });
+						break;
+					default:
+						break;
+				}
+			});
+
+			// everything this wakeup brought in goes to the audio threads as one batch per instance
+			{
+				const std::lock_guard<std::mutex> lock(instancesGuard);
+				for (auto& entry : instances) Flush(entry.second);
+			}
+
+			const double afterWait = juce::Time::getMillisecondCounterHiRes() * 0.001;
+			if (afterWait - lastFeedbackSeconds >= 1.0 / FEEDBACK_HZ) {
+				lastFeedbackSeconds = afterWait;
+				const std::lock_guard<std::mutex> lock(instancesGuard);
+				SendFeedback(afterWait);
+
+				sessions.erase(std::remove_if(sessions.begin(), sessions.end(), [&](const Session& session) {
+					return afterWait - session.lastSeenSeconds > SESSION_TIMEOUT_SECONDS;
+				}), sessions.end());
+			}
+		}
+	}
+};
+
+}
@@ -0,0 +1,311 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+/*
+	Just enough OSC 1.0 to send our bundles and read simple commands, written straight into a fixed buffer.
+	No allocation and no JUCE, so it's cheap enough for the analysis thread and easy to poke at on its own.
+
+	Supported argument types: i (int32), f (float32), s (string), b (blob), T F N I (no data).
+*/
+
+#define OSC_MAX_BUNDLE_DEPTH 4 // nested bundles deeper than this are ignored
+
+namespace HueShift {
+
+namespace OscDetail {
+	inline size_t Padded(size_t size) {
+		return (size + 3) & ~size_t(3);
+	}
+
+	inline void WriteBigEndian32(char* destination, uint32_t value) {
+		destination[0] = static_cast<char>(value >> 24);
+		destination[1] = static_cast<char>(value >> 16);
+		destination[2] = static_cast<char>(value >> 8);
+		destination[3] = static_cast<char>(value);
+	}
+
+	inline uint32_t ReadBigEndian32(const char* source) {
+		const auto* bytes = reinterpret_cast<const unsigned char*>(source);
+		return (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) | (uint32_t(bytes[2]) << 8) | uint32_t(bytes[3]);
+	}
+
+	// length of a 0 terminated, 4 byte padded OSC string starting at data, 0 if it's broken.
+	inline size_t PaddedStringLength(const char* data, size_t available) {
+		const auto* end = static_cast<const char*>(std::memchr(data, 0, available));
+		if (end == nullptr) return 0;
+		const auto padded = Padded(static_cast<size_t>(end - data) + 1);
+		return padded <= available ? padded : 0;
+	}
+}
+
+// builds one packet (a message or a bundle of messages) in place. A message that doesn't fit is left out completely,
+// so whatever is in the buffer is always a valid packet.
+template <size_t Capacity>
+class OscWriter {
+	static_assert(Capacity % 4 == 0, "OSC is 4 byte aligned");
+
+private:
+	std::array<char, Capacity> buffer{};
+	size_t size = 0;
+	size_t messageStart = 0; // where the current message (including its bundle size field) begins
+	size_t argumentsStart = 0;
+	const char* typeTags = "";
+	size_t nextTypeTag = 0;
+	bool inBundle = false;
+	bool inMessage = false;
+	bool messageFits = true;
+	size_t messageCount = 0;
+	size_t droppedCount = 0;
+
+	bool Write(const void* data, size_t length) {
+		if (size + length > Capacity) return false;
+		std::memcpy(buffer.data() + size, data, length);
+		size += length;
+		return true;
+	}
+
+	bool WritePaddedString(const char* text) {
+		const auto length = std::strlen(text);
+		const auto padded = OscDetail::Padded(length + 1);
+		if (size + padded > Capacity) return false;
+
+		std::memcpy(buffer.data() + size, text, length);
+		std::memset(buffer.data() + size + length, 0, padded - length);
+		size += padded;
+		return true;
+	}
+
+	bool Write32(uint32_t value) {
+		if (size + 4 > Capacity) return false;
+		OscDetail::WriteBigEndian32(buffer.data() + size, value);
+		size += 4;
+		return true;
+	}
+
+	// checks the argument against the type tags given to BeginMessage, a mismatch is a bug on our side.
+	bool NextArgument(char expected) {
+		if (!inMessage || !messageFits) return false;
+		if (typeTags[nextTypeTag] != expected) {
+			messageFits = false;
+			return false;
+		}
+		nextTypeTag++;
+		return true;
+	}
+
+public:
+	void Clear() {
+		size = 0;
+		inBundle = false;
+		inMessage = false;
+		messageCount = 0;
+		droppedCount = 0;
+	}
+
+	// timeTag 1 means "immediately"
+	void BeginBundle(uint64_t timeTag = 1) {
+		Clear();
+		Write("#bundle", 8);
+		Write32(static_cast<uint32_t>(timeTag >> 32));
+		Write32(static_cast<uint32_t>(timeTag));
+		inBundle = true;
+	}
+
+	// tags without the leading ',', for example "iif". Every tag needs a matching Add call before EndMessage.
+	void BeginMessage(const char* address, const char* tags) {
+		if (!inBundle) Clear();
+
+		inMessage = true;
+		messageStart = size;
+		typeTags = tags;
+		nextTypeTag = 0;
+
+		messageFits = (!inBundle || Write32(0)) && WritePaddedString(address);
+		if (!messageFits) return;
+
+		// type tag string with the ',' in front
+		const auto length = std::strlen(tags) + 1;
+		const auto padded = OscDetail::Padded(length + 1);
+		if (size + padded > Capacity) {
+			messageFits = false;
+			return;
+		}
+		buffer[size] = ',';
+		std::memcpy(buffer.data() + size + 1, tags, length - 1);
+		std::memset(buffer.data() + size + length, 0, padded - length);
+		size += padded;
+		argumentsStart = size;
+	}
+
+	void AddInt(int32_t value) {
+		if (NextArgument('i')) messageFits = Write32(static_cast<uint32_t>(value));
+	}
+
+	void AddFloat(float value) {
+		uint32_t bits = 0;
+		std::memcpy(&bits, &value, 4);
+		if (NextArgument('f')) messageFits = Write32(bits);
+	}
+
+	void AddString(const char* text) {
+		if (NextArgument('s')) messageFits = WritePaddedString(text);
+	}
+
+	// returns false (and takes the message back out) if it didn't fit.
+	bool EndMessage() {
+		if (!inMessage) return false;
+		inMessage = false;
+
+		if (!messageFits || typeTags[nextTypeTag] != 0) {
+			size = messageStart;
+			droppedCount++;
+			return false;
+		}
+
+		if (inBundle) OscDetail::WriteBigEndian32(buffer.data() + messageStart, static_cast<uint32_t>(size - messageStart - 4));
+		messageCount++;
+		return true;
+	}
+
+	const char* GetData() const { return buffer.data(); }
+	size_t GetSize() const { return size; }
+	size_t GetMessageCount() const { return messageCount; }
+	size_t GetDroppedCount() const { return droppedCount; } // messages left out because they didn't fit
+	bool IsEmpty() const { return messageCount == 0; }
+};
+
+// one received message, only valid during the callback. Points into the packet, nothing is copied.
+class OscMessage {
+private:
+	const char* address = "";
+	const char* typeTags = ""; // without the ','
+	const char* arguments = nullptr;
+	size_t argumentsSize = 0;
+
+	// start of argument index, nullptr if there is no such argument or the packet is broken.
+	const char* FindArgument(size_t index, char& type) const {
+		const char* position = arguments;
+		const char* end = arguments + argumentsSize;
+
+		for (size_t i = 0; typeTags[i] != 0; i++) {
+			const char tag = typeTags[i];
+			if (i == index) {
+				type = tag;
+				return position;
+			}
+
+			size_t length = 0;
+			switch (tag) {
+				case 'i': case 'f': length = 4; break;
+				case 's': length = OscDetail::PaddedStringLength(position, static_cast<size_t>(end - position)); break;
+				case 'b':
+					if (end - position < 4) return nullptr;
+					length = 4 + OscDetail::Padded(OscDetail::ReadBigEndian32(position));
+					break;
+				case 'T': case 'F': case 'N': case 'I': length = 0; break;
+				default: return nullptr; // a type we don't know the size of, can't go past it
+			}
+
+			if (tag == 's' && length == 0) return nullptr;
+			if (length > static_cast<size_t>(end - position)) return nullptr;
+			position += length;
+		}
+		return nullptr;
+	}
+
+public:
+	OscMessage(const char* address, const char* typeTags, const char* arguments, size_t argumentsSize)
+		: address(address), typeTags(typeTags), arguments(arguments), argumentsSize(argumentsSize) {}
+
+	const char* GetAddress() const { return address; }
+	size_t GetNumArguments() const { return std::strlen(typeTags); }
+
+	// accepts i, f (rounded), T and F. Plenty of controllers send everything as floats.
+	bool GetInt(size_t index, int32_t& output) const {
+		char type = 0;
+		const char* data = FindArgument(index, type);
+		if (type == 'T' || type == 'F') {
+			output = type == 'T' ? 1 : 0;
+			return true;
+		}
+		if (data == nullptr || data + 4 > arguments + argumentsSize) return false;
+
+		const auto bits = OscDetail::ReadBigEndian32(data);
+		if (type == 'i') {
+			output = static_cast<int32_t>(bits);
+			return true;
+		}
+		if (type == 'f') {
+			float value = 0.f;
+			std::memcpy(&value, &bits, 4);
+			if (!(value > -2147483648.f && value < 2147483648.f)) return false; // also catches NaN
+			output = static_cast<int32_t>(value < 0.f ? value - 0.5f : value + 0.5f);
+			return true;
+		}
+		return false;
+	}
+
+	bool GetFloat(size_t index, float& output) const {
+		char type = 0;
+		const char* data = FindArgument(index, type);
+		if (data == nullptr || data + 4 > arguments + argumentsSize) return false;
+
+		const auto bits = OscDetail::ReadBigEndian32(data);
+		if (type == 'f') std::memcpy(&output, &bits, 4);
+		else if (type == 'i') output = static_cast<float>(static_cast<int32_t>(bits));
+		else return false;
+		return true;
+	}
+};
+
+// calls onMessage(const OscMessage&) for every message in the packet, bundles are unpacked. Returns false if the packet was broken,
+// messages before the broken part have been handed out already.
+class OscReader {
+private:
+	template <typename Callback>
+	static bool ParseElement(const char* data, size_t size, Callback& onMessage, int depth) {
+		if (size < 4 || size % 4 != 0) return false;
+
+		if (data[0] == '#') {
+			if (depth >= OSC_MAX_BUNDLE_DEPTH || size < 16 || std::memcmp(data, "#bundle", 8) != 0) return false;
+
+			size_t position = 16; // skip the time tag, we apply everything right away
+			while (position < size) {
+				if (size - position < 4) return false;
+				const auto elementSize = static_cast<size_t>(OscDetail::ReadBigEndian32(data + position));
+				position += 4;
+				if (elementSize > size - position) return false;
+				if (!ParseElement(data + position, elementSize, onMessage, depth + 1)) return false;
+				position += elementSize;
+			}
+			return true;
+		}
+
+		if (data[0] != '/') return false;
+		const auto addressLength = OscDetail::PaddedStringLength(data, size);
+		if (addressLength == 0) return false;
+
+		// a message without type tags is allowed by the spec, treat it as having no arguments
+		const char* tags = ",";
+		size_t tagsLength = 0;
+		if (addressLength < size && data[addressLength] == ',') {
+			tagsLength = OscDetail::PaddedStringLength(data + addressLength, size - addressLength);
+			if (tagsLength == 0) return false;
+			tags = data + addressLength;
+		}
+
+		const auto argumentsStart = addressLength + tagsLength;
+		onMessage(OscMessage(data, tags + 1, data + argumentsStart, size - argumentsStart));
+		return true;
+	}
+
+public:
+	template <typename Callback>
+	static bool Parse(const char* data, size_t size, Callback&& onMessage) {
+		return ParseElement(data, size, onMessage, 0);
+	}
+};
+
+}
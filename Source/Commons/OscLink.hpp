@@ -0,0 +1,163 @@
+#pragma once
+
+#include "JuceHeader.h"
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "OscCodec.hpp"
+#include "CellBuffer.hpp"
+#include "ParameterNaming.hpp"
+#include "SnapshotBuffer.hpp"
+#include "../DSP/MidiHandler.hpp"
+
+// OSC output next to the custom UDP protocol, the addresses are listed in ParameterNaming.hpp.
+// OSC input is read by the NetworkReactor.
+
+namespace HueShift {
+
+// where the per frame bundles go, an empty host is off (the default). Plain data, so it can be handed to the analysis
+// thread through a SnapshotBuffer.
+struct OscTarget {
+	char host[OSC_TARGET_MAX_HOST + 1]{};
+	int port = OSC_SEND_PORT;
+
+	bool IsOn() const { return host[0] != '\0' && port > 0; }
+
+	// false if the host doesn't fit
+	bool SetHost(const juce::String& newHost) {
+		const auto utf8 = newHost.trim().toStdString();
+		if (utf8.size() > OSC_TARGET_MAX_HOST) return false;
+		std::memset(host, 0, sizeof(host));
+		std::memcpy(host, utf8.data(), utf8.size());
+		return true;
+	}
+};
+
+// sends every analysed frame as a single bundle, leaving out what didn't change since it was last sent.
+// The buffer is reused, so a frame costs some comparisons and one socket write.
+class OscOutput {
+private:
+	juce::DatagramSocket socket{false};
+	OscWriter<OSC_MAX_PACKET_BYTES> writer{};
+	char gridAddress[32] = "/hueshift/1/grid";
+	char cellAddress[32] = "/hueshift/1/cell";
+	char voiceAddress[32] = "/hueshift/1/voice";
+
+	SnapshotBuffer<OscTarget> target; // message thread -> the thread sending
+	uint64_t seenTargets = 0;
+	juce::String sendHost{}; // the target's host, only rebuilt when it changes
+	int sendPort = 0;
+
+	// what the receiver has seen
+	juce::uint32 sentWidth = 0, sentHeight = 0;
+	std::array<juce::uint32, MAX_VOICES> sentColours{};
+	std::array<float, MAX_VOICES> sentMotion{};
+	std::array<uint8_t, MAX_VOICES> sentFlags{}; // enabled | frozen << 1 | octave << 2
+	std::array<float, MAX_VOICES> sentFrequencies{};
+	size_t sentVoices = 0;
+	double lastRefreshSeconds = -1.0e9;
+
+	static bool ColourChanged(juce::uint32 a, juce::uint32 b) {
+		for (int shift = 0; shift < 24; shift += 8) {
+			const int difference = static_cast<int>((a >> shift) & 0xff) - static_cast<int>((b >> shift) & 0xff);
+			if (std::abs(difference) > OSC_COLOUR_DEADBAND) return true;
+		}
+		return false;
+	}
+
+	static bool FrequencyChanged(float a, float b) {
+		if (a <= 0.f || b <= 0.f) return a != b;
+		return std::abs(1200.f * std::log2(a / b)) > OSC_FREQUENCY_DEADBAND_CENTS;
+	}
+
+	static uint8_t GetFlags(const VoiceStateSnapshot& voices, size_t index) {
+		return static_cast<uint8_t>((voices.enabled[index] ? 1 : 0) | (voices.frozen[index] ? 2 : 0) | (voices.octaveIndexes[index] << 2));
+	}
+
+public:
+	// the id from the NetworkReactor, goes into every address. Call before the first frame.
+	void SetInstanceId(int id) {
+		std::snprintf(gridAddress, sizeof(gridAddress), "/hueshift/%d/grid", id);
+		std::snprintf(cellAddress, sizeof(cellAddress), "/hueshift/%d/cell", id);
+		std::snprintf(voiceAddress, sizeof(voiceAddress), "/hueshift/%d/voice", id);
+	}
+
+	// an empty host turns the output off. Call from one thread only (the message thread).
+	void SetTarget(const OscTarget& newTarget) {
+		target.Publish(newTarget);
+	}
+
+	// call from one thread only, whoever publishes the cells. Doesn't lock, the send is one socket write.
+	void SendFrame(const CellBuffer& cells, const VoiceStateSnapshot& voices) {
+		bool forceAll = false;
+		if (target.GetPublishCount() != seenTargets) {
+			seenTargets = target.GetPublishCount();
+			OscTarget latest{};
+			target.Read(latest);
+			sendHost = latest.IsOn() ? juce::String(latest.host) : juce::String();
+			sendPort = latest.port;
+			forceAll = true; // a new receiver knows nothing yet
+		}
+		if (sendHost.isEmpty() || sendPort <= 0) return;
+
+		const double now = juce::Time::getMillisecondCounterHiRes() * 0.001;
+		if (now - lastRefreshSeconds >= OSC_REFRESH_SECONDS) forceAll = true;
+		if (forceAll) lastRefreshSeconds = now;
+
+		writer.BeginBundle();
+
+		if (forceAll || cells.width != sentWidth || cells.height != sentHeight) {
+			writer.BeginMessage(gridAddress, "ii");
+			writer.AddInt(static_cast<int32_t>(cells.width));
+			writer.AddInt(static_cast<int32_t>(cells.height));
+			writer.EndMessage();
+
+			sentWidth = cells.width;
+			sentHeight = cells.height;
+			forceAll = true; // indexes mean something else now
+		}
+
+		for (size_t i = 0; i < cells.size(); i++) {
+			const auto& cell = cells[i];
+			if (!forceAll && !ColourChanged(cell.argb, sentColours[i]) && std::abs(cell.motion - sentMotion[i]) <= OSC_MOTION_DEADBAND) continue;
+
+			writer.BeginMessage(cellAddress, "iiiiff");
+			writer.AddInt(static_cast<int32_t>(i));
+			writer.AddInt(static_cast<int32_t>((cell.argb >> 16) & 0xff));
+			writer.AddInt(static_cast<int32_t>((cell.argb >> 8) & 0xff));
+			writer.AddInt(static_cast<int32_t>(cell.argb & 0xff));
+			writer.AddFloat(cell.confidence);
+			writer.AddFloat(cell.motion);
+			if (writer.EndMessage()) {
+				sentColours[i] = cell.argb;
+				sentMotion[i] = cell.motion;
+			}
+		}
+
+		const bool voicesChanged = voices.numVoices != sentVoices;
+		for (size_t i = 0; i < voices.numVoices; i++) {
+			const auto flags = GetFlags(voices, i);
+			if (!forceAll && !voicesChanged && flags == sentFlags[i] && !FrequencyChanged(voices.frequencies[i], sentFrequencies[i])) continue;
+
+			writer.BeginMessage(voiceAddress, "iiiif");
+			writer.AddInt(static_cast<int32_t>(i));
+			writer.AddInt(voices.enabled[i] ? 1 : 0);
+			writer.AddInt(voices.frozen[i] ? 1 : 0);
+			writer.AddInt(voices.octaveIndexes[i]);
+			writer.AddFloat(voices.frequencies[i]);
+			if (writer.EndMessage()) {
+				sentFlags[i] = flags;
+				sentFrequencies[i] = voices.frequencies[i];
+			}
+		}
+		sentVoices = voices.numVoices;
+
+		if (writer.IsEmpty()) return; // nothing changed
+
+		// left out messages (only with a tiny buffer) keep their old sent value, so they go out next frame
+		socket.write(sendHost, sendPort, writer.GetData(), static_cast<int>(writer.GetSize()));
+	}
+};
+
+}
@@ -3,8 +3,52 @@
 #define MINIMUM_FREQ 20.0
 #define MAXIMUM_FREQ 20000.0
 
+// ================ Analysis
+#define ANALYSIS_HZ 50 // how often the camera image gets analysed at full quality
+#define ANALYSIS_MAX_HZ 120 // the most a controller can ask for (c-<hz>;), more than any camera delivers
+#define ANALYSIS_CPU_BUDGET 0.05f // fraction of one core the grid analysis may use before the governor lowers the quality
+#define VIEWER_HZ 30 // how often an open editor looks for newly analysed cells
+#define MOTION_BLOCK_PIXELS 8 // motion compares the mean brightness of this many pixels in a row with the last frame
+#define MOTION_MAX_BLOCKS (1 << 18) // blocks remembered from the last frame, a frame with more analysed pixels gets no motion for the rest
+#define COLOUR_CORRECTION_TARGET_LUMA 118.f // where exposure normalisation puts the reference brightness, about middle grey
+#define COLOUR_CORRECTION_MAX_GAIN 4.f // per channel, both ways
+#define COLOUR_CORRECTION_MAX_BLACK 64.f // a brighter darkest block is taken to be a bright scene, not a lifted black
+#define COLOUR_CORRECTION_ADAPTATION 0.05f // per frame, about a second to settle at 50 Hz
+#define CAMERA_SCAN_SECONDS 5.0 // how often the camera list is refreshed while an editor is open
+#define CAMERA_FIRST_FRAME_TIMEOUT_SECONDS 5.0 // a newly opened camera that sends nothing for this long takes over anyway
+#define CAMERA_FRAME_POOL_MAX 16 // frame images per camera, shared by every instance using it
+#define ANALYSIS_SHARE_SLOTS 8 // analysed frames kept for other instances with the same settings, see SharedAnalysisCache
+#define ANALYSIS_PREVIEW_SAMPLES 4 // pixels a grid cell nobody needs in full gets looked at, see CellDemand
+#define ANALYSIS_PREVIEW_ROW_STEP 8 // a region nobody needs in full only reads every this many analysed rows
+#define REGION_MASK_MAX_SIDE 1024 // a painted region mask bigger than this in either direction isn't loaded
+#define CELL_SMOOTHING_EMA 0.5f // how much of the way to the new frame's colour a cell goes, see CellSmoother
+#define CELL_SMOOTHING_HYSTERESIS 0.01f // hue a cell has to go past its band's edge before it changes band
+
+// ================ State
+#define STATE_MAGIC 0x74735348 // "HSst" when written little endian
+#define STATE_VERSION 5 // 3 added the camera name, 4 the processing settings, 5 the regions
+
 // ================ MIDI
 #define C1 24
+#define MAX_VOICES 128 // upper bound for the amount of grid cells, voice state is stored in fixed size arrays of this length
+#define VOICE_COMMANDS_PER_BLOCK 256 // network commands the audio thread applies per block at most, see NETWORK_BATCHES_PER_BLOCK
+#define FREQUENCY_SLEW_SECONDS 0.02f // how long a voice takes from one frame's frequency to the next, 0 jumps
+#define FREQUENCY_GLIDE_MAX_SECONDS 0.25 // a look behind glide never takes longer than this, even when frames are further apart
+
+// the output's budget, see MidiScheduler
+#define MIDI_OUTPUT_BYTES_PER_SECOND 0.f // no limit, a DAW track takes anything
+#define MIDI_DIN_BYTES_PER_SECOND 3125.f // DIN MIDI (31250 baud), for an output that ends in a 5 pin cable
+#define MIDI_OUTPUT_JITTER_MS 2.f // how late an event may go out to make room for others
+#define MIDI_OUTPUT_MAX_EVENTS_PER_BLOCK 512 // some hosts drop everything past their limit
+#define MIDI_SCHEDULER_CAPACITY 4096 // events collected per block, more are dropped
+#define MIDI_PASSTHROUGH_RESERVE_EVENTS 1024 // input events per block the passthrough makes room for up front, more still go through
+
+// per cell colour controller streams, see CcStreamer
+#define CC_STREAM_CHANNEL 2 // the notes go out on channel 1
+#define CC_STREAM_DEADBAND 0.01f // changes below 1% aren't sent
+#define CC_STREAM_MAX_HZ 30.f // per stream
+#define CC_STREAM_BYTES_PER_SECOND 1500.f // all streams together, about half of what DIN MIDI can carry so the notes still fit
+#define CC_STREAM_MAX_BURST_SECONDS 0.02 // how much unused budget can pile up
 
 // ================ Network UDP Data Receiver
 /*
@@ -12,16 +56,77 @@
     f-000000001;
     = f<prefix>000000001<postfix>
     this will freeze the 1st grid index if the bytes per message is 12.
+
+    Every plugin instance in a process shares one port, pick the instance with its id:
+    f#2-00000001;
+    = f<instance prefix>2<prefix>00000001<postfix>
+    without an id the command goes to the instance with the lowest id. A packet may hold several commands back to back.
+
+    f o s toggle freeze, octave and select. F O S set them instead, the value comes after the index:
+    F#2-00005=1;   freezes voice 5 of instance 2, no matter what it was before. O takes the octave index.
+
+    every sender (ip and port) has its own session. Put q-<sequence>; in front of the commands and count it up every packet,
+    a packet with a sequence we already saw from that sender is a duplicate and gets dropped. Late packets are still taken if they
+    are within NETWORK_SEQUENCE_WINDOW of the newest one, the count may wrap around after 4294967295. q-0; starts over
+    (a sender that restarts within the window should use a new port, its first packets look like resends otherwise).
+    Everything that comes in during one wakeup is coalesced per instance before it goes to the audio thread:
+    a set replaces earlier commands for the same voice, the same toggle from two senders counts once,
+    and a toggle that one sender sends twice cancels out.
 */
 
 #define HARDWARE_PORT 0 // OS chooses for us if it is 0
+#define INSTANCE_PREFIX '#' // optional, the char before the instance id
 #define NUMBER_PREFIX '-' // the char before an int begins
 #define NUMBER_POSTFIX ';' // the terminating char right after an int
+#define VALUE_PREFIX '=' // the char before the value of a set command
 #define BYTES_PER_MESSAGE 12 // max amt of digits + 3 for the prefixes
+#define NETWORK_BATCH_SIZE 64 // commands per batch, a wakeup with more sends several batches
+#define NETWORK_QUEUE_SIZE 64 // batches waiting for the audio thread, per instance
+#define NETWORK_BATCHES_PER_BLOCK 4 // the rest waits for the next block
+#define SESSION_TIMEOUT_SECONDS 60.0 // a sender that's quiet for this long is forgotten
+#define MAX_SESSIONS 64
+#define NETWORK_SEQUENCE_WINDOW 64 // sequences per session that are remembered, a packet later than that is dropped
+
+/*
+    feedback: whoever sent a command to an instance gets that instance's voice state back, on the port it sent from.
+    'r' (r#2-0;) asks for the full state. Send it when the sequence skips, and at least every SESSION_TIMEOUT_SECONDS to stay subscribed.
+
+    packet, sent when something changed and as a heartbeat every FEEDBACK_HEARTBEAT_SECONDS:
+        'H' 'S' 'D' version | instance id | flags (1 = full state) | sequence (2 bytes, big endian) | amount of voices | amount of entries
+        then per entry: voice index | state (bit 0 enabled, bit 1 frozen, bits 2-4 octave index)
+    a full state lists every voice, a heartbeat has no entries. A full state sent on request (or to a new controller)
+    carries the same sequence as the delta the others got that round.
+*/
+#define FEEDBACK_VERSION 1
+#define FEEDBACK_HEADER_BYTES 10
+#define FEEDBACK_HZ 30 // how often changes get collected and sent, many audio blocks end up in one packet
+#define FEEDBACK_HEARTBEAT_SECONDS 1.0
+#define FEEDBACK_MAX_SUBSCRIBERS 8 // per instance
 
 #define DISCOVERY_RECEIVE_PORT 8179
 #define DISCOVERY_RESPONSE_PORT 8180
 #define DISCOVERY_RECEIVE_MESSAGE "HS_PING"
 #define DISCOVERY_RESPONSE_PREFIX "HS_" // add the port (with zero at the start if needed) after this. Port should be 04848 or 11456 for example.
+#define DISCOVERY_INSTANCES_PREFIX ";" // after the port: the instance ids in this process, comma separated. HS_04848;1,2,3
 #define DISCOVERY_RECEIVE_BYTES 7
-#define DISCOVERY_RESPONSE_BYTES 8
\ No newline at end of file
+#define DISCOVERY_RESPONSE_BYTES 8 // the part up to the instance list, old controllers only read this
+
+// ================ OSC
+/*
+    sent once per analysed frame as one bundle, only what changed (everything every OSC_REFRESH_SECONDS).
+    <id> is the instance id, the same one the UDP protocol uses.
+        /hueshift/<id>/grid  ii     width height
+        /hueshift/<id>/cell  iiiiff index red green blue confidence motion
+        /hueshift/<id>/voice iiiif  index enabled frozen octaveIndex frequency
+    received, index counts from top left like the voices. Leave out /<id> for the lowest instance:
+        /hueshift/<id>/freeze i, /hueshift/<id>/octave i, /hueshift/<id>/select i    toggle that voice
+*/
+#define OSC_SEND_HOST "127.0.0.1" // what the editor suggests, the output is off until a host is set
+#define OSC_SEND_PORT 9000
+#define OSC_TARGET_MAX_HOST 63 // bytes of a host name or address the output takes
+#define OSC_RECEIVE_PORT 9001 // one per process, shared by all instances
+#define OSC_MAX_PACKET_BYTES 16384 // fits a full refresh of MAX_VOICES cells and voices
+#define OSC_COLOUR_DEADBAND 2 // a cell is only resent once a channel moved more than this (0-255)
+#define OSC_FREQUENCY_DEADBAND_CENTS 5.0
+#define OSC_MOTION_DEADBAND 0.01f
+#define OSC_REFRESH_SECONDS 2.0 // so late joiners catch up
@@ -0,0 +1,439 @@
+#pragma once
+#include <JuceHeader.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include "../DSP/MidiHandler.hpp"
+#include "../DSP/ColourCorrection.hpp"
+#include "../DSP/CellSmoother.hpp"
+#include "../DSP/RegionMask.hpp"
+#include "OscLink.hpp"
+
+namespace HueShift {
+
+// how a grid cell's pixels are turned into one colour, see GridAnalyser.
+enum class CellStatistic : uint8_t {
+	mean = 0,
+	dominantHue = 1
+};
+
+// how the camera image is cut up and sampled.
+struct GridSettings {
+	unsigned int samplePoints = 13;
+	unsigned int widthDivision = 5;
+	unsigned int heightDivision = 2;
+	CellStatistic statistic = CellStatistic::mean;
+
+	size_t GetAmountOfCells() const {
+		return static_cast<size_t>(widthDivision) * heightDivision;
+	}
+};
+
+// a whole show configuration, what gets saved with the project and what a preset holds.
+struct PluginState {
+	GridSettings grid{};
+	VoiceStateSnapshot voices{}; // only the enabled, frozen and octave state is stored, frequencies are live data
+	std::vector<RegionShape> regions{}; // replace the grid when there are any, one voice each
+
+	/*
+		binary layout (little endian):
+		u16 samplePoints, u16 widthDivision, u16 heightDivision,
+		u8 statistic (since version 2),
+		u16 amount of voices, then 1 byte per voice:
+			bit 0 = enabled, bit 1 = frozen, bit 2..3 = octave index
+		u16 amount of regions (since version 5), then per region u16 amount of polygon points and f32 x, y for each.
+			A region without points is a mask: u16 width, u16 height, then one bit per pixel (row major, lowest bit first), set is inside.
+	*/
+	void Write(juce::MemoryOutputStream& stream) const {
+		stream.writeShort(static_cast<short>(grid.samplePoints));
+		stream.writeShort(static_cast<short>(grid.widthDivision));
+		stream.writeShort(static_cast<short>(grid.heightDivision));
+		stream.writeByte(static_cast<char>(grid.statistic));
+
+		stream.writeShort(static_cast<short>(voices.numVoices));
+		for (size_t i = 0; i < voices.numVoices; i++) {
+			uint8_t flags = 0;
+			flags |= voices.enabled[i] ? 1u : 0u;
+			flags |= voices.frozen[i] ? 2u : 0u;
+			flags |= (voices.octaveIndexes[i] & 3u) << 2;
+			stream.writeByte(static_cast<char>(flags));
+		}
+
+		stream.writeShort(static_cast<short>(regions.size()));
+		for (const auto& region : regions) WriteRegion(stream, region);
+	}
+
+	// returns false when the data is cut off or out of range, output is left untouched in that case.
+	// version is the STATE_VERSION the data was written with.
+	static bool Read(juce::MemoryInputStream& stream, PluginState& output, int version) {
+		if (stream.getNumBytesRemaining() < 8) return false;
+
+		PluginState state{};
+		state.grid.samplePoints = static_cast<uint16_t>(stream.readShort());
+		state.grid.widthDivision = static_cast<uint16_t>(stream.readShort());
+		state.grid.heightDivision = static_cast<uint16_t>(stream.readShort());
+		if (state.grid.samplePoints == 0 || state.grid.widthDivision == 0 || state.grid.heightDivision == 0) return false;
+		if (state.grid.GetAmountOfCells() > MAX_VOICES) return false;
+
+		if (version >= 2) {
+			const auto statistic = static_cast<uint8_t>(stream.readByte());
+			if (statistic > static_cast<uint8_t>(CellStatistic::dominantHue)) return false;
+			state.grid.statistic = static_cast<CellStatistic>(statistic);
+		}
+
+		const size_t numVoices = static_cast<uint16_t>(stream.readShort());
+		if (numVoices > MAX_VOICES || stream.getNumBytesRemaining() < static_cast<juce::int64>(numVoices)) return false;
+
+		state.voices.numVoices = numVoices;
+		for (size_t i = 0; i < numVoices; i++) {
+			const auto flags = static_cast<uint8_t>(stream.readByte());
+			state.voices.enabled[i] = (flags & 1u) != 0;
+			state.voices.frozen[i] = (flags & 2u) != 0;
+			state.voices.octaveIndexes[i] = static_cast<uint8_t>((flags >> 2) & 3u);
+		}
+
+		if (version >= 5) {
+			if (stream.getNumBytesRemaining() < 2) return false;
+			const size_t amountOfRegions = static_cast<uint16_t>(stream.readShort());
+			if (amountOfRegions > MAX_VOICES) return false;
+			state.regions.resize(amountOfRegions);
+			for (auto& region : state.regions) {
+				if (!ReadRegion(stream, region)) return false;
+			}
+		}
+
+		output = state;
+		return true;
+	}
+
+private:
+	static void WriteRegion(juce::MemoryOutputStream& stream, const RegionShape& region) {
+		// what RegionShape uses: the polygon if it has 3 points, the mask otherwise
+		const bool isPolygon = region.polygon.size() >= 3;
+		stream.writeShort(static_cast<short>(isPolygon ? region.polygon.size() : 0));
+		if (isPolygon) {
+			for (const auto& point : region.polygon) {
+				stream.writeFloat(point.x);
+				stream.writeFloat(point.y);
+			}
+			return;
+		}
+
+		const int width = region.mask.isValid() ? region.mask.getWidth() : 0;
+		const int height = region.mask.isValid() ? region.mask.getHeight() : 0;
+		stream.writeShort(static_cast<short>(width));
+		stream.writeShort(static_cast<short>(height));
+
+		uint8_t bits = 0;
+		int amountOfBits = 0;
+		for (int y = 0; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				if (region.mask.getPixelAt(x, y).getBrightness() > 0.5f) bits |= static_cast<uint8_t>(1u << amountOfBits);
+				if (++amountOfBits == 8) {
+					stream.writeByte(static_cast<char>(bits));
+					bits = 0;
+					amountOfBits = 0;
+				}
+			}
+		}
+		if (amountOfBits > 0) stream.writeByte(static_cast<char>(bits));
+	}
+
+	static bool ReadRegion(juce::MemoryInputStream& stream, RegionShape& region) {
+		if (stream.getNumBytesRemaining() < 2) return false;
+		const size_t amountOfPoints = static_cast<uint16_t>(stream.readShort());
+		if (amountOfPoints > 0) {
+			if (amountOfPoints < 3 || stream.getNumBytesRemaining() < static_cast<juce::int64>(amountOfPoints * 8)) return false;
+			region.polygon.resize(amountOfPoints);
+			for (auto& point : region.polygon) {
+				point.x = stream.readFloat();
+				point.y = stream.readFloat();
+				if (!(point.x >= 0.f && point.x <= 1.f && point.y >= 0.f && point.y <= 1.f)) return false;
+			}
+			return true;
+		}
+
+		if (stream.getNumBytesRemaining() < 4) return false;
+		const int width = static_cast<uint16_t>(stream.readShort());
+		const int height = static_cast<uint16_t>(stream.readShort());
+		if (width > REGION_MASK_MAX_SIDE || height > REGION_MASK_MAX_SIDE) return false;
+		if (width == 0 || height == 0) return true; // an empty region, its voice never sees a pixel
+
+		const auto bytes = (static_cast<juce::int64>(width) * height + 7) / 8;
+		if (stream.getNumBytesRemaining() < bytes) return false;
+		juce::MemoryBlock block{};
+		stream.readIntoMemoryBlock(block, static_cast<size_t>(bytes));
+		const auto* bits = static_cast<const uint8_t*>(block.getData());
+
+		region.mask = juce::Image(juce::Image::RGB, width, height, true); // black, outside
+		for (int i = 0; i < width * height; i++) {
+			if ((bits[i / 8] >> (i % 8)) & 1u) region.mask.setPixelAt(i % width, i / width, juce::Colours::white);
+		}
+		return true;
+	}
+};
+
+/*
+	How the analysis and the MIDI output are set up, what the processor's Set* calls change. Saved with the project
+	(since version 4) but not in the presets, a preset is a show, this is the rig.
+
+	binary layout: u16 amount of bytes that follow, then the fields in order:
+		f32 motionGate
+		u8 ccStreams.mode, u8 ccStreams.firstChannel, f32 deadband, f32 maxHzPerStream, f32 bytesPerSecond
+		u8 colourCorrection.whiteBalance, u8 flags (bit 0 = normaliseExposure, bit 1 = subtractBlack),
+			f32 targetLuma, f32 maxGain, f32 adaptation, f32 x 4 referencePatch (x, y, width, height)
+		u8 cellSmoothing.mode, u8 medianLength, f32 emaAmount, f32 hysteresis
+		u8 midiOutput.passthrough
+		f32 midiScheduler.bytesPerSecond, f32 jitterMilliseconds, u16 maxEventsPerBlock
+		f32 frequencyGlide.slewSeconds, u8 lookBehind
+		u16 oscTarget.port, u8 host length, the host's utf8 bytes (none is off)
+	Fields only ever get appended. A reader takes the ones it knows and skips the rest, older data keeps the defaults for
+	the fields it doesn't have, so adding one doesn't need a new STATE_VERSION.
+*/
+struct ProcessingSettings {
+	float motionGate = 0.f; // see MidiHandler::SetMotionGate
+	CcStreamSettings ccStreams{};
+	ColourCorrectionSettings colourCorrection{};
+	CellSmoothingSettings cellSmoothing{};
+	MidiOutputSettings midiOutput{};
+	MidiSchedulerSettings midiScheduler{};
+	FrequencyGlideSettings frequencyGlide{};
+	OscTarget oscTarget{};
+
+	void Write(juce::MemoryOutputStream& stream) const {
+		juce::MemoryOutputStream fields{};
+		fields.writeFloat(motionGate);
+		fields.writeByte(static_cast<char>(ccStreams.mode));
+		fields.writeByte(static_cast<char>(ccStreams.firstChannel));
+		fields.writeFloat(ccStreams.deadband);
+		fields.writeFloat(ccStreams.maxHzPerStream);
+		fields.writeFloat(ccStreams.bytesPerSecond);
+
+		const auto& correction = colourCorrection;
+		fields.writeByte(static_cast<char>(correction.whiteBalance));
+		fields.writeByte(static_cast<char>((correction.normaliseExposure ? 1u : 0u) | (correction.subtractBlack ? 2u : 0u)));
+		fields.writeFloat(correction.targetLuma);
+		fields.writeFloat(correction.maxGain);
+		fields.writeFloat(correction.adaptation);
+		fields.writeFloat(correction.referencePatch.getX());
+		fields.writeFloat(correction.referencePatch.getY());
+		fields.writeFloat(correction.referencePatch.getWidth());
+		fields.writeFloat(correction.referencePatch.getHeight());
+
+		fields.writeByte(static_cast<char>(cellSmoothing.mode));
+		fields.writeByte(static_cast<char>(cellSmoothing.medianLength));
+		fields.writeFloat(cellSmoothing.emaAmount);
+		fields.writeFloat(cellSmoothing.hysteresis);
+
+		fields.writeByte(static_cast<char>(midiOutput.passthrough));
+
+		fields.writeFloat(midiScheduler.bytesPerSecond);
+		fields.writeFloat(midiScheduler.jitterMilliseconds);
+		fields.writeShort(static_cast<short>(midiScheduler.maxEventsPerBlock));
+
+		fields.writeFloat(frequencyGlide.slewSeconds);
+		fields.writeByte(static_cast<char>(frequencyGlide.lookBehind ? 1 : 0));
+
+		const auto hostLength = std::strlen(oscTarget.host);
+		fields.writeShort(static_cast<short>(oscTarget.port));
+		fields.writeByte(static_cast<char>(hostLength));
+		fields.write(oscTarget.host, hostLength);
+
+		stream.writeShort(static_cast<short>(fields.getDataSize()));
+		stream.write(fields.getData(), fields.getDataSize());
+	}
+
+	// returns false when the data is cut off or out of range, output is left untouched in that case.
+	static bool Read(juce::MemoryInputStream& stream, ProcessingSettings& output) {
+		if (stream.getNumBytesRemaining() < 2) return false;
+		const auto size = static_cast<uint16_t>(stream.readShort());
+		if (stream.getNumBytesRemaining() < size) return false;
+
+		juce::MemoryBlock block{};
+		stream.readIntoMemoryBlock(block, size);
+		juce::MemoryInputStream fields(block.getData(), block.getSize(), false);
+
+		ProcessingSettings settings{};
+		if (fields.getNumBytesRemaining() >= 4) {
+			settings.motionGate = fields.readFloat();
+			if (!(settings.motionGate >= 0.f && settings.motionGate <= 1.f)) return false;
+		}
+		if (fields.getNumBytesRemaining() >= 14) {
+			const auto mode = static_cast<uint8_t>(fields.readByte());
+			if (mode > static_cast<uint8_t>(CcStreamMode::nrpn)) return false;
+			settings.ccStreams.mode = static_cast<CcStreamMode>(mode);
+			settings.ccStreams.firstChannel = static_cast<uint8_t>(fields.readByte());
+			settings.ccStreams.deadband = fields.readFloat();
+			settings.ccStreams.maxHzPerStream = fields.readFloat();
+			settings.ccStreams.bytesPerSecond = fields.readFloat();
+			if (settings.ccStreams.firstChannel < 1 || settings.ccStreams.firstChannel > 16) return false;
+		}
+		if (fields.getNumBytesRemaining() >= 30) {
+			auto& correction = settings.colourCorrection;
+			const auto whiteBalance = static_cast<uint8_t>(fields.readByte());
+			if (whiteBalance > static_cast<uint8_t>(WhiteBalanceMode::referencePatch)) return false;
+			correction.whiteBalance = static_cast<WhiteBalanceMode>(whiteBalance);
+			const auto flags = static_cast<uint8_t>(fields.readByte());
+			correction.normaliseExposure = (flags & 1u) != 0;
+			correction.subtractBlack = (flags & 2u) != 0;
+			correction.targetLuma = fields.readFloat();
+			correction.maxGain = fields.readFloat();
+			correction.adaptation = fields.readFloat();
+			const float x = fields.readFloat(), y = fields.readFloat(), width = fields.readFloat(), height = fields.readFloat();
+			correction.referencePatch = {x, y, width, height};
+		}
+		if (fields.getNumBytesRemaining() >= 10) {
+			auto& smoothing = settings.cellSmoothing;
+			const auto mode = static_cast<uint8_t>(fields.readByte());
+			if (mode > static_cast<uint8_t>(CellSmoothingMode::median)) return false;
+			smoothing.mode = static_cast<CellSmoothingMode>(mode);
+			smoothing.medianLength = static_cast<uint8_t>(fields.readByte());
+			smoothing.emaAmount = fields.readFloat();
+			smoothing.hysteresis = fields.readFloat();
+		}
+		if (fields.getNumBytesRemaining() >= 1) {
+			const auto passthrough = static_cast<uint8_t>(fields.readByte());
+			if (passthrough > static_cast<uint8_t>(MidiPassthrough::all)) return false;
+			settings.midiOutput.passthrough = static_cast<MidiPassthrough>(passthrough);
+		}
+		if (fields.getNumBytesRemaining() >= 10) {
+			auto& scheduler = settings.midiScheduler;
+			scheduler.bytesPerSecond = fields.readFloat();
+			scheduler.jitterMilliseconds = fields.readFloat();
+			scheduler.maxEventsPerBlock = static_cast<uint16_t>(fields.readShort());
+			if (!(scheduler.bytesPerSecond >= 0.f) || scheduler.maxEventsPerBlock <= 0) return false;
+		}
+		if (fields.getNumBytesRemaining() >= 5) {
+			settings.frequencyGlide.slewSeconds = fields.readFloat();
+			settings.frequencyGlide.lookBehind = fields.readByte() != 0;
+			if (!(settings.frequencyGlide.slewSeconds >= 0.f && settings.frequencyGlide.slewSeconds <= 1.f)) return false;
+		}
+		if (fields.getNumBytesRemaining() >= 3) {
+			auto& target = settings.oscTarget;
+			target.port = static_cast<uint16_t>(fields.readShort());
+			const auto hostLength = static_cast<uint8_t>(fields.readByte());
+			if (hostLength > OSC_TARGET_MAX_HOST || fields.getNumBytesRemaining() < hostLength) return false;
+			fields.read(target.host, hostLength); // the rest of host stays 0
+		}
+
+		output = settings;
+		return true;
+	}
+};
+
+// named show configurations. Presets are built and owned here (never on the audio thread),
+// the audio thread only ever gets a pointer to one through MidiHandler::QueuePreset.
+class PresetBank {
+private:
+	MidiHandler& handler;
+	mutable std::mutex bankGuard; // never touched by the audio thread
+	std::map<juce::String, std::unique_ptr<PluginState>> presets{};
+	std::vector<std::unique_ptr<PluginState>> retired{}; // replaced or anonymous presets, freed once the audio thread is done with them
+
+	// frees retired presets the audio thread can't see anymore. bankGuard must be held.
+	void CollectRetired() {
+		retired.erase(std::remove_if(retired.begin(), retired.end(), [this](const std::unique_ptr<PluginState>& preset){
+			return !handler.IsPresetInFlight(&preset->voices);
+		}), retired.end());
+	}
+
+public:
+	PresetBank(MidiHandler& handler)
+	: handler(handler) {}
+
+	// overwrites a preset with the same name. Safe from any thread except the audio thread.
+	void Store(const juce::String& name, const PluginState& state) {
+		auto preset = std::make_unique<PluginState>(state);
+
+		const std::lock_guard<std::mutex> lock(bankGuard);
+		auto found = presets.find(name);
+		if (found != presets.end()) retired.push_back(std::move(found->second));
+		presets[name] = std::move(preset);
+		CollectRetired();
+	}
+
+	// hands the voice state over to the audio thread, which applies it at the start of its next block.
+	// returns false if there is no such preset, otherwise copies it into output so the caller can apply the grid settings
+	// (another thread may replace the preset as soon as the lock is gone).
+	bool Recall(const juce::String& name, PluginState& output) {
+		const std::lock_guard<std::mutex> lock(bankGuard);
+		CollectRetired();
+
+		auto found = presets.find(name);
+		if (found == presets.end()) return false;
+
+		handler.QueuePreset(&found->second->voices);
+		output = *found->second;
+		return true;
+	}
+
+	// copies the voice state the audio thread applies next block, false if there is none. Every preset the handler can
+	// point at is owned here and only freed under bankGuard, so it can't go away while it's copied.
+	bool GetPendingVoices(VoiceStateSnapshot& output) const {
+		const std::lock_guard<std::mutex> lock(bankGuard);
+		const auto* pending = handler.GetPendingPreset();
+		if (pending == nullptr) return false;
+
+		output = *pending;
+		return true;
+	}
+
+	// same as Recall, but for a state that doesn't get a name (like the one the host restores).
+	void Apply(const PluginState& state) {
+		auto preset = std::make_unique<PluginState>(state);
+
+		const std::lock_guard<std::mutex> lock(bankGuard);
+		CollectRetired();
+		handler.QueuePreset(&preset->voices);
+		retired.push_back(std::move(preset));
+	}
+
+	bool Remove(const juce::String& name) {
+		const std::lock_guard<std::mutex> lock(bankGuard);
+		auto found = presets.find(name);
+		if (found == presets.end()) return false;
+
+		retired.push_back(std::move(found->second));
+		presets.erase(found);
+		CollectRetired();
+		return true;
+	}
+
+	juce::StringArray GetNames() const {
+		const std::lock_guard<std::mutex> lock(bankGuard);
+		juce::StringArray names;
+		for (const auto& preset : presets) names.add(preset.first);
+		return names;
+	}
+
+	void Write(juce::MemoryOutputStream& stream) const {
+		const std::lock_guard<std::mutex> lock(bankGuard);
+		stream.writeInt(static_cast<int>(presets.size()));
+		for (const auto& preset : presets) {
+			stream.writeString(preset.first);
+			preset.second->Write(stream);
+		}
+	}
+
+	// replaces every preset with the ones in the stream. Returns false if the data was broken, the bank is left as it was then.
+	bool Read(juce::MemoryInputStream& stream, int version) {
+		const int amount = stream.readInt();
+		if (amount < 0) return false;
+
+		std::map<juce::String, std::unique_ptr<PluginState>> loaded{};
+		for (int i = 0; i < amount; i++) {
+			const auto name = stream.readString();
+			auto preset = std::make_unique<PluginState>();
+			if (!PluginState::Read(stream, *preset, version)) return false;
+			loaded[name] = std::move(preset);
+		}
+
+		const std::lock_guard<std::mutex> lock(bankGuard);
+		for (auto& preset : presets) retired.push_back(std::move(preset.second));
+		presets = std::move(loaded);
+		CollectRetired();
+		return true;
+	}
+};
+
+}
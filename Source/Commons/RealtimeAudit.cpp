@@ -0,0 +1,261 @@
+/*
+  ==============================================================================
+
+    Hooks for the real-time safety audit, only compiled with HUESHIFT_RT_AUDIT.
+    See RealtimeAudit.hpp for what gets checked.
+
+  ==============================================================================
+*/
+
+#include "RealtimeAudit.hpp"
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+ #include <cxxabi.h>
+ #include <dlfcn.h>
+ #include <execinfo.h>
+#endif
+
+#if defined(__linux__)
+ #include <poll.h>
+ #include <pthread.h>
+ #include <sys/select.h>
+ #include <sys/socket.h>
+ #include <time.h>
+ #include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+extern "C" __declspec(dllimport) unsigned short __stdcall RtlCaptureStackBackTrace(unsigned long, unsigned long, void**, unsigned long*);
+#endif
+
+namespace HueShift {
+namespace RealtimeAudit {
+
+namespace {
+	thread_local int realtimeDepth = 0;
+	thread_local bool isReporting = false; // stops the hooks from reporting themselves
+
+	// multiple producers (every audio thread in the process), one consumer (the reporter)
+	constexpr size_t queueSize = 256;
+	struct Slot {
+		std::atomic<bool> ready{false};
+		Violation violation{};
+	};
+	std::array<Slot, queueSize> queue{};
+	std::atomic<uint64_t> writeIndex{0};
+	std::atomic<uint64_t> readIndex{0};
+	std::atomic<uint64_t> violationCount{0};
+	std::atomic<uint64_t> droppedCount{0};
+
+	int CaptureFrames(void** frames, int maxFrames) {
+	#if defined(__unix__) || defined(__APPLE__)
+		return backtrace(frames, maxFrames);
+	#elif defined(_WIN32)
+		return RtlCaptureStackBackTrace(0, static_cast<unsigned long>(maxFrames), frames, nullptr);
+	#else
+		juce::ignoreUnused(frames, maxFrames);
+		return 0;
+	#endif
+	}
+
+	// the first backtrace loads the unwinder, which allocates. Get that out of the way before any audio thread runs.
+	const bool warmedUp = [](){
+		void* frames[2];
+		return CaptureFrames(frames, 2) >= 0;
+	}();
+
+	const char* KindToString(ViolationKind kind) {
+		switch (kind) {
+			case ViolationKind::allocation: return "heap allocation";
+			case ViolationKind::deallocation: return "heap deallocation";
+			case ViolationKind::mutexLock: return "mutex lock";
+			case ViolationKind::blockingCall: return "blocking call";
+		}
+		return "unknown";
+	}
+}
+
+void EnterRealtimeSection() {
+	realtimeDepth++;
+}
+
+void ExitRealtimeSection() {
+	realtimeDepth--;
+}
+
+bool IsInRealtimeSection() {
+	return realtimeDepth > 0;
+}
+
+void Report(ViolationKind kind, const char* what) {
+	if (realtimeDepth <= 0 || isReporting) return;
+	isReporting = true;
+
+	violationCount.fetch_add(1, std::memory_order_relaxed);
+
+	// only claim a slot while there's room. A claimed slot always gets published, the reader waits for it.
+	auto index = writeIndex.load(std::memory_order_acquire);
+	bool claimed = false;
+	while (index - readIndex.load(std::memory_order_acquire) < queueSize) {
+		if (writeIndex.compare_exchange_weak(index, index + 1, std::memory_order_acq_rel)) {
+			claimed = true;
+			break;
+		}
+	}
+
+	if (!claimed) {
+		droppedCount.fetch_add(1, std::memory_order_relaxed);
+	} else {
+		auto& slot = queue[index % queueSize];
+		slot.violation.kind = kind;
+		slot.violation.what = what;
+		slot.violation.numFrames = CaptureFrames(slot.violation.frames, RT_AUDIT_MAX_FRAMES);
+		slot.ready.store(true, std::memory_order_release);
+	}
+
+	isReporting = false;
+}
+
+bool PopViolation(Violation& output) {
+	const auto index = readIndex.load(std::memory_order_relaxed);
+	if (index == writeIndex.load(std::memory_order_acquire)) return false;
+
+	auto& slot = queue[index % queueSize];
+	if (!slot.ready.load(std::memory_order_acquire)) return false; // still being written, get it next time
+
+	output = slot.violation;
+	slot.ready.store(false, std::memory_order_relaxed);
+	readIndex.store(index + 1, std::memory_order_release);
+	return true;
+}
+
+uint64_t GetViolationCount() {
+	return violationCount.load(std::memory_order_relaxed);
+}
+
+uint64_t GetDroppedCount() {
+	return droppedCount.load(std::memory_order_relaxed);
+}
+
+std::string Describe(const Violation& violation) {
+	std::ostringstream out;
+	out << "realtime audit: " << KindToString(violation.kind) << " (" << violation.what << ") on the audio thread\n";
+
+	// the first two frames are CaptureFrames and Report
+	for (int i = 2; i < violation.numFrames; i++) {
+		out << "    #" << (i - 2) << " ";
+
+	#if defined(__unix__) || defined(__APPLE__)
+		Dl_info info{};
+		if (dladdr(violation.frames[i], &info) != 0 && info.dli_sname != nullptr) {
+			int status = 0;
+			char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+			out << (status == 0 && demangled != nullptr ? demangled : info.dli_sname)
+				<< " + " << (static_cast<const char*>(violation.frames[i]) - static_cast<const char*>(info.dli_saddr));
+			std::free(demangled);
+		} else {
+			out << violation.frames[i];
+		}
+	#else
+		out << violation.frames[i];
+	#endif
+
+		out << "\n";
+	}
+
+	return out.str();
+}
+
+}
+}
+
+// ============================================================================== allocation hooks
+
+void* operator new(std::size_t size) {
+	HueShift::RealtimeAudit::Report(HueShift::RealtimeAudit::ViolationKind::allocation, "operator new");
+	if (auto memory = std::malloc(size == 0 ? 1 : size)) return memory;
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+	HueShift::RealtimeAudit::Report(HueShift::RealtimeAudit::ViolationKind::allocation, "operator new[]");
+	if (auto memory = std::malloc(size == 0 ? 1 : size)) return memory;
+	throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	HueShift::RealtimeAudit::Report(HueShift::RealtimeAudit::ViolationKind::allocation, "operator new");
+	return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	HueShift::RealtimeAudit::Report(HueShift::RealtimeAudit::ViolationKind::allocation, "operator new[]");
+	return std::malloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void* memory) noexcept {
+	if (memory == nullptr) return;
+	HueShift::RealtimeAudit::Report(HueShift::RealtimeAudit::ViolationKind::deallocation, "operator delete");
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+	if (memory == nullptr) return;
+	HueShift::RealtimeAudit::Report(HueShift::RealtimeAudit::ViolationKind::deallocation, "operator delete[]");
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+	operator delete(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+	operator delete[](memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+	operator delete(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+	operator delete[](memory);
+}
+
+// ============================================================================== syscall hooks
+
+#if defined(__linux__)
+// These replace the libc symbols when the plugin is linked into the executable (the Standalone build) or loaded with RTLD_GLOBAL.
+// The real function is looked up once with RTLD_NEXT. The atomic is constant initialised, so there is no init guard that could lock.
+#define HUESHIFT_AUDIT_INTERPOSE(kind, returnType, name, parameters, arguments)                                 \
+	extern "C" returnType name parameters {                                                                     \
+		using Function = returnType (*) parameters;                                                            \
+		static std::atomic<Function> real{nullptr};                                                              \
+		auto function = real.load(std::memory_order_acquire);                                                   \
+		if (function == nullptr) {                                                                              \
+			function = reinterpret_cast<Function>(dlsym(RTLD_NEXT, #name));                                     \
+			real.store(function, std::memory_order_release);                                                    \
+		}                                                                                                       \
+		HueShift::RealtimeAudit::Report(HueShift::RealtimeAudit::ViolationKind::kind, #name);                    \
+		return function arguments;                                                                              \
+	}
+
+HUESHIFT_AUDIT_INTERPOSE(mutexLock, int, pthread_mutex_lock, (pthread_mutex_t* mutex), (mutex))
+HUESHIFT_AUDIT_INTERPOSE(blockingCall, int, pthread_cond_wait, (pthread_cond_t* condition, pthread_mutex_t* mutex), (condition, mutex))
+HUESHIFT_AUDIT_INTERPOSE(blockingCall, ssize_t, read, (int fd, void* buffer, size_t count), (fd, buffer, count))
+HUESHIFT_AUDIT_INTERPOSE(blockingCall, ssize_t, write, (int fd, const void* buffer, size_t count), (fd, buffer, count))
+HUESHIFT_AUDIT_INTERPOSE(blockingCall, int, fsync, (int fd), (fd))
+HUESHIFT_AUDIT_INTERPOSE(blockingCall, int, nanosleep, (const struct timespec* duration, struct timespec* remaining), (duration, remaining))
+HUESHIFT_AUDIT_INTERPOSE(blockingCall, int, usleep, (useconds_t microseconds), (microseconds))
+HUESHIFT_AUDIT_INTERPOSE(blockingCall, int, poll, (struct pollfd* fds, nfds_t amount, int timeout), (fds, amount, timeout))
+HUESHIFT_AUDIT_INTERPOSE(blockingCall, int, select, (int amount, fd_set* readFds, fd_set* writeFds, fd_set* errorFds, struct timeval* timeout), (amount, readFds, writeFds, errorFds, timeout))
+HUESHIFT_AUDIT_INTERPOSE(blockingCall, ssize_t, sendto, (int fd, const void* buffer, size_t length, int flags, const struct sockaddr* address, socklen_t addressLength), (fd, buffer, length, flags, address, addressLength))
+HUESHIFT_AUDIT_INTERPOSE(blockingCall, ssize_t, recvfrom, (int fd, void* buffer, size_t length, int flags, struct sockaddr* address, socklen_t* addressLength), (fd, buffer, length, flags, address, addressLength))
+
+#undef HUESHIFT_AUDIT_INTERPOSE
+#endif
@@ -0,0 +1,138 @@
+#pragma once
+#include <JuceHeader.h>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+/*
+	Real-time safety audit. Build with HUESHIFT_RT_AUDIT set to TRUE in the root CMakeLists.txt.
+
+	Code inside a ScopedRealtimeSection (processBlock) gets watched for:
+		- heap allocation and deallocation (global operator new/delete)
+		- blocking HueShift::Mutex locks
+		- on linux also pthread_mutex_lock and blocking syscalls like read, write, sleep, poll and send/recv
+	Every violation is stored with a short backtrace and printed by the Reporter thread.
+	In debug builds the reporter also hits a jassert, so any run that touches the audio path fails loudly.
+
+	Without the flag everything in here compiles down to nothing.
+*/
+
+#ifndef HUESHIFT_RT_AUDIT
+#define HUESHIFT_RT_AUDIT 0
+#endif
+
+#define RT_AUDIT_MAX_FRAMES 10 // stack frames kept per violation
+
+namespace HueShift {
+namespace RealtimeAudit {
+
+enum class ViolationKind {
+	allocation,
+	deallocation,
+	mutexLock,
+	blockingCall
+};
+
+struct Violation {
+	ViolationKind kind = ViolationKind::allocation;
+	const char* what = ""; // always a string literal
+	void* frames[RT_AUDIT_MAX_FRAMES]{};
+	int numFrames = 0;
+};
+
+#if HUESHIFT_RT_AUDIT
+	void EnterRealtimeSection();
+	void ExitRealtimeSection();
+	bool IsInRealtimeSection();
+
+	// records a violation if the calling thread is inside a realtime section. Never allocates or locks.
+	void Report(ViolationKind kind, const char* what);
+
+	// for the reporter, takes the oldest violation out of the queue.
+	bool PopViolation(Violation& output);
+	uint64_t GetViolationCount();
+	uint64_t GetDroppedCount(); // violations that didn't fit in the queue
+	std::string Describe(const Violation& violation);
+#else
+	inline void EnterRealtimeSection() {}
+	inline void ExitRealtimeSection() {}
+	inline bool IsInRealtimeSection() { return false; }
+	inline void Report(ViolationKind, const char*) {}
+	inline bool PopViolation(Violation&) { return false; }
+	inline uint64_t GetViolationCount() { return 0; }
+	inline uint64_t GetDroppedCount() { return 0; }
+	inline std::string Describe(const Violation&) { return {}; }
+#endif
+
+// marks the current thread as real-time for as long as it lives. Can be nested.
+class ScopedRealtimeSection {
+public:
+	ScopedRealtimeSection() { EnterRealtimeSection(); }
+	~ScopedRealtimeSection() { ExitRealtimeSection(); }
+
+	ScopedRealtimeSection(const ScopedRealtimeSection&) = delete;
+	ScopedRealtimeSection& operator=(const ScopedRealtimeSection&) = delete;
+};
+
+// prints violations from a low priority thread, never from the audio thread itself.
+class Reporter
+#if HUESHIFT_RT_AUDIT
+	: public juce::Thread
+#endif
+{
+#if HUESHIFT_RT_AUDIT
+public:
+	Reporter() : juce::Thread("Realtime Audit Reporter") {
+		startThread(juce::Thread::Priority::low);
+	}
+
+	~Reporter() override {
+		stopThread(1000);
+	}
+
+	void run() override {
+		uint64_t reportedDrops = 0;
+
+		while (!threadShouldExit()) {
+			wait(250);
+
+			Violation violation{};
+			while (PopViolation(violation)) {
+				std::cerr << Describe(violation);
+				jassertfalse; // the audio path isn't real-time safe, see the output for the call site.
+			}
+
+			const auto dropped = GetDroppedCount();
+			if (dropped != reportedDrops) {
+				std::cerr << "realtime audit: " << (dropped - reportedDrops) << " more violations didn't fit in the queue\n";
+				reportedDrops = dropped;
+			}
+		}
+	}
+#endif
+};
+
+}
+
+// drop in replacement for std::mutex that complains when lock() is called on the audio thread.
+// try_lock never blocks, so the audio thread is allowed to use that.
+class Mutex {
+private:
+	std::mutex mutex;
+
+public:
+	void lock() {
+		RealtimeAudit::Report(RealtimeAudit::ViolationKind::mutexLock, "HueShift::Mutex::lock");
+		mutex.lock();
+	}
+
+	bool try_lock() {
+		return mutex.try_lock();
+	}
+
+	void unlock() {
+		mutex.unlock();
+	}
+};
+
+}
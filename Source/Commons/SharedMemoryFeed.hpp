@@ -0,0 +1,211 @@
+#pragma once
+#include <JuceHeader.h>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include "HueShiftFeed.h"
+#include "CellBuffer.hpp"
+#include "ParameterNaming.hpp"
+#include "../DSP/MidiHandler.hpp"
+
+/*
+	Publishes the analysed cells, the voice state and the notes we send to a POSIX shared memory block,
+	so other programs on this machine (visuals, loggers, ...) can follow along without any networking.
+	The layout and how to read it lock free is in HueShiftFeed.h.
+
+	Opt-in: build with HUESHIFT_SHM_FEED set to TRUE in the root CMakeLists.txt. Without it, or on windows,
+	every call here does nothing.
+*/
+
+#ifndef HUESHIFT_SHM_FEED
+#define HUESHIFT_SHM_FEED 0
+#endif
+
+#if HUESHIFT_SHM_FEED && JUCE_WINDOWS
+#undef HUESHIFT_SHM_FEED
+#define HUESHIFT_SHM_FEED 0
+#endif
+
+#if HUESHIFT_SHM_FEED
+#include <cerrno>
+#include <cstddef>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static_assert(HUESHIFT_FEED_MAX_CELLS == MAX_VOICES, "the feed has room for exactly one cell per voice");
+
+#define SHM_FEED_MAX_INSTANCES 64 // tries /hueshift-1 up to this before giving up
+
+namespace HueShift {
+
+class SharedMemoryFeed {
+#if HUESHIFT_SHM_FEED
+private:
+	hueshift_feed* feed = nullptr;
+	juce::String name{};
+	uint64_t sampleTime = 0; // audio thread only
+
+	// seqlock write into one slot, same scheme as SnapshotBuffer but on raw shared memory.
+	template <typename Slot, typename Fill>
+	static void WriteSlot(Slot* slots, uint64_t& writeCount, Fill&& fill) {
+		const auto count = __atomic_load_n(&writeCount, __ATOMIC_RELAXED) + 1;
+		auto& slot = slots[(count - 1) % HUESHIFT_FEED_SLOTS];
+
+		const auto sequence = __atomic_load_n(&slot.sequence, __ATOMIC_RELAXED);
+		__atomic_store_n(&slot.sequence, sequence + 1, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+
+		fill(slot);
+
+		__atomic_store_n(&slot.sequence, sequence + 2, __ATOMIC_RELEASE);
+		__atomic_store_n(&writeCount, count, __ATOMIC_RELEASE);
+	}
+
+	void WritePulse(uint64_t time, int voice, bool isNoteOn) {
+		const auto count = __atomic_load_n(&feed->pulseWriteCount, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE); // readers of the pulse we overwrite must see the count first, see HueShiftFeed.h
+		auto& pulse = feed->pulses[count % HUESHIFT_FEED_PULSE_CAPACITY];
+
+		pulse.sampleTime = time;
+		pulse.voice = static_cast<uint16_t>(voice);
+		pulse.isNoteOn = isNoteOn ? 1 : 0;
+
+		__atomic_store_n(&feed->pulseWriteCount, count + 1, __ATOMIC_RELEASE);
+	}
+
+	// a block from a process that doesn't exist anymore (crashed host), safe to take over.
+	static bool IsLeftOver(const juce::String& candidate) {
+		const int fd = shm_open(candidate.toRawUTF8(), O_RDONLY, 0);
+		if (fd < 0) return false;
+
+		// mapped instead of read(), macOS doesn't do read on shared memory
+		void* memory = mmap(nullptr, offsetof(hueshift_feed, frames), PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (memory == MAP_FAILED) return false;
+
+		const auto* header = static_cast<const hueshift_feed*>(memory);
+		const auto magic = header->magic;
+		const auto writerPid = header->writerPid;
+		munmap(memory, offsetof(hueshift_feed, frames));
+
+		if (magic != HUESHIFT_FEED_MAGIC) return true; // a closed writer clears the magic
+
+		return kill(static_cast<pid_t>(writerPid), 0) != 0 && errno == ESRCH;
+	}
+
+public:
+	SharedMemoryFeed() {
+		for (int i = 1; i <= SHM_FEED_MAX_INSTANCES && feed == nullptr; i++) {
+			const auto candidate = juce::String(HUESHIFT_FEED_NAME_PREFIX) + juce::String(i);
+
+			// exclusive, so two instances (or two hosts) never end up writing the same block
+			int fd = shm_open(candidate.toRawUTF8(), O_CREAT | O_EXCL | O_RDWR, 0644);
+			if (fd < 0 && errno == EEXIST && IsLeftOver(candidate)) {
+				shm_unlink(candidate.toRawUTF8());
+				fd = shm_open(candidate.toRawUTF8(), O_CREAT | O_EXCL | O_RDWR, 0644);
+			}
+			if (fd < 0) continue;
+
+			if (ftruncate(fd, sizeof(hueshift_feed)) != 0) {
+				close(fd);
+				shm_unlink(candidate.toRawUTF8());
+				continue;
+			}
+
+			void* memory = mmap(nullptr, sizeof(hueshift_feed), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			close(fd); // the mapping keeps it alive
+
+			if (memory == MAP_FAILED) {
+				shm_unlink(candidate.toRawUTF8());
+				continue;
+			}
+
+			// touches every page now so the audio thread never takes a page fault on its first write
+			std::memset(memory, 0, sizeof(hueshift_feed));
+			feed = static_cast<hueshift_feed*>(memory);
+			feed->version = HUESHIFT_FEED_VERSION;
+			feed->size = sizeof(hueshift_feed);
+			feed->writerPid = static_cast<uint32_t>(getpid());
+			__atomic_store_n(&feed->magic, HUESHIFT_FEED_MAGIC, __ATOMIC_RELEASE); // readers check this last
+			name = candidate;
+		}
+
+		if (feed != nullptr) std::cout << "shared memory feed at " << name << "\n";
+		else std::cout << "couldn't create a shared memory feed\n";
+	}
+
+	~SharedMemoryFeed() {
+		if (feed == nullptr) return;
+		__atomic_store_n(&feed->magic, 0u, __ATOMIC_RELEASE);
+		munmap(feed, sizeof(hueshift_feed));
+		shm_unlink(name.toRawUTF8());
+	}
+
+	bool IsOpen() const { return feed != nullptr; }
+	juce::String GetName() const { return name; }
+
+	// call when the audio restarts, pulse times count from there.
+	void ResetClock() {
+		sampleTime = 0;
+	}
+
+	// only from the thread running the analysis.
+	void PublishCells(const CellBuffer& cells) {
+		if (feed == nullptr) return;
+
+		WriteSlot(feed->frames, feed->frameWriteCount, [&](hueshift_feed_frame& frame) {
+			frame.width = cells.width;
+			frame.height = cells.height;
+			frame.frameIndex = cells.frameIndex;
+			for (size_t i = 0; i < cells.size(); i++) {
+				frame.cells[i].argb = cells[i].argb;
+				frame.cells[i].confidence = cells[i].confidence;
+			}
+		});
+	}
+
+	// once per block from the audio thread, after the handler wrote its messages. No allocation, no locks, no syscalls.
+	void PublishBlock(const VoiceStateSnapshot& voices, const MidiScheduler::SentNotes& sentNotes, int numSamples) {
+		if (feed == nullptr) return;
+
+		for (const auto& note : sentNotes) {
+			const int voice = note.note - C1;
+			if (voice < 0 || voice >= MAX_VOICES) continue;
+			WritePulse(sampleTime + static_cast<uint64_t>(note.sample), voice, note.isOn);
+		}
+
+		sampleTime += static_cast<uint64_t>(numSamples);
+
+		WriteSlot(feed->voices, feed->voiceWriteCount, [&](hueshift_feed_voices& slot) {
+			slot.numVoices = static_cast<uint32_t>(voices.numVoices);
+			slot.blockIndex = voices.blockIndex;
+			slot.sampleTime = sampleTime;
+
+			std::memset(slot.enabled, 0, sizeof(slot.enabled));
+			std::memset(slot.frozen, 0, sizeof(slot.frozen));
+			for (size_t i = 0; i < voices.numVoices; i++) {
+				if (voices.enabled[i]) slot.enabled[i / 8] |= static_cast<uint8_t>(1u << (i % 8));
+				if (voices.frozen[i]) slot.frozen[i / 8] |= static_cast<uint8_t>(1u << (i % 8));
+				slot.octaveIndexes[i] = voices.octaveIndexes[i];
+				slot.frequencies[i] = voices.frequencies[i];
+			}
+		});
+	}
+#else
+public:
+	SharedMemoryFeed() = default;
+	bool IsOpen() const { return false; }
+	juce::String GetName() const { return {}; }
+	void ResetClock() {}
+	void PublishCells(const CellBuffer&) {}
+	void PublishBlock(const VoiceStateSnapshot&, const MidiScheduler::SentNotes&, int) {}
+#endif
+
+	SharedMemoryFeed(const SharedMemoryFeed&) = delete;
+	SharedMemoryFeed& operator=(const SharedMemoryFeed&) = delete;
+};
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace HueShift {
+
+// Single writer, many readers. The writer never waits, readers never take a lock.
+// Every publish goes into the next slot of a small ring, guarded by its own sequence counter (a seqlock per slot),
+// so a reader only has to retry if the writer laps the whole ring while it is copying.
+template <typename T, size_t NumSlots = 4>
+class SnapshotBuffer {
+	static_assert(std::is_trivially_copyable<T>::value, "snapshots are copied with memcpy");
+	static_assert(NumSlots >= 2, "the writer needs a slot that readers aren't looking at");
+
+private:
+	struct Slot {
+		std::atomic<uint32_t> sequence{0}; // odd while being written
+		T value{};
+	};
+
+	std::array<Slot, NumSlots> slots{};
+	std::atomic<uint64_t> publishCount{0};
+
+public:
+	// only call from the writing thread.
+	void Publish(const T& value) {
+		const auto count = publishCount.load(std::memory_order_relaxed) + 1;
+		auto& slot = slots[count % NumSlots];
+
+		const auto sequence = slot.sequence.load(std::memory_order_relaxed);
+		slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		std::memcpy(&slot.value, &value, sizeof(T));
+
+		slot.sequence.store(sequence + 2, std::memory_order_release);
+		publishCount.store(count, std::memory_order_release);
+	}
+
+	// copies the latest published value into output. returns false if nothing was published yet.
+	bool Read(T& output) const {
+		while (true) {
+			const auto count = publishCount.load(std::memory_order_acquire);
+			if (count == 0) return false;
+
+			const auto& slot = slots[count % NumSlots];
+			const auto before = slot.sequence.load(std::memory_order_acquire);
+			if (before & 1u) continue; // writer lapped the ring, try the newer slot
+
+			std::memcpy(&output, &slot.value, sizeof(T));
+			std::atomic_thread_fence(std::memory_order_acquire);
+
+			if (slot.sequence.load(std::memory_order_relaxed) == before) return true;
+		}
+	}
+
+	uint64_t GetPublishCount() const {
+		return publishCount.load(std::memory_order_acquire);
+	}
+};
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace HueShift {
+
+// bounded queue for exactly one producer thread and one consumer thread. Neither side ever waits or allocates,
+// Push just fails when the consumer fell behind a whole queue.
+template <typename T, size_t Capacity>
+class SpscQueue {
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "capacity has to be a power of two");
+
+private:
+	std::array<T, Capacity> items{};
+	alignas(64) std::atomic<size_t> readIndex{0}; // only written by the consumer
+	alignas(64) std::atomic<size_t> writeIndex{0}; // only written by the producer
+	std::atomic<uint64_t> droppedCount{0};
+
+public:
+	// producer only
+	bool Push(const T& value) {
+		const auto write = writeIndex.load(std::memory_order_relaxed);
+		if (write - readIndex.load(std::memory_order_acquire) >= Capacity) {
+			droppedCount.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		items[write & (Capacity - 1)] = value;
+		writeIndex.store(write + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer only
+	bool Pop(T& output) {
+		const auto read = readIndex.load(std::memory_order_relaxed);
+		if (read == writeIndex.load(std::memory_order_acquire)) return false;
+
+		output = items[read & (Capacity - 1)];
+		readIndex.store(read + 1, std::memory_order_release);
+		return true;
+	}
+
+	// only a hint when called from neither side
+	size_t GetSize() const {
+		return writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_acquire);
+	}
+
+	uint64_t GetDroppedCount() const {
+		return droppedCount.load(std::memory_order_relaxed);
+	}
+};
+
+}
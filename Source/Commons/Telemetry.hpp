@@ -0,0 +1,34 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace HueShift {
+
+// live numbers about what the plugin is doing. Every field is written by one thread and can be read from anywhere.
+struct Telemetry {
+	// analysis (written by whoever runs the grid analysis)
+	std::atomic<int> qualityLevel{0}; // AnalysisGovernor::Level
+	std::atomic<float> analysisMilliseconds{0.f}; // smoothed cost of one analysed frame
+	std::atomic<float> analysisLoad{0.f}; // fraction of one core spent on analysis
+	std::atomic<int> analysisHz{0};
+	std::atomic<uint64_t> framesAnalysed{0};
+	std::atomic<uint64_t> framesShared{0}; // taken from another instance that analysed the same frame the same way
+	std::atomic<int> cellsInFull{0}; // cells the last analysed frame got the full statistic for, the rest were previews
+	std::atomic<float> averageMotion{0.f}; // mean Cell::motion over the grid in the last frame
+	std::atomic<float> peakMotion{0.f}; // the cell that moved most in the last frame
+	std::atomic<float> exposureGain{1.f}; // the colour correction's gain on brightness, 1 is untouched
+	std::atomic<float> whiteBalanceSpread{1.f}; // the strongest channel gain over the weakest, 1 is neutral
+	std::atomic<uint64_t> bandChanges{0}; // cells that changed colour band, after the smoothing
+	std::atomic<uint64_t> bandChangesSuppressed{0}; // band changes in the analysed colours the smoothing held back
+
+	// MIDI (written by the audio thread)
+	std::atomic<uint64_t> samplesProcessed{0}; // since prepareToPlay, 64 bit so it doesn't wrap during a long installation
+	std::atomic<uint64_t> ccMessagesSent{0}; // colour controller stream updates, see CcStreamer
+	std::atomic<uint64_t> ccThrottledBlocks{0}; // blocks where the controller streams ran out of bandwidth
+	std::atomic<uint64_t> midiCoalesced{0}; // see MidiScheduler
+	std::atomic<uint64_t> midiDropped{0};
+	std::atomic<uint64_t> midiDeferred{0};
+	std::atomic<uint64_t> midiSpread{0};
+};
+
+}
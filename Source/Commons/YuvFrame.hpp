@@ -0,0 +1,106 @@
+#pragma once
+#include <JuceHeader.h>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "ParameterNaming.hpp"
+
+namespace HueShift {
+
+enum class YuvFormat : uint8_t {
+	nv12, // a luma plane, then one plane of interleaved cb, cr at half the width and height
+	yuyv  // one plane, y0 cb y1 cr for every two pixels
+};
+
+enum class YuvRange : uint8_t {
+	limited, // luma 16-235, chroma 16-240, what webcams send
+	full     // 0-255 (jpeg)
+};
+
+// a frame in the camera's own format, BT.601. Doesn't own the pixels.
+struct YuvFrameView {
+	YuvFormat format = YuvFormat::nv12;
+	YuvRange range = YuvRange::limited;
+	int width = 0, height = 0;
+	const uint8_t* planes[2]{}; // nv12: luma, chroma. yuyv: only the first
+	int strides[2]{}; // bytes per line
+
+	bool IsValid() const {
+		if (width <= 0 || height <= 0 || planes[0] == nullptr) return false;
+		if (format == YuvFormat::yuyv) return width % 2 == 0 && strides[0] >= width * 2;
+		return planes[1] != nullptr && strides[0] >= width && strides[1] >= (width + 1) / 2 * 2;
+	}
+
+	// bytes in each plane
+	size_t GetPlaneBytes(int plane) const {
+		if (format == YuvFormat::yuyv) return plane == 0 ? static_cast<size_t>(strides[0]) * height : 0;
+		return static_cast<size_t>(strides[plane]) * (plane == 0 ? height : (height + 1) / 2);
+	}
+};
+
+// an owned copy of a YuvFrameView, the planes packed into one block that is kept for the next frame of the same size
+class YuvImage {
+private:
+	std::vector<uint8_t> data{};
+	YuvFrameView view{};
+
+public:
+	void CopyFrom(const YuvFrameView& source) {
+		const size_t bytes[2] = { source.GetPlaneBytes(0), source.GetPlaneBytes(1) };
+		if (data.size() < bytes[0] + bytes[1]) data.resize(bytes[0] + bytes[1]);
+
+		view = source;
+		size_t offset = 0;
+		for (int plane = 0; plane < 2; plane++) {
+			if (bytes[plane] == 0) {
+				view.planes[plane] = nullptr;
+				continue;
+			}
+			std::memcpy(data.data() + offset, source.planes[plane], bytes[plane]);
+			view.planes[plane] = data.data() + offset;
+			offset += bytes[plane];
+		}
+	}
+
+	const YuvFrameView& GetView() const {
+		return view;
+	}
+};
+
+// the YuvImage version of FramePool: a copy nobody else holds, reused once every consumer let go of it
+class YuvFramePool {
+private:
+	std::vector<std::shared_ptr<YuvImage>> images{};
+
+public:
+	std::shared_ptr<const YuvImage> Copy(const YuvFrameView& source) {
+		for (auto& image : images) {
+			if (image.use_count() == 1) {
+				image->CopyFrom(source);
+				return image;
+			}
+		}
+
+		auto image = std::make_shared<YuvImage>();
+		image->CopyFrom(source);
+		if (images.size() < CAMERA_FRAME_POOL_MAX) images.push_back(image); // past that something is holding on to frames
+		return image;
+	}
+};
+
+// what the analysis gets from the CameraFeed: an image, or the planes of a source that delivers yuv
+struct CameraFrame {
+	juce::Image image{};
+	std::shared_ptr<const YuvImage> yuv{};
+	double seconds = 0.0; // when the feed got it, Time::getMillisecondCounterHiRes in seconds
+
+	bool IsValid() const {
+		return yuv != nullptr ? yuv->GetView().IsValid() : image.isValid();
+	}
+
+	int GetWidth() const { return yuv != nullptr ? yuv->GetView().width : image.getWidth(); }
+	int GetHeight() const { return yuv != nullptr ? yuv->GetView().height : image.getHeight(); }
+};
+
+}
@@ -0,0 +1,203 @@
+#pragma once
+#include <JuceHeader.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include "GridAnalyser.hpp"
+#include "AnalysisGovernor.hpp"
+#include "CellSmoother.hpp"
+#include "RegionMask.hpp"
+#include "SharedAnalysis.hpp"
+#include "../Commons/CameraFeed.hpp"
+#include "../Commons/CellBuffer.hpp"
+#include "../Commons/RealtimeAudit.hpp"
+#include "../Commons/SnapshotBuffer.hpp"
+#include "../Commons/Telemetry.hpp"
+
+namespace HueShift {
+
+// runs the grid analysis on its own thread, owned by the processor so the MIDI keeps following the camera with the editor closed.
+// Every tick it takes the newest camera frame (if there is one), analyses it and hands the cells to whoever publishes them.
+// Only the cells getDemand asks for get the full statistic, see CellDemand.
+// The editor only reads what was published. Instances watching the same camera with the same settings share the work, see SharedAnalysisCache.
+class AnalysisEngine : public juce::Thread {
+private:
+	CameraFeed& feed;
+	RegionCompiler& regionCompiler;
+	Telemetry& telemetry;
+	std::function<GridSettings()> getSettings;
+	std::function<CellDemand()> getDemand;
+	std::function<void(const CellBuffer&)> publish;
+
+	juce::SharedResourcePointer<SharedAnalysisCache> sharedAnalysis;
+
+	// analysis thread only
+	CameraFrame frame{};
+	uint64_t frameId = 0;
+	CellBuffer cells{}; // row major, reused every frame
+	CellDemand demand{};
+	ColourCorrectionSettings frameCorrectionSettings{};
+	GridAnalyser analyser;
+	CellSmoother smoother;
+	CellSmoothingSettings frameSmoothingSettings{};
+	AnalysisGovernor governor;
+	int configuredHz; // the rate at full quality, the governor may run slower
+	int currentHz;
+	std::atomic<int> requestedHz{0}; // a new configuredHz, 0 for none, see SetAnalysisHz
+
+	std::atomic<float> cpuBudget{ANALYSIS_CPU_BUDGET};
+	std::atomic<bool> analyseNow{false};
+	std::atomic<bool> motionGating{false}; // the voices depend on this instance's motion, see SetMotionGating
+	std::atomic<int> frameWidth{0}, frameHeight{0};
+	SnapshotBuffer<ColourCorrectionSettings> correctionSettings;
+	SnapshotBuffer<CellSmoothingSettings> smoothingSettings;
+
+	static double GetSeconds() {
+		return juce::Time::getMillisecondCounterHiRes() * 0.001;
+	}
+
+	void UpdateTelemetry() {
+		telemetry.qualityLevel.store(governor.GetLevel());
+		telemetry.analysisMilliseconds.store(static_cast<float>(governor.GetFrameSeconds() * 1000.0));
+		telemetry.analysisLoad.store(governor.GetLoad(currentHz));
+		telemetry.analysisHz.store(currentHz);
+
+		float motionSum = 0.f, peakMotion = 0.f;
+		for (size_t i = 0; i < cells.size(); i++) {
+			motionSum += cells[i].motion;
+			peakMotion = std::max(peakMotion, cells[i].motion);
+		}
+		telemetry.averageMotion.store(cells.size() > 0 ? motionSum / cells.size() : 0.f);
+		telemetry.peakMotion.store(peakMotion);
+
+		telemetry.bandChanges.store(smoother.GetBandChangeCount());
+		telemetry.bandChangesSuppressed.store(smoother.GetSuppressedCount());
+
+		const auto& gain = analyser.GetColourCorrection().gain;
+		telemetry.exposureGain.store(0.299f * gain[0] + 0.587f * gain[1] + 0.114f * gain[2]);
+		telemetry.whiteBalanceSpread.store(*std::max_element(gain.begin(), gain.end()) / *std::min_element(gain.begin(), gain.end()));
+	}
+
+	// smooths this instance's cells (the shared ones stay as analysed) and hands them out
+	void Finish() {
+		smoother.Process(cells, frameSmoothingSettings);
+		UpdateTelemetry();
+		publish(cells);
+	}
+
+	void AnalyseFrame(bool evenWithoutNewFrame) {
+		// no new picture means nothing changed, don't spend anything on it
+		if (!feed.TakeLatestFrame(frame, frameId) && !(evenWithoutNewFrame && frame.IsValid())) return;
+
+		const auto settings = getSettings();
+		demand = getDemand();
+		regionCompiler.SetFrameSize(frame.GetWidth(), frame.GetHeight());
+		frameWidth.store(frame.GetWidth());
+		frameHeight.store(frame.GetHeight());
+		const auto regions = regionCompiler.Get(); // keeps the regions alive while analysing
+
+		if (correctionSettings.Read(frameCorrectionSettings)) analyser.SetColourCorrection(frameCorrectionSettings);
+		smoothingSettings.Read(frameSmoothingSettings);
+		governor.SetBudget(cpuBudget.load());
+		const auto quality = governor.GetQuality(settings, configuredHz);
+
+		// another instance might have analysed this very frame the same way already. Not with a correction (it adapts over
+		// this instance's frames) or a motion gate (a gap in this instance's frames would gate the voices for a frame).
+		const AnalysisKey key{quality.settings, quality.sampleDensity, frameCorrectionSettings};
+		const bool canShare = regions == nullptr && frameCorrectionSettings.IsOff() && !motionGating.load();
+		if (canShare && sharedAnalysis->Find(frameId, key, demand, cells)) {
+			analyser.ForgetMotion(); // it didn't see this frame, the next one it analyses would show the motion of all skipped ones
+			cells.timeSeconds = frame.seconds;
+			telemetry.framesShared.fetch_add(1);
+			Finish();
+			return;
+		}
+
+		{
+			// the analysis has to stay allocation free as well, let the audit check it.
+			const RealtimeAudit::ScopedRealtimeSection realtimeSection;
+			analyser.Analyse(frame, quality.settings, cells, quality.sampleDensity, regions.get(), &demand);
+		}
+		cells.timeSeconds = frame.seconds;
+
+		if (canShare) sharedAnalysis->Store(frameId, key, demand, cells);
+
+		if (governor.AddMeasurement(analyser.GetLastAnalysisSeconds(), currentHz)) {
+			currentHz = governor.GetQuality(settings, configuredHz).analysisHz;
+		}
+		telemetry.framesAnalysed.fetch_add(1);
+		telemetry.cellsInFull.store(static_cast<int>(demand.CountFull(cells.size())));
+		Finish();
+	}
+
+public:
+	AnalysisEngine(CameraFeed& feed, RegionCompiler& regionCompiler, Telemetry& telemetry,
+		std::function<GridSettings()> getSettings, std::function<CellDemand()> getDemand,
+		std::function<void(const CellBuffer&)> publish, int analysisHz = ANALYSIS_HZ)
+	: juce::Thread("HueShift Analysis"), feed(feed), regionCompiler(regionCompiler), telemetry(telemetry),
+	getSettings(std::move(getSettings)), getDemand(std::move(getDemand)), publish(std::move(publish)), configuredHz(analysisHz), currentHz(analysisHz)
+	{}
+
+	~AnalysisEngine() override {
+		stopThread(3000);
+	}
+
+	// fraction of one core the analysis may take before the quality gets lowered
+	void SetCpuBudget(float fractionOfOneCore) {
+		cpuBudget.store(fractionOfOneCore);
+	}
+
+	// the rate at full quality, clamped to [1:ANALYSIS_MAX_HZ]. The governor still slows down from there when the analysis
+	// takes too long. Lock free, any thread: the audio thread routes the controllers' c-<hz>; here.
+	void SetAnalysisHz(int hz) {
+		requestedHz.store(juce::jlimit(1, ANALYSIS_MAX_HZ, hz)); // picked up at the next frame, no notify: that locks
+	}
+
+	// white balance and exposure normalisation, from the next frame on. Only call from one thread (the message thread).
+	void SetColourCorrection(const ColourCorrectionSettings& settings) {
+		correctionSettings.Publish(settings);
+	}
+
+	// whether the voices are gated by motion, the analysis then stays this instance's own. Any thread.
+	void SetMotionGating(bool isGating) {
+		motionGating.store(isGating);
+	}
+
+	// per cell smoothing over time and band hysteresis, from the next frame on. Only call from one thread (the message thread).
+	void SetCellSmoothing(const CellSmoothingSettings& settings) {
+		smoothingSettings.Publish(settings);
+	}
+
+	// analyses again right away, even if the camera didn't deliver a new frame
+	void AnalyseNow() {
+		analyseNow.store(true);
+		notify();
+	}
+
+	// size of the last analysed frame, 0 before the first one
+	int GetFrameWidth() const { return frameWidth.load(); }
+	int GetFrameHeight() const { return frameHeight.load(); }
+
+	void run() override {
+		double nextFrameSeconds = GetSeconds();
+
+		while (!threadShouldExit()) {
+			const double waitMilliseconds = (nextFrameSeconds - GetSeconds()) * 1000.0;
+			if (waitMilliseconds > 0.0 && !analyseNow.load()) {
+				wait(waitMilliseconds);
+				continue;
+			}
+
+			if (const int hz = requestedHz.exchange(0); hz > 0 && hz != configuredHz) {
+				configuredHz = hz;
+				currentHz = governor.GetQuality(getSettings(), configuredHz).analysisHz;
+			}
+
+			// a late frame pushes the schedule back instead of making up for it with a burst
+			nextFrameSeconds = std::max(nextFrameSeconds + 1.0 / currentHz, GetSeconds());
+			AnalyseFrame(analyseNow.exchange(false));
+		}
+	}
+};
+
+}
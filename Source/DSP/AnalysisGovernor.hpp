@@ -0,0 +1,147 @@
+#pragma once
+#include <JuceHeader.h>
+#include <algorithm>
+#include "../Commons/ParameterNaming.hpp"
+#include "../Commons/PluginState.hpp"
+
+namespace HueShift {
+
+// what the analysis should actually run at, derived from the user's GridSettings and the governor's level.
+struct AnalysisQuality {
+	GridSettings settings{};
+	float sampleDensity = 1.f; // see GridAnalyser::Analyse
+	int analysisHz = 50;
+};
+
+/*
+	Keeps the grid analysis inside a CPU budget by stepping the quality down when frames get too expensive
+	and back up when there is plenty of headroom.
+
+	load = smoothed seconds per frame * frames per second, so 0.05 means 5% of one core.
+	Stepping down happens quickly (a quarter second over budget), stepping up only after two seconds well below it,
+	and both reset the measurements, so the governor doesn't bounce between two levels.
+*/
+class AnalysisGovernor {
+public:
+	enum Level {
+		minimal = 0, // mean, quarter of the samples, quarter of the rate
+		slow,        // mean, quarter of the samples, half the rate
+		meanOnly,    // mean, half the samples
+		reduced,     // configured statistic, half the samples
+		full,        // exactly what the user configured
+		amountOfLevels
+	};
+
+private:
+	float budget = ANALYSIS_CPU_BUDGET;
+	bool enabled = true;
+	int level = full;
+
+	double smoothedFrameSeconds = 0.0;
+	int measuredFrames = 0;
+	int framesOverBudget = 0;
+	int framesUnderBudget = 0;
+
+	static constexpr double smoothing = 0.1; // weight of the newest frame
+	static constexpr int warmUpFrames = 3; // frames to measure after a level change before deciding anything
+	static constexpr double stepDownSeconds = 0.25;
+	static constexpr double stepUpSeconds = 2.0;
+	static constexpr float stepUpHeadroom = 0.4f; // the next level up roughly doubles the cost, so only go up below 40% of the budget
+
+	void ChangeLevel(int newLevel) {
+		level = std::clamp(newLevel, 0, amountOfLevels - 1);
+		measuredFrames = 0;
+		framesOverBudget = 0;
+		framesUnderBudget = 0;
+	}
+
+public:
+	static const char* GetLevelName(int level) {
+		switch (level) {
+			case minimal: return "minimal";
+			case slow: return "slow";
+			case meanOnly: return "mean only";
+			case reduced: return "reduced";
+			case full: return "full";
+			default: return "unknown";
+		}
+	}
+
+	// fraction of one core the analysis may use
+	void SetBudget(float fractionOfOneCore) {
+		budget = std::max(0.001f, fractionOfOneCore);
+	}
+
+	float GetBudget() const {
+		return budget;
+	}
+
+	// when disabled the analysis always runs at full quality
+	void SetEnabled(bool shouldBeEnabled) {
+		enabled = shouldBeEnabled;
+		if (!enabled) ChangeLevel(full);
+	}
+
+	AnalysisQuality GetQuality(const GridSettings& configured, int configuredHz) const {
+		AnalysisQuality quality{};
+		quality.settings = configured;
+		quality.analysisHz = configuredHz;
+
+		if (level <= meanOnly) quality.settings.statistic = CellStatistic::mean;
+		if (level <= reduced) quality.sampleDensity = 0.5f;
+		if (level <= slow) {
+			quality.sampleDensity = 0.25f;
+			quality.analysisHz = std::max(1, configuredHz / 2);
+		}
+		if (level <= minimal) quality.analysisHz = std::max(1, configuredHz / 4);
+
+		return quality;
+	}
+
+	// call after every analysed frame with how long it took. Returns true when the level changed.
+	bool AddMeasurement(double frameSeconds, int currentHz) {
+		if (!enabled) return false;
+
+		measuredFrames++;
+		smoothedFrameSeconds = measuredFrames == 1 ? frameSeconds
+			: smoothedFrameSeconds + smoothing * (frameSeconds - smoothedFrameSeconds);
+		if (measuredFrames < warmUpFrames) return false;
+
+		const auto load = GetLoad(currentHz);
+		if (load > budget) {
+			framesOverBudget++;
+			framesUnderBudget = 0;
+		} else if (load < budget * stepUpHeadroom) {
+			framesUnderBudget++;
+			framesOverBudget = 0;
+		} else {
+			framesOverBudget = 0;
+			framesUnderBudget = 0;
+		}
+
+		const int hz = std::max(1, currentHz);
+		if (level > minimal && framesOverBudget >= std::max(2, int(stepDownSeconds * hz))) {
+			ChangeLevel(level - 1);
+			return true;
+		}
+		if (level < full && framesUnderBudget >= std::max(2, int(stepUpSeconds * hz))) {
+			ChangeLevel(level + 1);
+			return true;
+		}
+		return false;
+	}
+
+	int GetLevel() const {
+		return level;
+	}
+
+	double GetFrameSeconds() const {
+		return smoothedFrameSeconds;
+	}
+
+	float GetLoad(int currentHz) const {
+		return static_cast<float>(smoothedFrameSeconds * currentHz);
+	}
+};
+
+}
@@ -0,0 +1,195 @@
+#pragma once
+#include <JuceHeader.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include "../Commons/CellBuffer.hpp"
+#include "../Commons/ParameterNaming.hpp"
+#include "MidiScheduler.hpp"
+
+namespace HueShift {
+
+enum class CcStreamMode : uint8_t {
+	off = 0,
+	cc7,  // one controller per stream, 10 cells per channel
+	cc14, // MSB and LSB controller pairs, 4 cells per channel
+	nrpn  // NRPN number = stream index, 14 bit, everything on the first channel
+};
+
+// what the continuous colour output looks like. Plain data, so it can be handed to the audio thread through a SnapshotBuffer.
+struct CcStreamSettings {
+	CcStreamMode mode = CcStreamMode::off;
+	int firstChannel = CC_STREAM_CHANNEL; // 1-16, streams that don't fit on one channel go on the next ones, past 16 they're left out
+	float deadband = CC_STREAM_DEADBAND; // [0:1], smaller changes aren't sent
+	float maxHzPerStream = CC_STREAM_MAX_HZ;
+	float bytesPerSecond = CC_STREAM_BYTES_PER_SECOND; // shared by all streams
+};
+
+/*
+	Sends each cell's hue, saturation and brightness as three controller streams (stream index = cell * 3 + parameter).
+
+	Only meaningful changes go out: a stream sends when its value moved more than the deadband, and at most maxHzPerStream times a second.
+	On top of that all streams share a byte budget that fills up with the audio clock (a token bucket), so a big grid that changes
+	at once is spread over several blocks instead of flooding one. When the budget runs out the next block carries on with the
+	stream that didn't fit, so every stream gets its turn.
+
+	Audio thread only, doesn't allocate.
+*/
+class CcStreamer {
+private:
+	static constexpr int parametersPerCell = 3; // hue, saturation, brightness
+	static constexpr size_t amountOfStreams = MAX_VOICES * parametersPerCell;
+
+	// controllers nothing standard listens to
+	static constexpr std::array<uint8_t, 30> cc7Controllers = {
+		20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31,
+		102, 103, 104, 105, 106, 107, 108, 109, 110, 111, 112, 113, 114, 115, 116, 117, 118, 119
+	};
+	static constexpr int cc14FirstController = 20; // MSBs 20-31, their LSBs are 32 higher
+
+	struct Stream {
+		int32_t sentValue = -1; // -1 means send whatever comes next
+		uint64_t sentSample = 0;
+	};
+
+	std::array<Stream, amountOfStreams> streams{};
+	size_t cursor = 0;
+	double budgetBytes = 0.0;
+	uint64_t sampleTime = 0;
+	double sampleRate = 48000.0;
+	size_t amountOfCells = 0;
+
+	uint64_t sentMessages = 0;
+	uint64_t throttledBlocks = 0;
+
+	static int GetMaximum(CcStreamMode mode) {
+		return mode == CcStreamMode::cc7 ? 127 : 16383;
+	}
+
+	static int GetMessageBytes(CcStreamMode mode) {
+		switch (mode) {
+			case CcStreamMode::cc7: return 3;
+			case CcStreamMode::cc14: return 6;
+			case CcStreamMode::nrpn: return 12;
+			default: return 0;
+		}
+	}
+
+	static int GetValue(const Cell& cell, size_t parameter, int maximum) {
+		const auto colour = cell.GetColour();
+		const float value = parameter == 0 ? colour.getHue() : (parameter == 1 ? colour.getSaturation() : colour.getBrightness());
+		return juce::jlimit(0, maximum, juce::roundToInt(value * maximum));
+	}
+
+	// false if the stream doesn't fit on the channels there are
+	static bool Write(const CcStreamSettings& settings, size_t stream, int value, int samplePosition, MidiScheduler& output) {
+		int channel = settings.firstChannel;
+
+		switch (settings.mode) {
+			case CcStreamMode::cc7: {
+				channel += static_cast<int>(stream / cc7Controllers.size());
+				if (channel > 16) return false;
+				output.Add(juce::MidiMessage::controllerEvent(channel, cc7Controllers[stream % cc7Controllers.size()], value), samplePosition, MidiScheduler::controller);
+				return true;
+			}
+			case CcStreamMode::cc14: {
+				constexpr size_t pairsPerChannel = 12;
+				channel += static_cast<int>(stream / pairsPerChannel);
+				if (channel > 16) return false;
+				const int controller = cc14FirstController + static_cast<int>(stream % pairsPerChannel);
+				output.Add(juce::MidiMessage::controllerEvent(channel, controller, value >> 7), samplePosition, MidiScheduler::controller);
+				output.Add(juce::MidiMessage::controllerEvent(channel, controller + 32, value & 127), samplePosition, MidiScheduler::controller);
+				return true;
+			}
+			case CcStreamMode::nrpn: {
+				const int number = static_cast<int>(stream);
+				output.Add(juce::MidiMessage::controllerEvent(channel, 99, number >> 7), samplePosition, MidiScheduler::controller);
+				output.Add(juce::MidiMessage::controllerEvent(channel, 98, number & 127), samplePosition, MidiScheduler::controller);
+				output.Add(juce::MidiMessage::controllerEvent(channel, 6, value >> 7), samplePosition, MidiScheduler::controller);
+				output.Add(juce::MidiMessage::controllerEvent(channel, 38, value & 127), samplePosition, MidiScheduler::controller);
+				return true;
+			}
+			default: return false;
+		}
+	}
+
+	void ForgetSentValues() {
+		for (auto& stream : streams) stream.sentValue = -1;
+		cursor = 0;
+	}
+
+public:
+	void Reset(double newSampleRate) {
+		sampleRate = std::max(1.0, newSampleRate);
+		sampleTime = 0;
+		budgetBytes = 0.0;
+		for (auto& stream : streams) stream = Stream{};
+		cursor = 0;
+	}
+
+	void Process(const CellBuffer& cells, const CcStreamSettings& settings, int bufferSize, MidiScheduler& output) {
+		const auto blockStart = sampleTime;
+		sampleTime += static_cast<uint64_t>(std::max(0, bufferSize));
+
+		const int messageBytes = GetMessageBytes(settings.mode);
+		if (messageBytes == 0 || settings.firstChannel < 1 || settings.firstChannel > 16) {
+			ForgetSentValues(); // so turning it back on sends everything
+			budgetBytes = 0.0;
+			return;
+		}
+
+		// other indexes, other meaning
+		if (cells.size() != amountOfCells) {
+			amountOfCells = cells.size();
+			ForgetSentValues();
+		}
+
+		// the bucket holds a little more than one message, enough for one block's share, but no big bursts after quiet periods
+		const double bytesPerSecond = std::max(1.f, settings.bytesPerSecond);
+		const double capacity = std::max<double>(messageBytes, bytesPerSecond * CC_STREAM_MAX_BURST_SECONDS);
+		budgetBytes = std::min(capacity, budgetBytes + bytesPerSecond * bufferSize / sampleRate);
+
+		const int maximum = GetMaximum(settings.mode);
+		const int deadbandSteps = juce::roundToInt(juce::jlimit(0.f, 1.f, settings.deadband) * maximum);
+		const auto minimumInterval = static_cast<uint64_t>(sampleRate / std::max(0.01f, settings.maxHzPerStream));
+		const size_t streamsInUse = amountOfCells * parametersPerCell;
+		if (streamsInUse == 0) return;
+
+		cursor %= streamsInUse;
+		for (size_t n = 0; n < streamsInUse; n++) {
+			const size_t index = (cursor + n) % streamsInUse;
+			auto& stream = streams[index];
+			const int value = GetValue(cells[index / parametersPerCell], index % parametersPerCell, maximum);
+
+			if (stream.sentValue >= 0) {
+				if (std::abs(value - stream.sentValue) <= deadbandSteps) continue;
+				if (blockStart - stream.sentSample < minimumInterval) continue;
+			}
+
+			if (budgetBytes < messageBytes) {
+				cursor = index; // it's this one's turn next block
+				throttledBlocks++;
+				return;
+			}
+
+			if (!Write(settings, index, value, 0, output)) continue;
+			budgetBytes -= messageBytes;
+			stream.sentValue = value;
+			stream.sentSample = blockStart;
+			sentMessages++;
+		}
+	}
+
+	// controller messages (one per stream update, an NRPN counts once) sent since the start
+	uint64_t GetSentCount() const {
+		return sentMessages;
+	}
+
+	// blocks where the byte budget ran out and changes had to wait
+	uint64_t GetThrottledCount() const {
+		return throttledBlocks;
+	}
+};
+
+}
@@ -0,0 +1,197 @@
+#pragma once
+#include <JuceHeader.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include "../Commons/CellBuffer.hpp"
+#include "../Commons/ColorUtils.hpp"
+#include "../Commons/ParameterNaming.hpp"
+
+namespace HueShift {
+
+enum class CellSmoothingMode : uint8_t {
+	off = 0,
+	ema,   // every frame moves the colour emaAmount of the way
+	median // the per channel median of the last medianLength frames, ignores single noisy frames completely
+};
+
+// plain data, so it can be handed to the analysis thread through a SnapshotBuffer
+struct CellSmoothingSettings {
+	CellSmoothingMode mode = CellSmoothingMode::ema;
+	float emaAmount = CELL_SMOOTHING_EMA; // (0:1], 1 is no smoothing
+	int medianLength = 3; // 3 or 5 frames
+	float hysteresis = CELL_SMOOTHING_HYSTERESIS; // [0:1] hue, how far past a band's edge a cell has to go to leave it. 0 is off
+};
+
+/*
+	Keeps camera noise from flipping cells between colour bands, every flip changes a voice's frequency.
+
+	First the colours are smoothed over time, one pass per channel over flat arrays of every cell so the compiler can
+	vectorize it (the median is a min/max network, no sorting). Then each cell keeps its band until its hue is more than
+	hysteresis past the band's edge, if it's closer the hue is pulled back to the nearest point inside. Saturation and brightness
+	stay as they are, so a grey cell (where 8 bit rgb can't hold the hue) stays grey and may still change band.
+
+	Analysis thread only, doesn't allocate.
+*/
+class CellSmoother {
+private:
+	struct Channels {
+		std::array<float, MAX_VOICES> red{}, green{}, blue{};
+	};
+
+	Channels input{}, smoothed{};
+	std::array<Channels, 5> history{}; // the median's ring
+	size_t historyCursor = 0, historyFrames = 0;
+
+	std::array<uint8_t, MAX_VOICES> inputBands{}, outputBands{};
+	size_t amountOfCells = 0;
+	juce::uint32 width = 0;
+	CellSmoothingMode mode = CellSmoothingMode::off;
+	size_t medianLength = 3;
+	bool primed = false; // the arrays hold a frame of this layout
+
+	uint64_t bandChanges = 0;
+	uint64_t suppressedChanges = 0;
+
+	static float Median3(float a, float b, float c) {
+		return std::max(std::min(a, b), std::min(std::max(a, b), c));
+	}
+
+	static float Median5(float a, float b, float c, float d, float e) {
+		const float f = std::max(std::min(a, b), std::min(c, d));
+		const float g = std::min(std::max(a, b), std::max(c, d));
+		return Median3(e, f, g);
+	}
+
+	static float Wrap(float hue) {
+		return hue < 0.f ? hue + 1.f : (hue >= 1.f ? hue - 1.f : hue);
+	}
+
+	static float GetHueDistance(float a, float b) {
+		const float distance = std::abs(a - b);
+		return std::min(distance, 1.f - distance);
+	}
+
+	// the hue inside band that's closest to hue, around the circle. Red also has everything above pink.
+	static float ClampIntoBand(float hue, size_t band) {
+		if (ColorInfo::GetBandIndex(hue) == band) return hue;
+
+		const auto& colors = ColorInfo::GetColors();
+		constexpr float inset = 0.003f; // a band doesn't contain its end, and 8 bit rgb moves the hue a little
+		const float start = (band == 0 ? colors.back().hue.getEnd() - 1.f : colors[band].hue.getStart()) + inset;
+		const float end = colors[band].hue.getEnd() - inset;
+		return Wrap(GetHueDistance(hue, Wrap(start)) <= GetHueDistance(hue, end) ? start : end);
+	}
+
+	static size_t GetBand(juce::Colour colour) {
+		return ColorInfo::GetBandIndex(colour.getHue());
+	}
+
+	void Ema(std::array<float, MAX_VOICES>& value, const std::array<float, MAX_VOICES>& target, float amount) {
+		for (size_t i = 0; i < amountOfCells; i++) value[i] += (target[i] - value[i]) * amount;
+	}
+
+	void Median(std::array<float, MAX_VOICES> Channels::* channel, std::array<float, MAX_VOICES>& output, size_t length) {
+		const auto& a = history[0].*channel;
+		const auto& b = history[1].*channel;
+		const auto& c = history[2].*channel;
+		if (length == 3) {
+			for (size_t i = 0; i < amountOfCells; i++) output[i] = Median3(a[i], b[i], c[i]);
+			return;
+		}
+		const auto& d = history[3].*channel;
+		const auto& e = history[4].*channel;
+		for (size_t i = 0; i < amountOfCells; i++) output[i] = Median5(a[i], b[i], c[i], d[i], e[i]);
+	}
+
+public:
+	void Reset() {
+		historyCursor = historyFrames = 0;
+		primed = false;
+	}
+
+	void Process(CellBuffer& cells, const CellSmoothingSettings& settings) {
+		if (settings.mode == CellSmoothingMode::off && settings.hysteresis <= 0.f) {
+			Reset();
+			return;
+		}
+
+		// other cells, or a ring and averages meant for another mode: nothing to compare with
+		const size_t length = settings.medianLength >= 5 ? 5 : 3;
+		if (cells.size() != amountOfCells || cells.width != width || settings.mode != mode || length != medianLength) {
+			amountOfCells = cells.size();
+			width = cells.width;
+			mode = settings.mode;
+			medianLength = length;
+			Reset();
+		}
+
+		// [1] the colours as flat arrays
+		for (size_t i = 0; i < amountOfCells; i++) {
+			const auto argb = cells[i].argb;
+			input.red[i] = static_cast<float>((argb >> 16) & 0xff);
+			input.green[i] = static_cast<float>((argb >> 8) & 0xff);
+			input.blue[i] = static_cast<float>(argb & 0xff);
+		}
+
+		// [2] smoothing over time
+		if (settings.mode == CellSmoothingMode::median) {
+			history[historyCursor] = input;
+			historyCursor = (historyCursor + 1) % medianLength;
+			historyFrames = std::min(historyFrames + 1, medianLength);
+		}
+
+		if (!primed || settings.mode == CellSmoothingMode::off) {
+			smoothed = input;
+		} else if (settings.mode == CellSmoothingMode::ema) {
+			const float amount = juce::jlimit(0.01f, 1.f, settings.emaAmount);
+			Ema(smoothed.red, input.red, amount);
+			Ema(smoothed.green, input.green, amount);
+			Ema(smoothed.blue, input.blue, amount);
+		} else if (historyFrames < medianLength) {
+			smoothed = input; // not enough frames yet
+		} else {
+			Median(&Channels::red, smoothed.red, medianLength);
+			Median(&Channels::green, smoothed.green, medianLength);
+			Median(&Channels::blue, smoothed.blue, medianLength);
+		}
+
+		// [3] band hysteresis, per cell
+		const float margin = juce::jlimit(0.f, 0.5f, settings.hysteresis);
+		for (size_t i = 0; i < amountOfCells; i++) {
+			const auto inputBand = static_cast<uint8_t>(GetBand(cells[i].GetColour()));
+			auto colour = juce::Colour(
+				static_cast<juce::uint8>(juce::jlimit(0.f, 255.f, smoothed.red[i] + 0.5f)),
+				static_cast<juce::uint8>(juce::jlimit(0.f, 255.f, smoothed.green[i] + 0.5f)),
+				static_cast<juce::uint8>(juce::jlimit(0.f, 255.f, smoothed.blue[i] + 0.5f))
+			);
+			auto band = static_cast<uint8_t>(GetBand(colour));
+
+			if (primed && band != outputBands[i] && margin > 0.f) {
+				const float hue = colour.getHue();
+				const float inside = ClampIntoBand(hue, outputBands[i]);
+				if (GetHueDistance(hue, inside) <= margin) {
+					colour = juce::Colour::fromHSV(inside, colour.getSaturation(), colour.getBrightness(), 1.f);
+					band = static_cast<uint8_t>(GetBand(colour));
+				}
+			}
+
+			if (primed) {
+				bandChanges += band != outputBands[i] ? 1 : 0;
+				suppressedChanges += inputBand != inputBands[i] && band == outputBands[i] ? 1 : 0;
+			}
+			inputBands[i] = inputBand;
+			outputBands[i] = band;
+			cells[i].SetColour(colour);
+		}
+
+		primed = true;
+	}
+
+	// band changes that went out, and the ones in the analysed colours that the smoothing held back. Analysis thread only.
+	uint64_t GetBandChangeCount() const { return bandChanges; }
+	uint64_t GetSuppressedCount() const { return suppressedChanges; }
+};
+
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include <JuceHeader.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include "../Commons/ParameterNaming.hpp"
+
+namespace HueShift {
+
+enum class WhiteBalanceMode : uint8_t {
+	off = 0,
+	greyWorld,     // the frame's average colour is taken to be grey
+	referencePatch // a part of the frame that is known to be grey or white, a card or a wall
+};
+
+// how the analysis undoes the camera's auto exposure and white balance drifting, and the lights changing temperature.
+// Plain data, so it can be handed to the analysis thread through a SnapshotBuffer.
+struct ColourCorrectionSettings {
+	WhiteBalanceMode whiteBalance = WhiteBalanceMode::off;
+	bool normaliseExposure = false; // keeps the frame's (or the patch's) brightness at targetLuma
+	bool subtractBlack = false; // pulls the darkest part of the frame down to black, against haze and a lifted black level
+	float targetLuma = COLOUR_CORRECTION_TARGET_LUMA; // 0-255
+	float maxGain = COLOUR_CORRECTION_MAX_GAIN; // per channel, 1 / maxGain the other way
+	float adaptation = COLOUR_CORRECTION_ADAPTATION; // (0:1], how much of the way to the new correction one frame goes
+	juce::Rectangle<float> referencePatch{0.45f, 0.45f, 0.1f, 0.1f}; // in [0:1] frame coordinates
+
+	bool IsOff() const {
+		return whiteBalance == WhiteBalanceMode::off && !normaliseExposure && !subtractBlack;
+	}
+};
+
+// what the analysis applies to every pixel it reads: value * gain + offset, per channel (r, g, b)
+struct ColourCorrection {
+	std::array<float, 3> gain{1.f, 1.f, 1.f};
+	std::array<float, 3> offset{0.f, 0.f, 0.f};
+
+	float Undo(float value, size_t channel) const {
+		return (value - offset[channel]) / gain[channel];
+	}
+};
+
+// global numbers about one frame, collected while the cells are analysed so they cost no extra pass.
+// Everything is in corrected values (what the cells saw) except the patch, which is read raw.
+struct FrameStatistics {
+	std::array<double, 3> sum{};
+	double pixels = 0.0;
+	std::array<float, 3> darkest{255.f, 255.f, 255.f}; // per channel, the darkest block mean
+	int blocks = 0; // a frame of sparse samples and previews may have none, darkest means nothing then
+	std::array<double, 3> patchSum{};
+	double patchPixels = 0.0;
+
+	void AddSums(double r, double g, double b, double amountOfPixels) {
+		sum[0] += r; sum[1] += g; sum[2] += b;
+		pixels += amountOfPixels;
+	}
+
+	void AddBlock(float r, float g, float b) {
+		darkest[0] = std::min(darkest[0], r);
+		darkest[1] = std::min(darkest[1], g);
+		darkest[2] = std::min(darkest[2], b);
+		blocks++;
+	}
+};
+
+/*
+	Works out the correction for the next frame from the statistics of the last one. The one frame delay doesn't matter,
+	the correction is smoothed over several frames anyway so it doesn't pump with every shadow walking through.
+
+	- black: the darkest block, capped at COLOUR_CORRECTION_MAX_BLACK, becomes 0. Without any block it stays where it is.
+	- white balance: every channel gets the gain that makes the reference (frame average or patch) grey.
+	- exposure: on top of that, one gain for all channels that brings the reference's brightness to the target.
+*/
+class ColourNormaliser {
+private:
+	ColourCorrection current{};
+
+	static float GetLuma(const std::array<float, 3>& rgb) {
+		return 0.299f * rgb[0] + 0.587f * rgb[1] + 0.114f * rgb[2];
+	}
+
+public:
+	const ColourCorrection& Get() const {
+		return current;
+	}
+
+	void Reset() {
+		current = ColourCorrection{};
+	}
+
+	void Update(const FrameStatistics& frame, const ColourCorrectionSettings& settings) {
+		if (settings.IsOff()) {
+			Reset();
+			return;
+		}
+		if (frame.pixels <= 0.0) return;
+		if (settings.whiteBalance == WhiteBalanceMode::referencePatch && frame.patchPixels <= 0.0) return;
+
+		// what the camera delivered, before the correction
+		std::array<float, 3> black{}, reference{};
+		for (size_t c = 0; c < 3; c++) {
+			if (settings.subtractBlack) {
+				black[c] = frame.blocks > 0 ? juce::jlimit(0.f, COLOUR_CORRECTION_MAX_BLACK, current.Undo(frame.darkest[c], c))
+					: -current.offset[c] / current.gain[c]; // nothing to go by, keep the black level there is
+			}
+			reference[c] = settings.whiteBalance == WhiteBalanceMode::referencePatch
+				? static_cast<float>(frame.patchSum[c] / frame.patchPixels)
+				: current.Undo(static_cast<float>(frame.sum[c] / frame.pixels), c);
+			reference[c] = std::max(1.f, reference[c] - black[c]);
+		}
+
+		const float referenceLuma = GetLuma(reference);
+		const float exposure = settings.normaliseExposure ? settings.targetLuma / referenceLuma : 1.f;
+		const float maxGain = std::max(1.f, settings.maxGain);
+		const float adaptation = juce::jlimit(0.f, 1.f, settings.adaptation);
+
+		for (size_t c = 0; c < 3; c++) {
+			const float balance = settings.whiteBalance != WhiteBalanceMode::off ? referenceLuma / reference[c] : 1.f;
+			const float gain = juce::jlimit(1.f / maxGain, maxGain, balance * exposure);
+			const float offset = -black[c] * gain;
+
+			current.gain[c] += (gain - current.gain[c]) * adaptation;
+			current.offset[c] += (offset - current.offset[c]) * adaptation;
+		}
+	}
+};
+
+}
@@ -0,0 +1,619 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+#include <cmath>
+#include <bitset>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "../Commons/CellBuffer.hpp"
+#include "../Commons/ColorUtils.hpp"
+#include "../Commons/PluginState.hpp"
+#include "RegionMask.hpp"
+#include "ColourCorrection.hpp"
+#include "YuvAnalysis.hpp"
+
+namespace HueShift {
+
+// where the colour channels sit inside one pixel of a juce::Image
+struct PixelLayout {
+	int pixelStride = 4;
+	int red = 2, green = 1, blue = 0;
+
+	static PixelLayout FromBitmap(const juce::Image::BitmapData& bitmap) {
+		PixelLayout layout{};
+		layout.pixelStride = bitmap.pixelStride;
+
+		if (bitmap.pixelFormat == juce::Image::SingleChannel) {
+			layout.red = layout.green = layout.blue = 0;
+		}
+	#if JUCE_MAC
+		else if (bitmap.pixelFormat == juce::Image::RGB) {
+			layout.red = 0; layout.green = 1; layout.blue = 2;
+		}
+	#endif
+		// ARGB (and RGB on windows and linux) is stored as b, g, r(, a) in memory
+
+		return layout;
+	}
+};
+
+// reads the pixels of a juce::Image, see YuvReader for the other kind of frame
+struct ImageReader {
+	const juce::Image::BitmapData& bitmap;
+	PixelLayout layout;
+	const ColourCorrection& correction;
+
+	int GetWidth() const { return bitmap.width; }
+	int GetHeight() const { return bitmap.height; }
+
+	// the corrected colour of one pixel
+	void ReadPixel(int x, int y, float& r, float& g, float& b) const {
+		const auto* pixel = bitmap.getPixelPointer(x, y);
+		r = pixel[layout.red] * correction.gain[0] + correction.offset[0];
+		g = pixel[layout.green] * correction.gain[1] + correction.offset[1];
+		b = pixel[layout.blue] * correction.gain[2] + correction.offset[2];
+	}
+
+	// adds the uncorrected colours of the pixels [x0:x1) in row y
+	void AddRawPixels(int x0, int x1, int y, std::array<double, 3>& sum) const {
+		const auto* pixel = bitmap.getPixelPointer(x0, y);
+		for (int x = x0; x < x1; x++, pixel += layout.pixelStride) {
+			sum[0] += pixel[layout.red];
+			sum[1] += pixel[layout.green];
+			sum[2] += pixel[layout.blue];
+		}
+	}
+};
+
+// what one cell votes for, per ColorInfo band
+struct HueHistogram {
+	std::array<float, 8> weights{};
+	float total = 0.f;
+
+	size_t GetDominantBand() const {
+		size_t best = 0;
+		for (size_t i = 1; i < weights.size(); i++) {
+			if (weights[i] > weights[best]) best = i;
+		}
+		return best;
+	}
+
+	// [0:1], how much of the cell's colour agrees with the band
+	float GetConfidence(size_t band) const {
+		return total > 0.f ? weights[band] / total : 0.f;
+	}
+};
+
+// the previous frame's brightness, downsampled to the mean luma of MOTION_BLOCK_PIXELS wide blocks along every analysed row.
+// Blocks are numbered in the order the analysis visits them, which stays the same as long as the layout does.
+struct MotionMemory {
+	std::array<uint8_t, MOTION_MAX_BLOCKS> previous{};
+	size_t nextBlock = 0;
+	bool valid = false; // nothing to compare with on the first frame after the layout changed
+	juce::uint64 layoutKey = 0;
+
+	// returns the absolute difference to the same block last frame, and remembers the new value
+	float Compare(float luma) {
+		if (nextBlock >= previous.size()) return 0.f; // a huge frame, the rest goes without motion
+		auto& stored = previous[nextBlock++];
+		const auto value = static_cast<uint8_t>(juce::jlimit(0.f, 255.f, luma)); // corrected pixels can leave [0:255]
+		const float difference = std::abs(static_cast<float>(value) - static_cast<float>(stored));
+		stored = value;
+		return difference;
+	}
+};
+
+/*
+	Turns a camera image into one colour per grid cell.
+
+	mean:        averages samplePoints pixels spread over the cell. Cheap, but a half red half blue cell comes out magenta.
+	dominantHue: looks at every pixel of the cell and builds a histogram over the ColorInfo bands, weighted by
+	             saturation * value (which is just the chroma, max - min). The cell gets the winning band's colour.
+
+	Instead of the uniform grid, user drawn regions (see RegionMask.hpp) can be analysed with either statistic.
+
+	Cells nobody needs in full this frame (see CellDemand) only get a preview, the mean of a few samples,
+	so the cost of a frame follows the amount of cells that are actually played.
+
+	Every cell also gets its motion: how much the brightness changed since the last frame, compared block by block
+	on the pixels the statistic looks at anyway, so it costs a few more operations per pixel and no extra pass.
+
+	The colour correction (see ColourCorrection.hpp) works the same way: every pixel is corrected as it is read,
+	and the frame statistics for the next frame's correction are summed up from what the cells collected.
+	Only the reference patch is read on its own, and only when it is used.
+
+	Frames come as a juce::Image or as the camera's own yuv planes (see YuvFrame.hpp). The yuv kernels stay in y, cb, cr:
+	sums of raw bytes are transformed once per chunk, and the hue comes out of a cb, cr lookup (see YuvAnalysis.hpp).
+*/
+class GridAnalyser {
+private:
+	static constexpr int hueLookupSize = 768; // hue resolution of the band lookup, 128 steps per sextant
+	static constexpr int chunkSize = 64; // pixels per inner loop, small enough for the scratch arrays to stay on the stack
+	static constexpr float minimumAverageChroma = 4.f; // below this a cell is grey and the hue is noise, so the mean is used
+
+	std::array<uint8_t, hueLookupSize + 1> hueToBand{};
+	ChromaLookup chromaLookup{};
+	double lastAnalysisSeconds = 0.0;
+	MotionMemory motion{};
+	bool motionEnabled = true; // see SetMotion
+
+	ColourCorrectionSettings correctionSettings{};
+	ColourNormaliser normaliser{};
+	ColourCorrection correction{}; // this frame's, fixed while it is being analysed
+	FrameStatistics frameStatistics{};
+
+	static float GetLuma(float r, float g, float b) {
+		return 0.299f * r + 0.587f * g + 0.114f * b;
+	}
+
+	// [0:1], the mean block difference in 8 bit luma steps scaled down
+	float GetMotion(float differenceSum, int blocks) const {
+		if (!motion.valid || blocks == 0) return 0.f;
+		return std::min(1.f, differenceSum / (255.f * blocks));
+	}
+
+	// statisticsWeight scales what the samples count for in the frame statistics, so a preview weighs as much as a full cell
+	template <typename Reader>
+	juce::Colour MeanOfSamples(const Reader& reader,
+		int x, int y, int cellWidth, int cellHeight, unsigned int samplePoints, float& cellMotion, double statisticsWeight = 1.0)
+	{
+		cellMotion = 0.f;
+		const int sectionPixelAmount = cellWidth * cellHeight;
+		if (sectionPixelAmount <= 0 || samplePoints == 0) return juce::Colours::black;
+
+		const int addPerSample = sectionPixelAmount / static_cast<int>(samplePoints);
+		float r{}, g{}, b{};
+		int amount{};
+		float motionSum = 0.f;
+		float chunkR = 0.f, chunkG = 0.f, chunkB = 0.f; // the black level only takes means of MOTION_BLOCK_PIXELS samples, like AccumulateRun
+		int chunk = 0;
+
+		for (unsigned int sample = 0; sample < samplePoints; sample++) {
+			const int offset = static_cast<int>(sample) * addPerSample;
+			if (offset >= sectionPixelAmount) break;
+
+			const int addX = offset % cellWidth;
+			const int addY = offset / cellWidth;
+
+			float sampleR, sampleG, sampleB;
+			reader.ReadPixel(x + addX, y + addY, sampleR, sampleG, sampleB);
+			r += sampleR; g += sampleG; b += sampleB;
+			amount++;
+
+			// the samples are too far apart for blocks, every sample is its own
+			if (motionEnabled) motionSum += motion.Compare(GetLuma(sampleR, sampleG, sampleB));
+
+			chunkR += sampleR; chunkG += sampleG; chunkB += sampleB;
+			if (++chunk == MOTION_BLOCK_PIXELS) {
+				frameStatistics.AddBlock(chunkR / chunk, chunkG / chunk, chunkB / chunk);
+				chunkR = chunkG = chunkB = 0.f;
+				chunk = 0;
+			}
+		}
+		// the rest (and a preview's few samples) are too few for a black level, a single noisy one would win
+
+		if (amount == 0) return juce::Colours::black;
+		frameStatistics.AddSums(r * statisticsWeight, g * statisticsWeight, b * statisticsWeight, amount * statisticsWeight);
+		cellMotion = GetMotion(motionSum, amount);
+		return juce::Colour(ToByte(r / amount), ToByte(g / amount), ToByte(b / amount));
+	}
+
+	static juce::uint8 ToByte(double value) {
+		return static_cast<juce::uint8>(juce::jlimit(0.0, 255.0, value));
+	}
+
+	// sums of one cell or region while its pixels are being visited
+	struct CellAccumulator {
+		HueHistogram histogram{};
+		double sumR = 0.0, sumG = 0.0, sumB = 0.0;
+		int pixels = 0;
+		float motionSum = 0.f;
+		int motionBlocks = 0;
+	};
+
+	// one pass over a run of consecutive pixels. The first inner loop has no branches or cross-pixel dependencies
+	// so the compiler can vectorize it (that includes the colour correction, one multiply add per channel),
+	// the second one is the (cheap) scatter into the 8 band bins, the third sums the lumas into motion blocks
+	// and compares them with the last frame.
+	template <bool withHistogram>
+	void AccumulateRun(const ImageReader& reader, int x, int y, int amountOfPixels, CellAccumulator& accumulator) {
+		static_assert(chunkSize % MOTION_BLOCK_PIXELS == 0, "motion blocks can't cross chunks");
+		const auto& layout = reader.layout;
+		const auto* line = reader.bitmap.getPixelPointer(x, y);
+		const int stride = layout.pixelStride;
+		const float binsPerSextant = hueLookupSize / 6.f;
+		const float gainR = correction.gain[0], gainG = correction.gain[1], gainB = correction.gain[2];
+		const float offsetR = correction.offset[0], offsetG = correction.offset[1], offsetB = correction.offset[2];
+
+		int bins[chunkSize];
+		float weights[chunkSize];
+		float lumas[chunkSize];
+
+		for (int start = 0; start < amountOfPixels; start += chunkSize) {
+			const int amount = std::min(chunkSize, amountOfPixels - start);
+			const uint8_t* pixels = line + start * stride;
+			float chunkR = 0.f, chunkG = 0.f, chunkB = 0.f;
+
+			for (int i = 0; i < amount; i++) {
+				const float r = pixels[i * stride + layout.red] * gainR + offsetR;
+				const float g = pixels[i * stride + layout.green] * gainG + offsetG;
+				const float b = pixels[i * stride + layout.blue] * gainB + offsetB;
+				chunkR += r; chunkG += g; chunkB += b;
+				lumas[i] = GetLuma(r, g, b);
+
+				if constexpr (withHistogram) {
+					const float maximum = std::max(r, std::max(g, b));
+					const float minimum = std::min(r, std::min(g, b));
+					const float chroma = maximum - minimum;
+					const float inverse = chroma > 0.f ? 1.f / chroma : 0.f;
+
+					float hue = maximum == r ? (g - b) * inverse
+						: (maximum == g ? 2.f + (b - r) * inverse : 4.f + (r - g) * inverse); // [-1:6)
+					hue = hue < 0.f ? hue + 6.f : hue;
+
+					bins[i] = static_cast<int>(hue * binsPerSextant);
+					weights[i] = chroma;
+				}
+			}
+
+			if constexpr (withHistogram) {
+				for (int i = 0; i < amount; i++) {
+					accumulator.histogram.weights[hueToBand[bins[i]]] += weights[i];
+				}
+			}
+
+			// a partial block at the end of a run is left out
+			for (int block = 0; motionEnabled && block + MOTION_BLOCK_PIXELS <= amount; block += MOTION_BLOCK_PIXELS) {
+				float blockLuma = 0.f;
+				for (int i = block; i < block + MOTION_BLOCK_PIXELS; i++) blockLuma += lumas[i];
+				accumulator.motionSum += motion.Compare(blockLuma * (1.f / MOTION_BLOCK_PIXELS));
+				accumulator.motionBlocks++;
+			}
+
+			// too few pixels for a black level, a single noisy one would win
+			if (amount >= MOTION_BLOCK_PIXELS) frameStatistics.AddBlock(chunkR / amount, chunkG / amount, chunkB / amount);
+
+			accumulator.sumR += chunkR; accumulator.sumG += chunkG; accumulator.sumB += chunkB;
+		}
+
+		accumulator.pixels += amountOfPixels;
+	}
+
+	// the same for yuv. The sums and the motion blocks stay raw until the end of a chunk or block, then get transformed,
+	// only the histogram needs every pixel's corrected cb and cr.
+	template <bool withHistogram>
+	void AccumulateRun(const YuvReader& reader, int x, int y, int amountOfPixels, CellAccumulator& accumulator) {
+		const auto& transform = reader.corrected;
+
+		float lumas[chunkSize];
+		float cbs[chunkSize];
+		float crs[chunkSize];
+		int entries[chunkSize];
+
+		for (int start = 0; start < amountOfPixels; start += chunkSize) {
+			const int amount = std::min(chunkSize, amountOfPixels - start);
+			reader.ReadRun(x + start, y, amount, lumas, cbs, crs);
+
+			float chunkY = 0.f, chunkCb = 0.f, chunkCr = 0.f;
+			for (int i = 0; i < amount; i++) {
+				chunkY += lumas[i]; chunkCb += cbs[i]; chunkCr += crs[i];
+			}
+
+			if constexpr (withHistogram) {
+				for (int i = 0; i < amount; i++) {
+					const float cb = YccTransform::Apply(transform.ycc[1], lumas[i], cbs[i], crs[i]);
+					const float cr = YccTransform::Apply(transform.ycc[2], lumas[i], cbs[i], crs[i]);
+					entries[i] = ChromaLookup::GetIndex(cb, cr);
+				}
+				for (int i = 0; i < amount; i++) {
+					accumulator.histogram.weights[chromaLookup.GetBand(entries[i])] += chromaLookup.GetChroma(entries[i]);
+				}
+			}
+
+			// corrected y is the same luma the rgb kernel compares
+			for (int block = 0; motionEnabled && block + MOTION_BLOCK_PIXELS <= amount; block += MOTION_BLOCK_PIXELS) {
+				float blockY = 0.f, blockCb = 0.f, blockCr = 0.f;
+				for (int i = block; i < block + MOTION_BLOCK_PIXELS; i++) {
+					blockY += lumas[i]; blockCb += cbs[i]; blockCr += crs[i];
+				}
+				accumulator.motionSum += motion.Compare(YccTransform::Apply(transform.ycc[0], blockY, blockCb, blockCr, MOTION_BLOCK_PIXELS) * (1.f / MOTION_BLOCK_PIXELS));
+				accumulator.motionBlocks++;
+			}
+
+			const auto chunkPixels = static_cast<float>(amount);
+			const float chunkR = YccTransform::Apply(transform.rgb[0], chunkY, chunkCb, chunkCr, chunkPixels);
+			const float chunkG = YccTransform::Apply(transform.rgb[1], chunkY, chunkCb, chunkCr, chunkPixels);
+			const float chunkB = YccTransform::Apply(transform.rgb[2], chunkY, chunkCb, chunkCr, chunkPixels);
+			if (amount >= MOTION_BLOCK_PIXELS) frameStatistics.AddBlock(chunkR / amount, chunkG / amount, chunkB / amount);
+
+			accumulator.sumR += chunkR; accumulator.sumG += chunkG; accumulator.sumB += chunkB;
+		}
+
+		accumulator.pixels += amountOfPixels;
+	}
+
+	juce::Colour GetMean(const CellAccumulator& accumulator) const {
+		const int pixelAmount = std::max(1, accumulator.pixels);
+		return juce::Colour(
+			ToByte(accumulator.sumR / pixelAmount),
+			ToByte(accumulator.sumG / pixelAmount),
+			ToByte(accumulator.sumB / pixelAmount)
+		);
+	}
+
+	juce::Colour GetDominantHue(CellAccumulator& accumulator, float& confidence) const {
+		auto& histogram = accumulator.histogram;
+		const auto mean = GetMean(accumulator);
+
+		histogram.total = 0.f;
+		for (auto weight : histogram.weights) histogram.total += weight;
+		if (histogram.total < minimumAverageChroma * std::max(1, accumulator.pixels)) {
+			confidence = 0.f;
+			return mean;
+		}
+
+		const auto band = histogram.GetDominantBand();
+		confidence = histogram.GetConfidence(band);
+
+		// keep the look of the cell but move it to the middle of the band. Saturation and brightness are kept
+		// above a quarter so the hue survives the trip through 8 bit rgb into ColorInfo::GetClosestColor.
+		return juce::Colour::fromHSV(
+			ColorInfo::GetColors()[band].GetCentreHue(),
+			std::max(mean.getSaturation(), 0.25f),
+			std::max(mean.getBrightness(), 0.25f),
+			1.f
+		);
+	}
+
+	template <typename Reader>
+	juce::Colour DominantHue(const Reader& reader,
+		int x, int y, int cellWidth, int cellHeight, int rowStep, float& confidence, float& cellMotion)
+	{
+		CellAccumulator accumulator{};
+		for (int row = y; row < y + cellHeight; row += rowStep) {
+			AccumulateRun<true>(reader, x, row, cellWidth, accumulator);
+		}
+		frameStatistics.AddSums(accumulator.sumR, accumulator.sumG, accumulator.sumB, accumulator.pixels);
+		cellMotion = GetMotion(accumulator.motionSum, accumulator.motionBlocks);
+		return GetDominantHue(accumulator, confidence);
+	}
+
+	template <typename Reader>
+	void AccumulateRegion(const Reader& reader,
+		const CompiledRegions& regions, size_t region, int rowStep, bool withHistogram, CellAccumulator& accumulator)
+	{
+		for (auto span = regions.SpansBegin(region); span != regions.SpansEnd(region); span++) {
+			if (span->y % rowStep != 0) continue;
+
+			if (withHistogram) AccumulateRun<true>(reader, span->x0, span->y, span->x1 - span->x0, accumulator);
+			else AccumulateRun<false>(reader, span->x0, span->y, span->x1 - span->x0, accumulator);
+		}
+	}
+
+	// a tight gather over the region's spans, so the cost only depends on the area the region covers.
+	// A preview is the mean of every ANALYSIS_PREVIEW_ROW_STEP th row.
+	template <typename Reader>
+	juce::Colour AnalyseRegion(const Reader& reader,
+		const CompiledRegions& regions, size_t region, CellStatistic statistic, int rowStep, bool preview, float& confidence, float& cellMotion)
+	{
+		CellAccumulator accumulator{};
+		const bool withHistogram = statistic == CellStatistic::dominantHue && !preview;
+		int step = preview ? rowStep * ANALYSIS_PREVIEW_ROW_STEP : rowStep;
+
+		AccumulateRegion(reader, regions, region, step, withHistogram, accumulator);
+		if (accumulator.pixels == 0 && step != rowStep) { // thinner than the preview's rows
+			step = rowStep;
+			AccumulateRegion(reader, regions, region, step, withHistogram, accumulator);
+		}
+
+		const double weight = static_cast<double>(step / rowStep);
+		frameStatistics.AddSums(accumulator.sumR * weight, accumulator.sumG * weight, accumulator.sumB * weight, accumulator.pixels * weight);
+
+		cellMotion = GetMotion(accumulator.motionSum, accumulator.motionBlocks);
+		if (withHistogram) return GetDominantHue(accumulator, confidence);
+
+		confidence = preview ? 0.f : 1.f;
+		return GetMean(accumulator);
+	}
+
+	// one row with a column per region
+	template <typename Reader>
+	void AnalyseRegions(const Reader& reader, const CompiledRegions& regions,
+		CellStatistic statistic, int rowStep, const CellDemand* demand, CellBuffer& output)
+	{
+		// compiled for another frame size, wait for the compiler to catch up instead of reading out of bounds.
+		if (regions.width != reader.GetWidth() || regions.height != reader.GetHeight()) return;
+
+		for (size_t region = 0; region < output.size(); region++) {
+			auto& cell = output[region];
+			const bool preview = demand != nullptr && !demand->full[region];
+			cell.SetColour(AnalyseRegion(reader, regions, region, statistic, rowStep, preview, cell.confidence, cell.motion));
+		}
+	}
+
+	// the blocks are only comparable to last frame's if the same pixels get visited in the same order.
+	// So a cell switching between preview and full costs every cell one frame of motion.
+	void BeginMotion(int width, int height, const GridSettings& settings, int rowStep, const CompiledRegions* regions, const CellDemand* demand) {
+		auto key = static_cast<juce::uint64>(width) * 0x9e3779b1u + static_cast<juce::uint64>(height);
+		const auto demandKey = demand != nullptr ? std::hash<std::bitset<MAX_VOICES>>{}(demand->full) : 0;
+		for (const juce::uint64 value : { juce::uint64(settings.widthDivision), juce::uint64(settings.heightDivision), juce::uint64(settings.samplePoints),
+			juce::uint64(settings.statistic), juce::uint64(rowStep), juce::uint64(reinterpret_cast<uintptr_t>(regions)), juce::uint64(demandKey) })
+		{
+			key = key * 0x100000001b3ull ^ value;
+		}
+
+		if (key != motion.layoutKey) {
+			motion.layoutKey = key;
+			motion.valid = false;
+		}
+		motion.nextBlock = 0;
+	}
+
+	// the raw mean of the reference patch, a small gather over just its pixels
+	template <typename Reader>
+	void MeasurePatch(const Reader& reader, int rowStep) {
+		const auto& patch = correctionSettings.referencePatch;
+		const int width = reader.GetWidth(), height = reader.GetHeight();
+		const int x0 = juce::jlimit(0, width, static_cast<int>(patch.getX() * width));
+		const int x1 = juce::jlimit(x0, width, static_cast<int>(patch.getRight() * width));
+		const int y0 = juce::jlimit(0, height, static_cast<int>(patch.getY() * height));
+		const int y1 = juce::jlimit(y0, height, static_cast<int>(patch.getBottom() * height));
+
+		for (int y = y0; y < y1; y += rowStep) {
+			reader.AddRawPixels(x0, x1, y, frameStatistics.patchSum);
+			frameStatistics.patchPixels += x1 - x0;
+		}
+	}
+
+	// this frame's statistics become the next frame's correction
+	template <typename Reader>
+	void FinishCorrection(const Reader& reader, int rowStep) {
+		if (correctionSettings.whiteBalance == WhiteBalanceMode::referencePatch) MeasurePatch(reader, rowStep);
+		normaliser.Update(frameStatistics, correctionSettings);
+	}
+
+	// no picture, only the layout
+	void AnalyseNothing(const GridSettings& settings, CellBuffer& output, const CompiledRegions* regions) {
+		output.frameIndex++;
+		if (regions != nullptr) output.Resize(static_cast<juce::uint32>(regions->GetAmountOfRegions()), 1);
+		else output.Resize(std::max(1u, settings.widthDivision), std::max(1u, settings.heightDivision));
+		motion.valid = false;
+		lastAnalysisSeconds = 0.0;
+	}
+
+	// everything after the pixels were found, correction has to be set already
+	template <typename Reader>
+	void AnalyseFrame(const Reader& reader, const GridSettings& settings, CellBuffer& output,
+		float sampleDensity, const CompiledRegions* regions, const CellDemand* demand)
+	{
+		const auto startTicks = juce::Time::getHighResolutionTicks();
+		sampleDensity = juce::jlimit(0.01f, 1.f, sampleDensity);
+		const int rowStep = std::max(1, juce::roundToInt(1.f / sampleDensity));
+		output.frameIndex++;
+		BeginMotion(reader.GetWidth(), reader.GetHeight(), settings, rowStep, regions, demand);
+		frameStatistics = FrameStatistics{};
+
+		if (regions != nullptr) {
+			output.Resize(static_cast<juce::uint32>(regions->GetAmountOfRegions()), 1);
+			AnalyseRegions(reader, *regions, settings.statistic, rowStep, demand, output);
+			FinishCorrection(reader, rowStep);
+			motion.valid = motionEnabled;
+			lastAnalysisSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+			return;
+		}
+
+		output.Resize(std::max(1u, settings.widthDivision), std::max(1u, settings.heightDivision));
+		const int widthDivision = static_cast<int>(output.width);
+		const int heightDivision = static_cast<int>(output.height);
+
+		const int pixelsPerWidth = reader.GetWidth() / widthDivision;
+		const int pixelsPerHeight = reader.GetHeight() / heightDivision;
+
+		const auto samplePoints = std::max(1u, static_cast<unsigned int>(settings.samplePoints * sampleDensity));
+
+		// a preview stands in for a whole cell in the frame statistics, see MeanOfSamples
+		const auto previewSamples = std::min(samplePoints, static_cast<unsigned int>(ANALYSIS_PREVIEW_SAMPLES));
+		const double fullSamples = settings.statistic == CellStatistic::dominantHue
+			? static_cast<double>(pixelsPerWidth) * ((pixelsPerHeight + rowStep - 1) / rowStep) : static_cast<double>(samplePoints);
+		const double previewWeight = fullSamples / previewSamples;
+
+		for (int h = 0; h < heightDivision; h++) {
+			for (int w = 0; w < widthDivision; w++) {
+				const int x = w * pixelsPerWidth;
+				const int y = h * pixelsPerHeight;
+				auto& cell = output.at(h, w);
+
+				if (demand != nullptr && !demand->full[static_cast<size_t>(h * widthDivision + w)]) {
+					cell.SetColour(MeanOfSamples(reader, x, y, pixelsPerWidth, pixelsPerHeight, previewSamples, cell.motion, previewWeight));
+					cell.confidence = 0.f;
+				} else if (settings.statistic == CellStatistic::dominantHue) {
+					cell.SetColour(DominantHue(reader, x, y, pixelsPerWidth, pixelsPerHeight, rowStep, cell.confidence, cell.motion));
+				} else {
+					cell.SetColour(MeanOfSamples(reader, x, y, pixelsPerWidth, pixelsPerHeight, samplePoints, cell.motion));
+					cell.confidence = 1.f;
+				}
+			}
+		}
+
+		FinishCorrection(reader, rowStep);
+		motion.valid = motionEnabled;
+		lastAnalysisSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+	}
+
+public:
+	GridAnalyser() {
+		for (int i = 0; i <= hueLookupSize; i++) {
+			const float hue = std::min((i + 0.5f) / hueLookupSize, 1.f);
+			hueToBand[i] = static_cast<uint8_t>(ColorInfo::GetBandIndex(hue));
+		}
+	}
+
+	// output is resized to widthDivision x heightDivision (clamped to MAX_VOICES cells) and filled row major.
+	// sampleDensity (0:1] scales how many pixels get looked at: samplePoints for the mean, rows for the dominant hue and regions.
+	// With regions the grid settings' divisions are ignored and output is a single row with one cell per region.
+	// With a demand only the cells it asks for get the statistic, the rest get a preview (confidence 0). nullptr means every cell.
+	// Doesn't allocate.
+	void Analyse(const juce::Image& img, const GridSettings& settings, CellBuffer& output,
+		float sampleDensity = 1.f, const CompiledRegions* regions = nullptr, const CellDemand* demand = nullptr)
+	{
+		if (!img.isValid()) {
+			AnalyseNothing(settings, output, regions);
+			return;
+		}
+
+		correction = normaliser.Get();
+		const juce::Image::BitmapData bitmap(img, juce::Image::BitmapData::readOnly);
+		AnalyseFrame(ImageReader{bitmap, PixelLayout::FromBitmap(bitmap), correction}, settings, output, sampleDensity, regions, demand);
+	}
+
+	// the same straight from the camera's yuv planes, comes out the same as analysing the frame converted to rgb
+	void Analyse(const YuvFrameView& frame, const GridSettings& settings, CellBuffer& output,
+		float sampleDensity = 1.f, const CompiledRegions* regions = nullptr, const CellDemand* demand = nullptr)
+	{
+		if (!frame.IsValid()) {
+			AnalyseNothing(settings, output, regions);
+			return;
+		}
+
+		correction = normaliser.Get();
+		AnalyseFrame(YuvReader(frame, correction), settings, output, sampleDensity, regions, demand);
+	}
+
+	void Analyse(const CameraFrame& frame, const GridSettings& settings, CellBuffer& output,
+		float sampleDensity = 1.f, const CompiledRegions* regions = nullptr, const CellDemand* demand = nullptr)
+	{
+		if (frame.yuv != nullptr) Analyse(frame.yuv->GetView(), settings, output, sampleDensity, regions, demand);
+		else Analyse(frame.image, settings, output, sampleDensity, regions, demand);
+	}
+
+	// picked up from the next frame on. Analysis thread only.
+	void SetColourCorrection(const ColourCorrectionSettings& settings) {
+		correctionSettings = settings;
+		if (settings.IsOff()) normaliser.Reset();
+	}
+
+	// the next frame doesn't get compared with the last one this analyser saw, for when frames were skipped. Analysis thread only.
+	void ForgetMotion() {
+		motion.valid = false;
+	}
+
+	// without motion every cell's motion stays 0 and the luma blocks are neither summed nor compared, for callers that don't
+	// read Cell::motion and for measuring what it costs. On by default. Analysis thread only.
+	void SetMotion(bool enabled) {
+		motionEnabled = enabled;
+		motion.valid = false;
+	}
+
+	// what the next frame gets corrected with
+	const ColourCorrection& GetColourCorrection() const {
+		return normaliser.Get();
+	}
+
+	// wall clock time the last Analyse call took
+	double GetLastAnalysisSeconds() const {
+		return lastAnalysisSeconds;
+	}
+};
+
+}
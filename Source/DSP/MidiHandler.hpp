@@ -1,16 +1,73 @@
 #pragma once
 #include "juce_core/juce_core.h"
 #include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include "../Commons/CellBuffer.hpp"
 #include "../Commons/ColorUtils.hpp"
+#include "../Commons/FixedList.hpp"
+#include "../Commons/ParameterNaming.hpp"
+#include "../Commons/SnapshotBuffer.hpp"
+#include "CcStreams.hpp"
+#include "MidiScheduler.hpp"
+#include "MidiOutputStage.hpp"
 
 namespace HueShift{
 
+// what the audio thread published about the voices after its last block. Plain data so it can be copied around freely.
+struct VoiceStateSnapshot {
+    uint64_t blockIndex = 0;
+    size_t numVoices = 0;
+    std::bitset<MAX_VOICES> enabled{};
+    std::bitset<MAX_VOICES> frozen{};
+    std::array<uint8_t, MAX_VOICES> octaveIndexes{};
+    std::array<float, MAX_VOICES> frequencies{};
+
+    bool isVoiceEnabled(size_t index) const {
+        return index < numVoices && enabled[index];
+    }
+
+    bool isVoiceFrozen(size_t index) const {
+        return index < numVoices && frozen[index];
+    }
+};
+
+// one change to one voice. Toggles flip the state, sets are idempotent so sending one twice does no harm.
+struct VoiceCommand {
+    enum class Type : uint8_t {
+        toggleFreeze,
+        toggleOctave,
+        toggleSelect,
+        setFreeze,
+        setOctave, // value is the octave index
+        setSelect,
+        cameraHz // index is the analysis rate, the processor hands it to the AnalysisEngine instead of the voices
+    };
+
+    Type type = Type::toggleFreeze;
+    int32_t index = 0; // counts from top left to bottom right, like the voices
+    int32_t value = 0; // only used by the set commands
+};
+
 // keep data -1 if you want no change.
+// fixed capacity so reading a block's worth of commands doesn't allocate on the audio thread, extra commands get dropped.
 struct ReadDataOutput {
-    std::vector<int> freezeGridIndexes{}; // counts from top left to bottom right.
-    std::vector<int> cameraHz{}; // uses last index to apply Hz
-    std::vector<int> toggleOctaveIndexes{};
-    std::vector<int> selectGridIndex{};
+    FixedList<int, MAX_VOICES> freezeGridIndexes{}; // counts from top left to bottom right.
+    FixedList<int, MAX_VOICES> cameraHz{}; // uses last index to apply Hz
+    FixedList<int, MAX_VOICES> toggleOctaveIndexes{};
+    FixedList<int, MAX_VOICES> selectGridIndex{};
+    FixedList<VoiceCommand, VOICE_COMMANDS_PER_BLOCK> commands{}; // applied in order, after the lists above
+
+    void clear() {
+        freezeGridIndexes.clear();
+        cameraHz.clear();
+        toggleOctaveIndexes.clear();
+        selectGridIndex.clear();
+        commands.clear();
+    }
 
     static ReadDataOutput ReadData(const MidiBuffer& buffer) {
         ReadDataOutput output{};
@@ -32,43 +89,100 @@ struct ReadDataOutput {
     }
 };
 
+// how the voices get from one frame's frequency to the next. Plain data, so it can be handed to the audio thread through a SnapshotBuffer.
+struct FrequencyGlideSettings {
+    float slewSeconds = FREQUENCY_SLEW_SECONDS; // 0 jumps with every frame, like the analysis does
+    bool lookBehind = false; // glide over the whole time until the next frame instead: a frame later, but never a step
+};
+
 class MidiVoice {
 private:
-    mutable double prevFrequency;
+    double frequency = ColorInfo::red.frequency; // what the last block played
     bool isFrozen = false;
     bool isEnabled = false;
     size_t currentOctaveCycleIndex = 0;
     inline static std::vector<float> octaveMultipliers = {0.5f, 1.f, 0.25f};
 
+    // the glide to the latest target, in samples since the last reset. Geometric, so every octave takes as long.
+    double glideFrom = ColorInfo::red.frequency, glideTo = ColorInfo::red.frequency;
+    uint64_t glideStart = 0, glideEnd = 0;
+    bool hasTarget = false;
+
+    // the pulses follow the frequency from one to the next, so a glide moves them without a jump
+    uint64_t lastPulse = 0;
+    bool hasPulsed = false;
+    uint64_t pendingOff = 0;
+    bool hasPendingOff = false;
+
+    double GetFrequencyAt(uint64_t sample) const {
+        if (sample >= glideEnd) return glideTo;
+        if (sample <= glideStart) return glideFrom;
+        const double progress = static_cast<double>(sample - glideStart) / static_cast<double>(glideEnd - glideStart);
+        return glideFrom * std::pow(glideTo / glideFrom, progress);
+    }
+
+    void SendNoteOff(unsigned int noteNumber, uint64_t samplesNow, size_t sampleRate, double timeNow, MidiScheduler& scheduler) {
+        const auto position = static_cast<int>(pendingOff > samplesNow ? pendingOff - samplesNow : 0);
+        auto message = juce::MidiMessage::noteOff(1, noteNumber, uint8(127));
+        message.setTimeStamp(timeNow + position / static_cast<double>(sampleRate));
+        scheduler.Add(message, position, MidiScheduler::noteOff);
+        hasPendingOff = false;
+    }
+
 public:
-    // sends a midi message if the frequency wishes it.
-    void Process(double frequency, unsigned int noteNumber, unsigned int noteLengthSamples,
-        size_t sampleRate, size_t bufferSize, const unsigned int& startTimeSamples, const unsigned int& timeNowSamples, MidiBuffer& outputBuffer) const
-    {
-        if (!isEnabled) return;
-        if (!isFrozen) prevFrequency = frequency;
+    // the frequency the cell's colour asks for. A new one is glided to over glideSamples (0 jumps), frozen voices keep theirs.
+    void SetTarget(double target, uint64_t samplesNow, uint64_t glideSamples) {
+        if (isFrozen || (hasTarget && target == glideTo)) return;
+
+        glideFrom = hasTarget ? GetFrequencyAt(samplesNow) : target; // a new voice starts where it should be
+        glideTo = target;
+        glideStart = samplesNow;
+        glideEnd = samplesNow + glideSamples;
+        hasTarget = true;
+    }
 
+    // sends the pulses that fall into this block. A closed gate holds back the note ons, the pulse keeps its phase.
+    // samplesNow counts from the last reset, 64 bit: a 32 bit count wraps after a day at 48 kHz and the pulses jump.
+    void Process(unsigned int noteNumber, size_t sampleRate, size_t bufferSize, uint64_t samplesNow, MidiScheduler& scheduler,
+        bool gateOpen = true)
+    {
         auto timeNow = Time::getMillisecondCounterHiRes() * 0.001;
-        auto samplesNow = timeNowSamples - startTimeSamples;
-        unsigned int samplesPerCycle = static_cast<unsigned int>(sampleRate / (prevFrequency * octaveMultipliers[currentOctaveCycleIndex]));
+        if (!isEnabled) {
+            if (hasPendingOff) { // nothing hangs when it gets turned off
+                pendingOff = samplesNow;
+                SendNoteOff(noteNumber, samplesNow, sampleRate, timeNow, scheduler);
+            }
+            hasPulsed = false;
+            return;
+        }
 
-        // note on messages
-        unsigned int messageSamplePos = samplesNow % samplesPerCycle;
-        for (messageSamplePos; messageSamplePos < bufferSize; messageSamplePos += samplesPerCycle) {
-            auto message = juce::MidiMessage::noteOn(1, noteNumber, uint8(127));
-            message.setTimeStamp(timeNow + (messageSamplePos*1.f) / sampleRate);
+        // one frequency per block, from the middle of it
+        frequency = GetFrequencyAt(samplesNow + bufferSize / 2);
+        const uint64_t samplesPerCycle = std::max<uint64_t>(1, static_cast<uint64_t>(sampleRate / (frequency * octaveMultipliers[currentOctaveCycleIndex])));
+        const uint64_t noteLengthSamples = std::max<uint64_t>(1, static_cast<uint64_t>((sampleRate / frequency) / 2)); // div 2 for safety
+        const uint64_t blockEnd = samplesNow + bufferSize;
 
-            outputBuffer.addEvent(message, messageSamplePos);
-        }
-        
-        // note off messages
-        unsigned int messageOffPos = (samplesNow + noteLengthSamples) % samplesPerCycle;
-        for (messageOffPos; messageOffPos < bufferSize; messageOffPos += samplesPerCycle) {
-            auto message = juce::MidiMessage::noteOff(1, noteNumber, uint8(127));
-            message.setTimeStamp(timeNow + (messageOffPos*1.f) / sampleRate);
+        // the first pulse sits on a multiple of samplesPerCycle counted from the last reset, every next one a cycle after the last.
+        // At a steady frequency that's the same grid, and a changing one never makes a pulse jump or double.
+        uint64_t pulse = hasPulsed ? lastPulse + samplesPerCycle : samplesNow + (samplesPerCycle - samplesNow % samplesPerCycle) % samplesPerCycle;
+        pulse = std::max(pulse, samplesNow); // the cycle got shorter than what already passed
+
+        for (; pulse < blockEnd; pulse += samplesPerCycle) {
+            if (hasPendingOff && pendingOff <= pulse) SendNoteOff(noteNumber, samplesNow, sampleRate, timeNow, scheduler);
+
+            if (gateOpen) {
+                auto message = juce::MidiMessage::noteOn(1, noteNumber, uint8(127));
+                message.setTimeStamp(timeNow + (pulse - samplesNow) / static_cast<double>(sampleRate));
+                scheduler.Add(message, static_cast<int>(pulse - samplesNow), MidiScheduler::noteOn);
 
-            outputBuffer.addEvent(message, messageOffPos);
+                pendingOff = pulse + noteLengthSamples;
+                hasPendingOff = true;
+            }
+            lastPulse = pulse;
+            hasPulsed = true;
         }
+
+        if (hasPendingOff && pendingOff < blockEnd) SendNoteOff(noteNumber, samplesNow, sampleRate, timeNow, scheduler);
     }
 
     void ToggleFreeze() {
@@ -79,6 +193,18 @@ public:
         isEnabled = !isEnabled;
     }
 
+    void SetFreeze(bool shouldFreeze) {
+        isFrozen = shouldFreeze;
+    }
+
+    void SetSelect(bool shouldSelect) {
+        isEnabled = shouldSelect;
+    }
+
+    void SetOctaveIndex(size_t octaveIndex) {
+        currentOctaveCycleIndex = octaveIndex < octaveMultipliers.size() ? octaveIndex : 0;
+    }
+
     void ToggleOctave() {
         // cycle up in the octave vector if you aren't on the last one.
         currentOctaveCycleIndex = currentOctaveCycleIndex < octaveMultipliers.size()-1 ? currentOctaveCycleIndex+1 : 0;
@@ -93,88 +219,219 @@ public:
         return isEnabled;
     }
 
+    bool isVoiceFrozen() const {
+        return isFrozen;
+    }
+
+    size_t GetOctaveIndex() const {
+        return currentOctaveCycleIndex;
+    }
+
+    // what the last block played
     double GetFrequency() const {
-        return prevFrequency;
+        return frequency;
     }
 };
 
 // Base note = C1 (24)
 class MidiHandler {
 private:
-    unsigned int startTimeSamples; // from when the buffer should start as a pivot point
-    unsigned int timeElapsedSamples = 0;
+    uint64_t startTimeSamples; // from when the buffer should start as a pivot point
+    uint64_t timeElapsedSamples = 0; // installations run for weeks, this never wraps
     size_t sampleRate = 48000;
-    MidiBuffer& outputBuffer;
     std::vector<MidiVoice> voices{};
-    bool readyToRead = false;
+
+    VoiceStateSnapshot pendingSnapshot{}; // filled in by the audio thread, then published
+    SnapshotBuffer<VoiceStateSnapshot> publishedSnapshots;
+    uint64_t blockIndex = 0;
+
+    std::atomic<float> motionGate{0.f}; // see SetMotionGate
+
+    CcStreamer ccStreamer; // the cells' colours as controller streams
+    MidiScheduler scheduler; // everything goes through here before it ends up in the host's buffer
+    MidiOutputStage outputStage; // what of the input stays in the host's buffer
+    SnapshotBuffer<MidiOutputSettings> outputSettings;
+    MidiOutputSettings blockOutputSettings{};
+    SnapshotBuffer<MidiSchedulerSettings> schedulerSettings;
+    MidiSchedulerSettings blockSchedulerSettings{};
+    SnapshotBuffer<CcStreamSettings> ccSettings;
+    CcStreamSettings blockCcSettings{};
+    SnapshotBuffer<FrequencyGlideSettings> glideSettings;
+    FrequencyGlideSettings blockGlideSettings{};
+
+    // when the cells came in, see FrameArrived
+    juce::uint64 lastFrameIndex = 0;
+    double lastFrameSeconds = 0.0;
+    double frameIntervalSeconds = 1.0 / ANALYSIS_HZ;
+
+    // presets are owned by the PresetBank, the audio thread only borrows them for the duration of ApplyPreset.
+    std::atomic<const VoiceStateSnapshot*> pendingPreset{nullptr};
+    std::atomic<const VoiceStateSnapshot*> applyingPreset{nullptr};
+    VoiceStateSnapshot restoredState{}; // voices created after a preset was applied start out like this
 
     ReadDataOutput ReadData(const juce::MidiBuffer& buffer) const {
         return ReadDataOutput::ReadData(buffer);
     }
 
-    void ProcessVoices(const std::vector<juce::Colour>& gridColours, unsigned int bufferSize) {
-        // firstly make sure the size of the voices vector is the same as gridColours without removing all entries.
-        const int sizeDiff = gridColours.size() - voices.size();
-        if (sizeDiff != 0){
-            readyToRead = false;
-        }
+    void ProcessVoices(const CellBuffer& cells, unsigned int bufferSize) {
+        // firstly make sure the size of the voices vector is the same as the amount of cells without removing all entries.
+        // voices are reserved up to MAX_VOICES and a CellBuffer never holds more, so push_back never allocates.
+        const int sizeDiff = static_cast<int>(cells.size()) - static_cast<int>(voices.size());
         if (sizeDiff > 0) {
             for (auto i = 0; i < sizeDiff; i++) {
                 voices.push_back(MidiVoice{});
+                RestoreVoice(voices.size() - 1);
             }
-            readyToRead = true;
         } else if (sizeDiff < 0) {
             for (auto i = 0; i < abs(sizeDiff); i++){
                 voices.pop_back();
             }
-            readyToRead = true;
         }
 
+        if (cells.frameIndex != lastFrameIndex) FrameArrived(cells);
+        const auto glideSamples = GetGlideSamples();
+
         // process all voices
-        for (int i = 0; i < gridColours.size() && i < voices.size()/* && i < 2*/; i++) {
+        const float gate = motionGate.load(std::memory_order_relaxed);
+        for (int i = 0; i < cells.size() && i < voices.size()/* && i < 2*/; i++) {
             auto& voice = voices[i];
-            const double vFreq = voice.GetFrequency();
-            const unsigned int len = (sampleRate/vFreq)/2; // div 2 for safety
+            voice.SetTarget(ColorInfo::GetClosestColor(cells[i].GetColour()).frequency, timeElapsedSamples, glideSamples);
             voice.Process(
-                ColorInfo::GetClosestColor(gridColours[i]).frequency, // freq
                 C1 + i, // note
-                len, // note length samples
                 sampleRate,
                 bufferSize,
-                startTimeSamples, // start time in seconds
-                startTimeSamples + timeElapsedSamples,
-                outputBuffer // buffer to write messages to
+                timeElapsedSamples,
+                scheduler, // collects the messages, they go out at the end of the block
+                cells[i].motion >= gate // only pulse while something moves in the cell
             );
         }
     }
 
+    // the frames' own timestamps give the time between them without the jitter of the blocks they show up in
+    void FrameArrived(const CellBuffer& cells) {
+        lastFrameIndex = cells.frameIndex;
+        if (cells.timeSeconds <= 0.0) return;
+
+        if (lastFrameSeconds > 0.0 && cells.timeSeconds > lastFrameSeconds) {
+            const double interval = std::min(cells.timeSeconds - lastFrameSeconds, FREQUENCY_GLIDE_MAX_SECONDS);
+            frameIntervalSeconds += (interval - frameIntervalSeconds) * 0.1;
+        }
+        lastFrameSeconds = cells.timeSeconds;
+    }
+
+    uint64_t GetGlideSamples() const {
+        const double seconds = blockGlideSettings.lookBehind ? frameIntervalSeconds : std::max(0.f, blockGlideSettings.slewSeconds);
+        return static_cast<uint64_t>(seconds * sampleRate);
+    }
+
+    void RestoreVoice(size_t index) {
+        if (index >= restoredState.numVoices) return;
+
+        auto& voice = voices[index];
+        voice.SetSelect(restoredState.enabled[index]);
+        voice.SetFreeze(restoredState.frozen[index]);
+        voice.SetOctaveIndex(restoredState.octaveIndexes[index]);
+    }
+
+    // takes the queued preset, if any, and applies it to all voices. Voices that get turned off receive a note off so nothing hangs.
+    void ApplyPendingPreset() {
+        auto preset = pendingPreset.load(std::memory_order_acquire);
+        if (preset == nullptr) return;
+
+        // announce the preset before taking it, so the bank never frees it while it's being read.
+        applyingPreset.store(preset);
+        if (pendingPreset.compare_exchange_strong(preset, nullptr)) {
+            restoredState = *preset;
+
+            for (size_t i = 0; i < voices.size(); i++) {
+                const bool wasEnabled = voices[i].isVoiceEnabled();
+                if (i < restoredState.numVoices) {
+                    RestoreVoice(i);
+                } else {
+                    voices[i] = MidiVoice{};
+                }
+
+                if (wasEnabled && !voices[i].isVoiceEnabled()) {
+                    scheduler.Add(juce::MidiMessage::noteOff(1, C1 + static_cast<int>(i), uint8(127)), 0, MidiScheduler::noteOff);
+                }
+            }
+        }
+        applyingPreset.store(nullptr);
+    }
+
+    // copies the voice state into the snapshot readers on other threads get to see.
+    void PublishSnapshot() {
+        auto& snapshot = pendingSnapshot;
+        snapshot.blockIndex = blockIndex;
+        snapshot.numVoices = std::min(voices.size(), size_t(MAX_VOICES));
+        snapshot.enabled.reset();
+        snapshot.frozen.reset();
+
+        for (size_t i = 0; i < snapshot.numVoices; i++) {
+            const auto& voice = voices[i];
+            snapshot.enabled[i] = voice.isVoiceEnabled();
+            snapshot.frozen[i] = voice.isVoiceFrozen();
+            snapshot.octaveIndexes[i] = static_cast<uint8_t>(voice.GetOctaveIndex());
+            snapshot.frequencies[i] = static_cast<float>(voice.GetFrequency());
+        }
+
+        publishedSnapshots.Publish(snapshot);
+    }
+
 public:
-    MidiHandler(juce::MidiBuffer& outputBuffer)
-    : outputBuffer(outputBuffer) {
-        startTimeSamples = static_cast<unsigned int>(juce::Time::getMillisecondCounterHiRes() * 0.001 * sampleRate);
+    MidiHandler() {
+        voices.reserve(MAX_VOICES);
+        startTimeSamples = static_cast<uint64_t>(juce::Time::getMillisecondCounterHiRes() * 0.001 * sampleRate);
     }
 
-    void Reset(size_t sampleRate, double startTimeSamples) {
+    void Reset(size_t sampleRate, double startTimeSeconds) {
         this->sampleRate = sampleRate;
-        this->startTimeSamples = startTimeSamples;
-        startTimeSamples = static_cast<unsigned int>(juce::Time::getMillisecondCounterHiRes() * 0.001 * sampleRate);
-        readyToRead = false;
+        startTimeSamples = static_cast<uint64_t>(startTimeSeconds * sampleRate);
         timeElapsedSamples = 0;
+        ccStreamer.Reset(static_cast<double>(sampleRate));
+        scheduler.Reset(); // the voices' pending note offs go with them, the scheduler sends one for every note that is still on
+        outputStage.Prepare();
+
+        // keep the selections, freezes and octaves for when the voices get created again.
+        if (!voices.empty()) {
+            PublishSnapshot();
+            publishedSnapshots.Read(restoredState);
+        }
         voices.clear();
+        PublishSnapshot();
     }
 
-    void Process(const juce::MidiBuffer& inputBuffer, const std::vector<juce::Colour>& gridColours, unsigned int bufferSize) {
+    // midi is the host's buffer: the commands get read from it, then it holds what passes through and the generated events.
+    // externalData holds the commands that came in over the network since the last block.
+    void Process(juce::MidiBuffer& midi, const CellBuffer& cells, unsigned int bufferSize, const ReadDataOutput& externalData) {
+        // [0] switch to a new preset if one was queued
+        ApplyPendingPreset();
+
         // [1] read the data
-        const auto inputData = ReadData(inputBuffer);
+        const auto inputData = ReadData(midi);
         ApplyData(inputData);
+        ApplyData(externalData);
+
+        // [2] process voices, then the continuous colour streams
+        glideSettings.Read(blockGlideSettings);
+        ProcessVoices(cells, bufferSize);
+        ccSettings.Read(blockCcSettings);
+        ccStreamer.Process(cells, blockCcSettings, static_cast<int>(bufferSize), scheduler);
 
-        // [2] process voices
-        ProcessVoices(gridColours, bufferSize);
+        // [3] the input that passes stays, everything that fits the output's budget joins it
+        outputSettings.Read(blockOutputSettings);
+        outputStage.Filter(midi, blockOutputSettings.passthrough);
+        schedulerSettings.Read(blockSchedulerSettings);
+        scheduler.Flush(midi, static_cast<int>(bufferSize), static_cast<double>(sampleRate), blockSchedulerSettings);
 
         timeElapsedSamples += bufferSize;
+
+        // [4] let the other threads know what happened
+        blockIndex++;
+        PublishSnapshot();
     };
 
-    // do stuff to the data like freezing etc
+    // do stuff to the data like freezing etc. Audio thread only.
     void ApplyData(const ReadDataOutput& data) {
         for (const auto& freezeIdx : data.freezeGridIndexes) {
             if (freezeIdx < voices.size()) voices[freezeIdx].ToggleFreeze();
@@ -187,20 +444,87 @@ public:
         for (const auto& selectIndex : data.selectGridIndex) {
             if (selectIndex < voices.size()) voices[selectIndex].ToggleSelect();
         }
+
+        for (const auto& command : data.commands) {
+            if (command.index < 0 || static_cast<size_t>(command.index) >= voices.size()) continue;
+            auto& voice = voices[command.index];
+
+            switch (command.type) {
+                case VoiceCommand::Type::toggleFreeze: voice.ToggleFreeze(); break;
+                case VoiceCommand::Type::toggleOctave: voice.ToggleOctave(); break;
+                case VoiceCommand::Type::toggleSelect: voice.ToggleSelect(); break;
+                case VoiceCommand::Type::setFreeze: voice.SetFreeze(command.value != 0); break;
+                case VoiceCommand::Type::setOctave: voice.SetOctaveIndex(static_cast<size_t>(std::max(0, command.value))); break;
+                case VoiceCommand::Type::setSelect: voice.SetSelect(command.value != 0); break;
+                case VoiceCommand::Type::cameraHz: break; // not for a voice, see HueShiftProcessor::DrainNetworkCommands
+            }
+        }
+    }
+
+    // hands a preset to the audio thread, it gets applied at the start of the next block.
+    // The preset has to stay alive while IsPresetInFlight returns true for it.
+    void QueuePreset(const VoiceStateSnapshot* preset) {
+        pendingPreset.store(preset, std::memory_order_release);
     }
 
-    // row and column are 0 based
+    bool IsPresetInFlight(const VoiceStateSnapshot* preset) const {
+        // pending has to be checked first, the audio thread marks a preset as applying before it takes it out of pending.
+        return pendingPreset.load() == preset || applyingPreset.load() == preset;
+    }
+
+    // the preset that will be applied next block, nullptr if there is none. Only dereference it while the preset's owner
+    // can't free it, see PresetBank::GetPendingVoices.
+    const VoiceStateSnapshot* GetPendingPreset() const {
+        return pendingPreset.load(std::memory_order_acquire);
+    }
+
+    // safe to call from any thread, returns an empty snapshot before the first block was processed.
+    VoiceStateSnapshot GetVoiceState() const {
+        VoiceStateSnapshot snapshot{};
+        publishedSnapshots.Read(snapshot);
+        return snapshot;
+    }
+
+    // row and column are 0 based. Safe to call from any thread, but read GetVoiceState() once if you need more than one voice.
     bool isVoiceEnabled(size_t column, size_t row, size_t amtColumns) const {
-        size_t index = amtColumns * row + column;
-
-        if (!readyToRead) return false; // readyToRead might need to be atomic.
-        if (index < voices.size()){
-            // jassert(index < voices.size());
-            const auto& voice = voices[index];
-            auto res = voice.isVoiceEnabled();
-            return res;
-        }
-        return false;
+        return GetVoiceState().isVoiceEnabled(amtColumns * row + column);
+    }
+
+    // voices only pulse while their cell's motion (see Cell::motion) is at least this, 0 turns the gate off. Any thread.
+    void SetMotionGate(float threshold) {
+        motionGate.store(std::max(0.f, threshold), std::memory_order_relaxed);
+    }
+
+    // turns the per cell hue, saturation and brightness controller streams on or off, see CcStreamer.
+    // Picked up at the next block. Only call from one thread (the message thread).
+    void SetCcStreams(const CcStreamSettings& settings) {
+        ccSettings.Publish(settings);
+    }
+
+    // how the voices move from one frame's frequency to the next. Picked up at the next block. Only call from one thread (the message thread).
+    void SetFrequencyGlide(const FrequencyGlideSettings& settings) {
+        glideSettings.Publish(settings);
+    }
+
+    // the output's bandwidth budget, see MidiScheduler. Picked up at the next block. Only call from one thread (the message thread).
+    void SetMidiScheduler(const MidiSchedulerSettings& settings) {
+        schedulerSettings.Publish(settings);
+    }
+
+    // which of the incoming MIDI goes on down the chain. Picked up at the next block. Only call from one thread (the message thread).
+    void SetMidiOutput(const MidiOutputSettings& settings) {
+        outputSettings.Publish(settings);
+    }
+
+    const MidiScheduler& GetScheduler() const { return scheduler; } // its counters, audio thread only
+
+    // audio thread only, see CcStreamer
+    uint64_t GetCcSentCount() const { return ccStreamer.GetSentCount(); }
+    uint64_t GetCcThrottledCount() const { return ccStreamer.GetThrottledCount(); }
+
+    // samples processed since the last Reset. Audio thread only.
+    uint64_t GetElapsedSamples() const {
+        return timeElapsedSamples;
     }
 
     size_t GetSampleRate() const {
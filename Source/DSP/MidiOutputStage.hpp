@@ -0,0 +1,79 @@
+#pragma once
+#include <JuceHeader.h>
+#include <cstdint>
+#include "../Commons/ParameterNaming.hpp"
+
+namespace HueShift {
+
+enum class MidiPassthrough : uint8_t {
+	none = 0,    // only what HueShift generates
+	allButNotes, // the notes are HueShift's commands (freeze, octave), everything else but their poly aftertouch goes on down the chain
+	/*
+		everything, the command notes too. Careful: they sound on whatever plays HueShift's notes, and they share its channels
+		with the generated notes. The MidiScheduler doesn't know about them, so a passed note off can end a generated note
+		that is still sounding (and the other way around). Only for chains where the notes coming in aren't meant for HueShift.
+	*/
+	all
+};
+
+// plain data, so it can be handed to the audio thread through a SnapshotBuffer
+struct MidiOutputSettings {
+	MidiPassthrough passthrough = MidiPassthrough::allButNotes;
+};
+
+/*
+	The host's buffer is the input and the output. After the commands have been read from it, whatever shouldn't pass is
+	taken out in place and the MidiScheduler flushes the generated events straight into it, MidiBuffer::addEvent keeps them
+	in sample order with the input. Nothing gets copied into a buffer of our own first.
+
+	Both buffers get room for the worst case up front: everything the scheduler can emit plus MIDI_PASSTHROUGH_RESERVE_EVENTS
+	of input. Ours in Prepare, the host's the first time we see it (a no-op after that, hosts keep their buffer).
+*/
+class MidiOutputStage {
+private:
+	juce::MidiBuffer kept{}; // the input that passes, swapped with the host's buffer when something had to go
+	int reservedBytes = 0;
+
+	// note on, note off and poly aftertouch, everything that belongs to a command note
+	static bool IsNote(const juce::MidiMessageMetadata& metadata) {
+		const auto status = metadata.numBytes > 0 ? metadata.data[0] & 0xf0 : 0;
+		return status == 0x80 || status == 0x90 || status == 0xa0;
+	}
+
+public:
+	// bytes a MidiBuffer takes for amount short messages: each event has its sample position and size in front
+	static int GetBytesFor(int amount) {
+		return amount * static_cast<int>(sizeof(int32_t) + sizeof(uint16_t) + 3);
+	}
+
+	// allocates, call from prepareToPlay
+	void Prepare() {
+		reservedBytes = GetBytesFor(MIDI_SCHEDULER_CAPACITY + MIDI_PASSTHROUGH_RESERVE_EVENTS);
+		kept.ensureSize(static_cast<size_t>(reservedBytes));
+		kept.clear();
+	}
+
+	// leaves what passes in midi, ready for the generated events. Audio thread only.
+	void Filter(juce::MidiBuffer& midi, MidiPassthrough passthrough) {
+		midi.ensureSize(static_cast<size_t>(reservedBytes));
+
+		if (passthrough == MidiPassthrough::all) return;
+		if (passthrough == MidiPassthrough::none) {
+			midi.clear(); // keeps the storage
+			return;
+		}
+
+		bool hasNotes = false;
+		for (const auto metadata : midi) hasNotes = hasNotes || IsNote(metadata);
+		if (!hasNotes) return; // the usual block, nothing to move
+
+		kept.clear();
+		for (const auto metadata : midi) {
+			if (!IsNote(metadata)) kept.addEvent(metadata.data, metadata.numBytes, metadata.samplePosition);
+		}
+		midi.swapWith(kept); // both have the reserved room, so neither grows later
+		kept.clear();
+	}
+};
+
+}
@@ -0,0 +1,238 @@
+#pragma once
+#include <JuceHeader.h>
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "../Commons/FixedList.hpp"
+#include "../Commons/ParameterNaming.hpp"
+
+namespace HueShift {
+
+// how much the MIDI output may carry. Plain data, so it can be handed to the audio thread through a SnapshotBuffer.
+struct MidiSchedulerSettings {
+	float bytesPerSecond = MIDI_OUTPUT_BYTES_PER_SECOND; // 0 means unlimited
+	float jitterMilliseconds = MIDI_OUTPUT_JITTER_MS; // how late an event may go out to make room
+	int maxEventsPerBlock = MIDI_OUTPUT_MAX_EVENTS_PER_BLOCK;
+
+	// for an output that goes to hardware over DIN MIDI, the default doesn't limit the bandwidth
+	static MidiSchedulerSettings ForDin() {
+		MidiSchedulerSettings settings{};
+		settings.bytesPerSecond = MIDI_DIN_BYTES_PER_SECOND;
+		return settings;
+	}
+};
+
+/*
+	Everything the voices and the controller streams generate during a block is collected here first and written out at the end,
+	so a block never carries more than the output can take.
+
+	- coalescing: an event identical to another one at the same sample, and a note off for a note that isn't sounding, are left out.
+	- bandwidth (opt in, see MidiSchedulerSettings::ForDin): the output is modelled as a wire that sends bytesPerSecond. An event that finds it busy is moved later,
+	  by at most the jitter tolerance, which spreads a burst at one sample offset over the next few samples.
+	- priority: note offs > note ons (pulses) > controllers. Events at the same sample get the wire in that order, lower notes first.
+	  A pulse that can't go out within the tolerance is dropped, a controller waits for the next block, a note off always goes out.
+	  The same goes for the per block event limit.
+	- anything pushed past the end of the block goes out at the start of the next one.
+
+	Audio thread only, doesn't allocate. Every decision only depends on the events, so the output is deterministic.
+*/
+class MidiScheduler {
+public:
+	enum Priority : uint8_t {
+		controller = 0,
+		noteOn = 1,
+		noteOff = 2
+	};
+
+	// a note on or off that went out in the last Flush
+	struct SentNote {
+		int32_t sample = 0;
+		uint8_t note = 0;
+		bool isOn = false;
+	};
+	using SentNotes = FixedList<SentNote, MIDI_SCHEDULER_CAPACITY>;
+
+private:
+	struct Event {
+		int32_t sample = 0;
+		uint8_t data[3]{};
+		uint8_t size = 0;
+		uint8_t priority = controller;
+		uint16_t order = 0; // keeps the order things were added in for everything else that's equal, carried events come first
+	};
+
+	static_assert(MIDI_SCHEDULER_CAPACITY * 2 <= 65536, "the order has to fit 16 bits");
+
+	std::array<Event, MIDI_SCHEDULER_CAPACITY> events{};
+	size_t amountOfEvents = 0;
+	std::array<Event, MIDI_SCHEDULER_CAPACITY> carried{}; // for the next block, already relative to its start
+	size_t amountOfCarried = 0;
+
+	std::bitset<16 * 128> sounding{}; // channel * 128 + note, what the output has been sent
+	SentNotes sentNotes{}; // the output also carries what the input passed through, this is only ours
+	double wireFreeSample = 0.0; // relative to the current block, when the last event is done sending
+
+	uint64_t coalescedCount = 0, droppedCount = 0, deferredCount = 0, spreadCount = 0;
+
+	static bool IsNoteOn(const Event& event) {
+		return event.size == 3 && (event.data[0] & 0xf0) == 0x90 && event.data[2] != 0;
+	}
+
+	static bool IsNoteOff(const Event& event) {
+		return event.size == 3 && ((event.data[0] & 0xf0) == 0x80 || ((event.data[0] & 0xf0) == 0x90 && event.data[2] == 0));
+	}
+
+	static size_t GetNoteKey(const Event& event) {
+		return static_cast<size_t>(event.data[0] & 0x0f) * 128 + (event.data[1] & 0x7f);
+	}
+
+	static bool IsSameMessage(const Event& a, const Event& b) {
+		return a.sample == b.sample && a.size == b.size && std::memcmp(a.data, b.data, a.size) == 0;
+	}
+
+	bool Carry(const Event& event, int sample) {
+		if (amountOfCarried >= carried.size()) {
+			droppedCount++;
+			return false;
+		}
+
+		auto& carriedEvent = carried[amountOfCarried++];
+		carriedEvent = event;
+		carriedEvent.sample = sample;
+		deferredCount++;
+		return true;
+	}
+
+	void Emit(const Event& event, int sample, juce::MidiBuffer& output) {
+		output.addEvent(event.data, event.size, sample);
+
+		if (IsNoteOn(event)) sounding.set(GetNoteKey(event));
+		else if (IsNoteOff(event)) sounding.reset(GetNoteKey(event));
+		else return;
+		sentNotes.push_back({ sample, static_cast<uint8_t>(event.data[1] & 0x7f), IsNoteOn(event) });
+	}
+
+public:
+	// forgets everything waiting and queues a note off for every note that is still sounding, they go out at the start of the next block
+	void Reset() {
+		amountOfEvents = 0;
+		amountOfCarried = 0;
+		wireFreeSample = 0.0;
+
+		for (size_t key = 0; key < sounding.size() && amountOfEvents < events.size(); key++) {
+			if (!sounding.test(key)) continue;
+
+			auto& event = events[amountOfEvents];
+			event.sample = 0;
+			event.data[0] = static_cast<uint8_t>(0x80 | (key / 128));
+			event.data[1] = static_cast<uint8_t>(key % 128);
+			event.data[2] = 0;
+			event.size = 3;
+			event.priority = noteOff;
+			event.order = static_cast<uint16_t>(MIDI_SCHEDULER_CAPACITY + amountOfEvents);
+			amountOfEvents++;
+		}
+	}
+
+	// only short (channel) messages. Returns false if the block is full, which counts as a drop.
+	bool Add(const juce::MidiMessage& message, int samplePosition, Priority priority) {
+		const int size = message.getRawDataSize();
+		if (size <= 0 || size > 3) return false;
+		if (amountOfEvents >= events.size()) {
+			droppedCount++;
+			return false;
+		}
+
+		auto& event = events[amountOfEvents];
+		event.sample = std::max(0, samplePosition);
+		std::memcpy(event.data, message.getRawData(), static_cast<size_t>(size));
+		event.size = static_cast<uint8_t>(size);
+		event.priority = priority;
+		event.order = static_cast<uint16_t>(MIDI_SCHEDULER_CAPACITY + amountOfEvents);
+		amountOfEvents++;
+		return true;
+	}
+
+	// writes the block's events into output and starts the next block. Adds to what output already holds, in sample order.
+	void Flush(juce::MidiBuffer& output, int bufferSize, double sampleRate, const MidiSchedulerSettings& settings) {
+		sentNotes.clear();
+
+		// what didn't fit last block goes first, so a controller sequence that got cut in half (NRPN) is finished before anything else
+		const size_t amountFromLastBlock = std::min(amountOfCarried, events.size() - amountOfEvents);
+		for (size_t i = 0; i < amountFromLastBlock; i++) {
+			events[amountOfEvents] = carried[i];
+			events[amountOfEvents].order = static_cast<uint16_t>(i);
+			amountOfEvents++;
+		}
+		droppedCount += amountOfCarried - amountFromLastBlock;
+		amountOfCarried = 0;
+
+		std::sort(events.begin(), events.begin() + amountOfEvents, [](const Event& a, const Event& b) {
+			if (a.sample != b.sample) return a.sample < b.sample;
+			if (a.priority != b.priority) return a.priority > b.priority;
+			if (a.priority != controller && a.data[1] != b.data[1]) return a.data[1] < b.data[1]; // controllers keep their order, NRPN depends on it
+			return a.order < b.order;
+		});
+
+		const bool limited = settings.bytesPerSecond > 0.f;
+		const double samplesPerByte = limited ? sampleRate / settings.bytesPerSecond : 0.0;
+		const int jitterSamples = static_cast<int>(std::max(0.f, settings.jitterMilliseconds) * 0.001 * sampleRate);
+		const int maxEvents = std::max(1, settings.maxEventsPerBlock);
+		int emitted = 0;
+
+		for (size_t i = 0; i < amountOfEvents; i++) {
+			const auto& event = events[i];
+
+			if (i > 0 && IsSameMessage(event, events[i - 1])) {
+				coalescedCount++;
+				continue;
+			}
+			if (IsNoteOff(event) && !sounding.test(GetNoteKey(event))) {
+				coalescedCount++;
+				continue;
+			}
+
+			// when the wire is free for this one
+			int sample = event.sample;
+			if (limited) sample = std::max(sample, static_cast<int>(std::ceil(wireFreeSample)));
+			const bool tooLate = sample - event.sample > jitterSamples;
+			const bool tooMany = emitted >= maxEvents;
+
+			if ((tooLate || tooMany) && event.priority != noteOff) {
+				if (event.priority == noteOn) droppedCount++; // a late pulse is a wrong pulse
+				else Carry(event, 0);
+				continue;
+			}
+
+			if (sample >= bufferSize) {
+				Carry(event, sample - bufferSize);
+				continue;
+			}
+
+			Emit(event, sample, output);
+			emitted++;
+			if (sample != event.sample) spreadCount++;
+			if (limited) wireFreeSample = sample + event.size * samplesPerByte;
+		}
+
+		amountOfEvents = 0;
+		wireFreeSample = std::max(0.0, wireFreeSample - bufferSize);
+	}
+
+	// left out because they repeated something or turned off a note that wasn't on
+	uint64_t GetCoalescedCount() const { return coalescedCount; }
+	// pulses that couldn't go out in time
+	uint64_t GetDroppedCount() const { return droppedCount; }
+	// moved to the next block
+	uint64_t GetDeferredCount() const { return deferredCount; }
+	// moved a few samples later to make room
+	uint64_t GetSpreadCount() const { return spreadCount; }
+
+	// the notes the last Flush wrote, in the order they went out
+	const SentNotes& GetSentNotes() const { return sentNotes; }
+};
+
+}
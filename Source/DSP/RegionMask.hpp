@@ -0,0 +1,202 @@
+#pragma once
+#include <JuceHeader.h>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace HueShift {
+
+// pixels [x0, x1) of row y
+struct Span {
+	int y = 0;
+	int x0 = 0;
+	int x1 = 0;
+};
+
+// one user defined region in normalised image coordinates [0:1], each region drives one voice.
+struct RegionShape {
+	std::vector<juce::Point<float>> polygon{}; // used when it has 3 or more points
+	juce::Image mask{}; // otherwise a painted mask, stretched over the frame. Pixels brighter than half are inside.
+};
+
+// the regions rasterised for one frame size. Spans of all regions sit in one array, region i owns
+// spans [firstSpan[i], firstSpan[i + 1]), so evaluating a region is a straight walk over its rows.
+struct CompiledRegions {
+	int width = 0;
+	int height = 0;
+	std::vector<Span> spans{};
+	std::vector<size_t> firstSpan{}; // amount of regions + 1 entries
+	std::vector<size_t> pixelCounts{};
+
+	size_t GetAmountOfRegions() const {
+		return pixelCounts.size();
+	}
+
+	const Span* SpansBegin(size_t region) const { return spans.data() + firstSpan[region]; }
+	const Span* SpansEnd(size_t region) const { return spans.data() + firstSpan[region + 1]; }
+
+	static CompiledRegions Compile(const std::vector<RegionShape>& shapes, int width, int height) {
+		CompiledRegions compiled{};
+		compiled.width = width;
+		compiled.height = height;
+		compiled.firstSpan.push_back(0);
+
+		for (const auto& shape : shapes) {
+			const auto before = compiled.spans.size();
+
+			if (shape.polygon.size() >= 3) AddPolygonSpans(shape.polygon, width, height, compiled.spans);
+			else if (shape.mask.isValid()) AddMaskSpans(shape.mask, width, height, compiled.spans);
+
+			size_t pixels = 0;
+			for (auto i = before; i < compiled.spans.size(); i++) pixels += static_cast<size_t>(compiled.spans[i].x1 - compiled.spans[i].x0);
+
+			compiled.pixelCounts.push_back(pixels);
+			compiled.firstSpan.push_back(compiled.spans.size());
+		}
+
+		return compiled;
+	}
+
+private:
+	// even-odd scanline fill, sampled at pixel centres
+	static void AddPolygonSpans(const std::vector<juce::Point<float>>& polygon, int width, int height, std::vector<Span>& spans) {
+		float top = 1.f, bottom = 0.f;
+		for (const auto& point : polygon) {
+			top = std::min(top, point.y);
+			bottom = std::max(bottom, point.y);
+		}
+
+		const int firstRow = std::max(0, static_cast<int>(top * height));
+		const int lastRow = std::min(height - 1, static_cast<int>(bottom * height));
+		std::vector<float> crossings{};
+
+		for (int y = firstRow; y <= lastRow; y++) {
+			const float centre = (y + 0.5f) / height;
+			crossings.clear();
+
+			for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+				const auto& a = polygon[i];
+				const auto& b = polygon[j];
+				if ((a.y <= centre) == (b.y <= centre)) continue;
+
+				const float x = a.x + (centre - a.y) * (b.x - a.x) / (b.y - a.y);
+				crossings.push_back(x * width);
+			}
+
+			std::sort(crossings.begin(), crossings.end());
+			for (size_t i = 0; i + 1 < crossings.size(); i += 2) {
+				const int x0 = std::clamp(static_cast<int>(std::ceil(crossings[i] - 0.5f)), 0, width);
+				const int x1 = std::clamp(static_cast<int>(std::ceil(crossings[i + 1] - 0.5f)), 0, width);
+				if (x1 > x0) spans.push_back({y, x0, x1});
+			}
+		}
+	}
+
+	static void AddMaskSpans(const juce::Image& mask, int width, int height, std::vector<Span>& spans) {
+		const int maskWidth = mask.getWidth();
+		const int maskHeight = mask.getHeight();
+
+		for (int y = 0; y < height; y++) {
+			const int maskY = y * maskHeight / height;
+			int runStart = -1;
+
+			for (int x = 0; x <= width; x++) {
+				const bool inside = x < width && mask.getPixelAt(x * maskWidth / width, maskY).getBrightness() > 0.5f;
+
+				if (inside && runStart < 0) runStart = x;
+				else if (!inside && runStart >= 0) {
+					spans.push_back({y, runStart, x});
+					runStart = -1;
+				}
+			}
+		}
+	}
+};
+
+// rebuilds CompiledRegions on its own thread whenever the shapes or the frame size change.
+// Readers always get a complete set through an atomic shared_ptr swap, never a half built one.
+class RegionCompiler : public juce::Thread {
+private:
+	mutable std::mutex requestGuard;
+	std::vector<RegionShape> shapes{};
+	int width = 0, height = 0;
+	bool hasRequest = false;
+
+	std::shared_ptr<const CompiledRegions> compiled{};
+
+public:
+	RegionCompiler() : juce::Thread("Region Compiler") {
+		startThread(juce::Thread::Priority::low);
+	}
+
+	~RegionCompiler() override {
+		stopThread(3000);
+	}
+
+	// an empty list goes back to the uniform grid
+	void SetShapes(std::vector<RegionShape> newShapes) {
+		{
+			const std::lock_guard<std::mutex> lock(requestGuard);
+			shapes = std::move(newShapes);
+			hasRequest = true;
+		}
+		notify();
+	}
+
+	// the frame size the regions should be compiled for, cheap to call every frame.
+	void SetFrameSize(int newWidth, int newHeight) {
+		{
+			const std::lock_guard<std::mutex> lock(requestGuard);
+			if (newWidth == width && newHeight == height) return;
+			width = newWidth;
+			height = newHeight;
+			hasRequest = true;
+		}
+		notify();
+	}
+
+	// nullptr when there are no regions, the grid is used then.
+	std::shared_ptr<const CompiledRegions> Get() const {
+		return std::atomic_load(&compiled);
+	}
+
+	bool HasShapes() const {
+		const std::lock_guard<std::mutex> lock(requestGuard);
+		return !shapes.empty();
+	}
+
+	// what the last SetShapes got, for saving and editing them. Not from the audio thread.
+	std::vector<RegionShape> GetShapes() const {
+		const std::lock_guard<std::mutex> lock(requestGuard);
+		return shapes;
+	}
+
+	void run() override {
+		while (!threadShouldExit()) {
+			wait(-1);
+
+			std::vector<RegionShape> shapesToCompile{};
+			int compileWidth = 0, compileHeight = 0;
+			{
+				const std::lock_guard<std::mutex> lock(requestGuard);
+				if (!hasRequest) continue;
+				hasRequest = false;
+				shapesToCompile = shapes;
+				compileWidth = width;
+				compileHeight = height;
+			}
+
+			if (shapesToCompile.empty()) {
+				std::atomic_store(&compiled, std::shared_ptr<const CompiledRegions>{});
+				continue;
+			}
+			if (compileWidth <= 0 || compileHeight <= 0) continue; // no frame seen yet
+
+			auto result = std::make_shared<const CompiledRegions>(CompiledRegions::Compile(shapesToCompile, compileWidth, compileHeight));
+			std::atomic_store(&compiled, std::shared_ptr<const CompiledRegions>(std::move(result)));
+		}
+	}
+};
+
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include "ColourCorrection.hpp"
+#include "../Commons/CellBuffer.hpp"
+#include "../Commons/ParameterNaming.hpp"
+#include "../Commons/PluginState.hpp"
+
+namespace HueShift {
+
+// everything in the settings that decides what the analysis of a frame comes out as. Two instances with the same key only get
+// the same cells from the same frame if neither carries state over from its previous frames: the correction adapts over frames
+// and the motion is measured against the last frame the analyser saw. See AnalysisEngine for when it shares.
+struct AnalysisKey {
+	GridSettings grid{};
+	float sampleDensity = 1.f;
+	ColourCorrectionSettings correction{};
+
+	bool operator==(const AnalysisKey& other) const {
+		const auto& a = correction;
+		const auto& b = other.correction;
+		return grid.samplePoints == other.grid.samplePoints && grid.widthDivision == other.grid.widthDivision
+			&& grid.heightDivision == other.grid.heightDivision && grid.statistic == other.grid.statistic
+			&& sampleDensity == other.sampleDensity
+			&& a.whiteBalance == b.whiteBalance && a.normaliseExposure == b.normaliseExposure && a.subtractBlack == b.subtractBlack
+			&& a.targetLuma == b.targetLuma && a.maxGain == b.maxGain && a.adaptation == b.adaptation
+			&& a.referencePatch.getX() == b.referencePatch.getX() && a.referencePatch.getY() == b.referencePatch.getY()
+			&& a.referencePatch.getWidth() == b.referencePatch.getWidth() && a.referencePatch.getHeight() == b.referencePatch.getHeight();
+	}
+};
+
+/*
+	Process wide (use it through a juce::SharedResourcePointer): the last few analysed frames of every instance.
+	Instances watching the same camera see the same frame ids (see CameraBroker), so the first one to analyse a frame
+	leaves the cells here and the others with the same key copy them instead of analysing again.
+	Regions are per instance, an analysis with regions is never shared. Neither is one with colour correction or for a motion gate,
+	those depend on the frames an instance analysed before. The motion in a shared entry is the analysing instance's.
+	An entry serves everyone whose demanded cells it analysed in full, whatever it did with the others.
+*/
+class SharedAnalysisCache {
+private:
+	struct Slot {
+		uint64_t frameId = 0; // 0 is empty
+		AnalysisKey key{};
+		CellDemand demand{};
+		CellBuffer cells{};
+	};
+
+	std::mutex guard; // analysis threads only
+	std::array<Slot, ANALYSIS_SHARE_SLOTS> slots{};
+	size_t nextSlot = 0;
+
+public:
+	// copies the cells another instance found for this frame and key into output, keeps output's frameIndex. Doesn't allocate.
+	bool Find(uint64_t frameId, const AnalysisKey& key, const CellDemand& demand, CellBuffer& output) {
+		const std::lock_guard<std::mutex> lock(guard);
+		for (const auto& slot : slots) {
+			if (slot.frameId != frameId || !(slot.key == key) || !slot.demand.Covers(demand, slot.cells.size())) continue;
+
+			const auto frameIndex = output.frameIndex;
+			output = slot.cells;
+			output.frameIndex = frameIndex + 1;
+			return true;
+		}
+		return false;
+	}
+
+	// replaces the oldest entry
+	void Store(uint64_t frameId, const AnalysisKey& key, const CellDemand& demand, const CellBuffer& cells) {
+		const std::lock_guard<std::mutex> lock(guard);
+		auto& slot = slots[nextSlot];
+		nextSlot = (nextSlot + 1) % slots.size();
+
+		slot.frameId = frameId;
+		slot.key = key;
+		slot.demand = demand;
+		slot.cells = cells;
+	}
+};
+
+}
@@ -0,0 +1,173 @@
+#pragma once
+#include <JuceHeader.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include "ColourCorrection.hpp"
+#include "../Commons/ColorUtils.hpp"
+#include "../Commons/YuvFrame.hpp"
+
+namespace HueShift {
+
+/*
+	What the analysis needs to read yuv frames without turning every pixel into rgb first.
+
+	Everything from the raw bytes to the corrected colour is affine: the range expansion, BT.601 to rgb, the colour correction
+	(gain and offset per channel) and back to y, cb, cr. So it's folded into one matrix per frame, and sums of raw values
+	can be transformed instead of every pixel. The cells only convert their averages.
+*/
+struct YccTransform {
+	using Row = std::array<float, 4>; // applied to (y, cb, cr, 1)
+	std::array<Row, 3> rgb{}; // raw -> corrected r, g, b
+	std::array<Row, 3> ycc{}; // raw -> corrected y, cb, cr (full range, cb and cr centred on 0)
+
+	static YccTransform Create(YuvRange range, const ColourCorrection& correction) {
+		// raw -> full range y, cb, cr around 0
+		const float lumaScale = range == YuvRange::limited ? 255.f / 219.f : 1.f;
+		const float lumaOffset = range == YuvRange::limited ? -16.f * lumaScale : 0.f;
+		const float chromaScale = range == YuvRange::limited ? 255.f / 224.f : 1.f;
+		const std::array<Row, 3> expand = {{
+			{ lumaScale, 0.f, 0.f, lumaOffset },
+			{ 0.f, chromaScale, 0.f, -128.f * chromaScale },
+			{ 0.f, 0.f, chromaScale, -128.f * chromaScale }
+		}};
+
+		// BT.601 full range
+		const float toRgb[3][3] = {
+			{ 1.f, 0.f, 1.402f },
+			{ 1.f, -0.344136f, -0.714136f },
+			{ 1.f, 1.772f, 0.f }
+		};
+		const float toYcc[3][3] = {
+			{ 0.299f, 0.587f, 0.114f },
+			{ -0.168736f, -0.331264f, 0.5f },
+			{ 0.5f, -0.418688f, -0.081312f }
+		};
+
+		YccTransform transform{};
+		for (size_t channel = 0; channel < 3; channel++) {
+			for (size_t column = 0; column < 4; column++) {
+				float value = 0.f;
+				for (size_t k = 0; k < 3; k++) value += toRgb[channel][k] * expand[k][column];
+				transform.rgb[channel][column] = value * correction.gain[channel];
+			}
+			transform.rgb[channel][3] += correction.offset[channel];
+		}
+		for (size_t row = 0; row < 3; row++) {
+			for (size_t column = 0; column < 4; column++) {
+				float value = 0.f;
+				for (size_t k = 0; k < 3; k++) value += toYcc[row][k] * transform.rgb[k][column];
+				transform.ycc[row][column] = value;
+			}
+		}
+		return transform;
+	}
+
+	// amount is how many pixels y, cb and cr are the sums of, 1 for a single pixel
+	static float Apply(const Row& row, float y, float cb, float cr, float amount = 1.f) {
+		return row[0] * y + row[1] * cb + row[2] * cr + row[3] * amount;
+	}
+};
+
+// band and chroma (max - min of r, g and b) for every cb, cr pair. Neither depends on the luma:
+// adding to y moves r, g and b alike. So classifying a pixel is two multiply adds and a table lookup.
+class ChromaLookup {
+private:
+	static constexpr int steps = 128; // per axis, cb and cr in steps of two
+	std::array<uint8_t, steps * steps> bands{};
+	std::array<uint8_t, steps * steps> chromas{};
+
+public:
+	ChromaLookup() {
+		for (int i = 0; i < steps; i++) {
+			for (int j = 0; j < steps; j++) {
+				const float cb = (i + 0.5f) * (256.f / steps) - 128.f;
+				const float cr = (j + 0.5f) * (256.f / steps) - 128.f;
+				const float r = 1.402f * cr, g = -0.344136f * cb - 0.714136f * cr, b = 1.772f * cb;
+
+				// the same hue as GridAnalyser's rgb kernel
+				const float maximum = std::max(r, std::max(g, b));
+				const float minimum = std::min(r, std::min(g, b));
+				const float chroma = maximum - minimum;
+				const float inverse = chroma > 0.f ? 1.f / chroma : 0.f;
+				float hue = maximum == r ? (g - b) * inverse : (maximum == g ? 2.f + (b - r) * inverse : 4.f + (r - g) * inverse);
+				hue = hue < 0.f ? hue + 6.f : hue;
+
+				const auto index = static_cast<size_t>(i * steps + j);
+				bands[index] = static_cast<uint8_t>(ColorInfo::GetBandIndex(std::min(hue / 6.f, 1.f)));
+				chromas[index] = static_cast<uint8_t>(std::min(255.f, chroma));
+			}
+		}
+	}
+
+	// cb and cr full range around 0
+	static int GetIndex(float cb, float cr) {
+		const int i = static_cast<int>(std::min(255.f, std::max(0.f, cb + 128.f))) >> 1;
+		const int j = static_cast<int>(std::min(255.f, std::max(0.f, cr + 128.f))) >> 1;
+		return i * steps + j;
+	}
+
+	uint8_t GetBand(int index) const { return bands[static_cast<size_t>(index)]; }
+	float GetChroma(int index) const { return chromas[static_cast<size_t>(index)]; }
+};
+
+// reads the raw bytes of a YuvFrameView, with the transforms for the frame's correction
+struct YuvReader {
+	const YuvFrameView& view;
+	YccTransform corrected;
+	YccTransform raw; // without the correction, for the reference patch
+
+	YuvReader(const YuvFrameView& view, const ColourCorrection& correction)
+	: view(view), corrected(YccTransform::Create(view.range, correction)), raw(YccTransform::Create(view.range, ColourCorrection{}))
+	{}
+
+	int GetWidth() const { return view.width; }
+	int GetHeight() const { return view.height; }
+
+	// y, cb and cr of amount pixels starting at (x, y). The chroma is shared by two (nv12: four) pixels, every pixel gets its copy.
+	void ReadRun(int x, int y, int amount, float* lumas, float* cbs, float* crs) const {
+		if (view.format == YuvFormat::yuyv) {
+			const uint8_t* line = view.planes[0] + static_cast<size_t>(y) * view.strides[0];
+			for (int i = 0; i < amount; i++) {
+				const int pixel = x + i;
+				const int pair = (pixel & ~1) * 2;
+				lumas[i] = line[pixel * 2];
+				cbs[i] = line[pair + 1];
+				crs[i] = line[pair + 3];
+			}
+			return;
+		}
+
+		const uint8_t* luma = view.planes[0] + static_cast<size_t>(y) * view.strides[0];
+		const uint8_t* chroma = view.planes[1] + static_cast<size_t>(y / 2) * view.strides[1];
+		for (int i = 0; i < amount; i++) {
+			const int pair = ((x + i) >> 1) * 2;
+			lumas[i] = luma[x + i];
+			cbs[i] = chroma[pair];
+			crs[i] = chroma[pair + 1];
+		}
+	}
+
+	// the corrected colour of one pixel
+	void ReadPixel(int x, int y, float& r, float& g, float& b) const {
+		float luma, cb, cr;
+		ReadRun(x, y, 1, &luma, &cb, &cr);
+		r = YccTransform::Apply(corrected.rgb[0], luma, cb, cr);
+		g = YccTransform::Apply(corrected.rgb[1], luma, cb, cr);
+		b = YccTransform::Apply(corrected.rgb[2], luma, cb, cr);
+	}
+
+	// adds the uncorrected colours of the pixels [x0:x1) in row y
+	void AddRawPixels(int x0, int x1, int y, std::array<double, 3>& sum) const {
+		float luma = 0.f, cb = 0.f, cr = 0.f;
+		for (int x = x0; x < x1; x++) {
+			float pixelLuma, pixelCb, pixelCr;
+			ReadRun(x, y, 1, &pixelLuma, &pixelCb, &pixelCr);
+			luma += pixelLuma; cb += pixelCb; cr += pixelCr;
+		}
+		const auto amount = static_cast<float>(x1 - x0);
+		for (size_t c = 0; c < 3; c++) sum[c] += YccTransform::Apply(raw.rgb[c], luma, cb, cr, amount);
+	}
+};
+
+}
@@ -1,22 +1,43 @@
 #pragma once
 #include <JuceHeader.h> // for the camera device class
-#include <iostream>
+#include <memory>
+#include "../Commons/CameraFeed.hpp"
 
 namespace HueShift {
 
-class Camera : public juce::Component {
+// shows the live picture of the processor's camera. The device itself belongs to the CameraFeed,
+// this only owns the viewer component, which goes away with the editor.
+class Camera : public juce::Component, public juce::Timer {
 private:
-    CameraDevice* camera = nullptr;
-    Component* cameraViewer = nullptr;
+    CameraFeed& feed;
+    std::unique_ptr<Component> cameraViewer;
+    int shownGeneration = -1;
+
+    // the feed switches devices in the background, follow it
+    void timerCallback() override {
+        if (feed.GetGeneration() == shownGeneration) return;
+
+        if (cameraViewer != nullptr) removeChildComponent(cameraViewer.get());
+        cameraViewer.reset(); // before asking for the new one, the old device may go once this is gone
+        cameraViewer.reset(feed.CreateViewer(shownGeneration));
+        if (cameraViewer == nullptr) return;
+
+        addAndMakeVisible(cameraViewer.get());
+        resized();
+    }
 
 public:
-    Camera() {
-       
+    Camera(CameraFeed& feed)
+    : feed(feed)
+    {
+        timerCallback();
+        startTimerHz(4);
     }
 
-    ~Camera() {
-        delete camera;
-        delete cameraViewer;
+    ~Camera() override {
+        stopTimer();
+        cameraViewer.reset();
+        feed.ViewerDeleted();
     }
 
     void resized() override {
@@ -24,29 +45,6 @@ public:
             cameraViewer->setBounds(getLocalBounds());
         }
     }
-
-    void SetCamera(CameraDevice* cam) {
-        if (cam == nullptr){ 
-            std::cout << "Camera could not be opened\n";
-            return;
-        }
-
-        delete camera;
-        delete cameraViewer;
-
-        camera = cam;
-        cameraViewer = camera->createViewerComponent();
-        addAndMakeVisible(cameraViewer);
-        resized();
-    }
-    
-    // does nothing if there is no camera turned on
-    void GetSnapshot(std::function<void (const juce::Image&)> snapshotCallback) const {
-        // make sure there's a camera active when taking the picture
-        if (camera == nullptr || cameraViewer == nullptr) return;
-        
-        camera->takeStillPicture(snapshotCallback);
-    }
 };
 
 }
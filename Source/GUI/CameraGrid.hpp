@@ -1,111 +1,78 @@
 #pragma once
 #include <JuceHeader.h>
-#include "Camera.h"
-#include <vector>
+#include "../Commons/CellBuffer.hpp"
 
 namespace HueShift{
 
 
+// the editor's view of the analysis. The analysis itself runs in the processor, this only reads the published cells
+// and repaints when a new frame came through, so an open editor costs a copy and a paint per frame.
 class CameraGrid : public juce::Component, public juce::Timer {
 private:
-	const HueShift::Camera& camera;
 	HueShiftProcessor& audioProcessor;
-	juce::Image currentSnapshot;
-	std::vector<std::vector<juce::Colour>> snapshotOutput{}; // row -> column
-
-	bool updatedColoursOnce = false;
-	
-	unsigned int samplePoints = 13, widthDivision = 2, heightDivision = 1;
-	
-	// samplePoints is how many pixels to check per section, width division is how many sections you want in the x axis, same for height.
-	void CalculateGridOutput(const juce::Image& img, const unsigned int& samplePointsPerSection, const unsigned int& widthDivision, const unsigned int& heightDivision) {
-		int width = img.getWidth();
-		int height = img.getHeight();
-
-		int pixelsPerWidth = width / widthDivision;
-		int pixelsPerHeight = height / heightDivision;
-
-		snapshotOutput.clear();
-		snapshotOutput.reserve(heightDivision);
-		for (int i = 0; i < heightDivision; i++) {
-			std::vector<juce::Colour> vec{};
-			vec.resize(widthDivision);
-			snapshotOutput.push_back(vec);
-		}
+	HueShift::CellBuffer cells{}; // row major, what is shown
+	juce::uint64 shownFrameIndex = 0;
+	bool showing = false;
 
-		for (int h = 0; h < heightDivision; h++){
-			for (int w = 0; w < widthDivision; w++){
-				int r{}, g{}, b{};
-				const int x = w*pixelsPerWidth;
-				const int y = h*pixelsPerHeight;
-				const int sectionPixelAmount = pixelsPerWidth * pixelsPerHeight;
-				const int addPerSample = sectionPixelAmount / samplePointsPerSection;
-
-				for (int sample = 0; sample < samplePointsPerSection; sample++){
-					if (sample > sectionPixelAmount) break;
-					
-					int addX = (sample * addPerSample) % pixelsPerWidth;
-					int addY = (sample * addPerSample) / pixelsPerHeight;
-
-					auto pix = img.getPixelAt(x+addX, y+addY);
-					r += pix.getRed();
-					g += pix.getGreen();
-					b += pix.getBlue();
-				}
+	void timerCallback() override {
+		// hidden behind a tab or minimised, the analysis may go back to previews for the cells nobody plays
+		if (isShowing() != showing) {
+			showing = isShowing();
+			audioProcessor.SetGridShowing(showing);
+		}
 
-				r /= samplePointsPerSection;
-				g /= samplePointsPerSection;
-				b /= samplePointsPerSection;
+		if (!audioProcessor.ReadLatestCells(cells) || cells.frameIndex == shownFrameIndex) return;
 
-				snapshotOutput[h][w] = juce::Colour(r, g, b);
-			}
-		}
+		shownFrameIndex = cells.frameIndex;
+		repaint();
 	}
-	
-	void timerCallback() override {
-		UpdateGrid();
 
-		// copy over the output to the processor
-		const std::lock_guard<std::mutex> lock(audioProcessor.colourDataGuard);
-		audioProcessor.colourData = GetIndexBasedColours();
+	// each region filled with its colour. False if they can't be drawn that way (a painted mask, or cells from before the regions).
+	bool PaintRegions(Graphics& g, juce::Rectangle<float> bounds) {
+		const auto regions = audioProcessor.GetRegions();
+		if (regions.empty() || regions.size() != cells.size()) return false;
+		for (const auto& region : regions) {
+			if (region.polygon.size() < 3) return false;
+		}
 
-		updatedColoursOnce = true;
+		const auto voiceState = audioProcessor.GetVoiceState();
+		for (size_t i = 0; i < regions.size(); i++) {
+			const auto outline = GetOutline(regions[i], bounds);
+			g.setColour(cells[i].GetColour());
+			g.fillPath(outline);
+			g.setColour(voiceState.isVoiceEnabled(i) ? juce::Colours::white : juce::Colours::black);
+			g.strokePath(outline, juce::PathStrokeType(2.f));
+		}
+		return true;
 	}
 
 	void paint(Graphics &g) override {
 		// g.drawImage(currentSnapshot, getLocalBounds().toFloat(), RectanglePlacement::onlyReduceInSize);
 		
-		auto bounds = getLocalBounds().toFloat();
-		float xToYRelation = currentSnapshot.getWidth() / (currentSnapshot.getHeight()*1.f);
-		float boundRatio = bounds.getWidth() / bounds.getHeight();
-		
-		if (boundRatio > xToYRelation) { 
-			bounds.setWidth(bounds.getHeight() * xToYRelation );
-			bounds.setX((getLocalBounds().getWidth() - bounds.getWidth()) * 0.5f);
-		} else {
-			bounds.setHeight(bounds.getWidth() / xToYRelation);
-			bounds.setY((getLocalBounds().getHeight() - bounds.getHeight()) * 0.5f);
-		}
+		auto bounds = GetImageBounds();
+		if (bounds.isEmpty()) return; // nothing analysed yet
+		if (PaintRegions(g, bounds)) return;
+
+		// regions come out as one row, so paint what the analyser made instead of what the settings say
+		const auto widthDivision = cells.width;
+		const auto heightDivision = cells.height;
+		if (widthDivision == 0 || heightDivision == 0) return;
 
 		const float widthPerSection = bounds.getWidth() / widthDivision;
 		const float heightPerSection = bounds.getHeight() / heightDivision;
+		const auto voiceState = audioProcessor.GetVoiceState();
 
-		for (int h = 0; h < heightDivision; h++) {
-			if (h+1 > snapshotOutput.size()) break;
-
+		for (juce::uint32 h = 0; h < heightDivision; h++) {
 			auto heightBounds = bounds.removeFromTop(heightPerSection);
-			for (int w = 0; w < widthDivision; w++) {
-				if (w+1 > snapshotOutput[h].size()) break;
+			for (juce::uint32 w = 0; w < widthDivision; w++) {
 				auto sectionBounds = heightBounds.removeFromLeft(widthPerSection);
 
-				g.setColour(snapshotOutput[h][w]);
+				g.setColour(cells.at(h, w).GetColour());
 				g.fillRect(sectionBounds);
 				// if enabled draw rect on the border
 				g.setColour(juce::Colours::black);
-				if (updatedColoursOnce){
-					if (audioProcessor.isVoiceEnabled(h, w, widthDivision)){
-						g.setColour(juce::Colours::white);
-					}
+				if (voiceState.isVoiceEnabled(h * widthDivision + w)){
+					g.setColour(juce::Colours::white);
 				}
 				g.drawRect(sectionBounds, 2.f);
 			}
@@ -113,58 +80,77 @@ private:
 	}
 
 	void mouseUp(const MouseEvent &event) override {
-		UpdateGrid();	
+		audioProcessor.analysis.AnalyseNow();
 	}
 
 public:
-	CameraGrid(const HueShift::Camera& camera, HueShiftProcessor& processor, const int& snapshotHz)
-	: camera(camera), audioProcessor(processor)
+	CameraGrid(HueShiftProcessor& processor)
+	: audioProcessor(processor)
 	{
-		startTimerHz(snapshotHz);
+		startTimerHz(VIEWER_HZ);
 	}
 
 	~CameraGrid() {
 		stopTimer();
+		audioProcessor.SetGridShowing(false);
 	}
 
-
-	void UpdateGrid() {
-		auto onPic = [this](const juce::Image& img){
-			currentSnapshot = img;
-			CalculateGridOutput(
-				currentSnapshot,
-				samplePoints, widthDivision, heightDivision
-			);
-			repaint();
-		};
-
-		camera.GetSnapshot(onPic);
+	// the settings live in the processor so they get saved with the project, they are picked up on the next frame.
+	void SetGridSettings(unsigned int samplePoints, unsigned int widthDivision, unsigned int heightDivision){
+		auto settings = audioProcessor.GetGridSettings();
+		settings.samplePoints = samplePoints;
+		settings.widthDivision = widthDivision;
+		settings.heightDivision = heightDivision;
+		audioProcessor.SetGridSettings(settings);
 	}
 
-	void SetGridSettings(unsigned int samplePoints, unsigned int widthDivision, unsigned int heightDivision){
-		this->samplePoints = samplePoints;
-		this->widthDivision = widthDivision;
-		this->heightDivision = heightDivision;
+	// fraction of one core the analysis may take before the quality gets lowered
+	void SetCpuBudget(float fractionOfOneCore) {
+		audioProcessor.analysis.SetCpuBudget(fractionOfOneCore);
 	}
 
-	// vec[y][x] where y goes from top to bottom and x goes from left to right
-	std::vector<std::vector<juce::Colour>> GetGridColours() const {
-		return snapshotOutput;
+	void SetCellStatistic(HueShift::CellStatistic statistic) {
+		auto settings = audioProcessor.GetGridSettings();
+		settings.statistic = statistic;
+		audioProcessor.SetGridSettings(settings);
 	}
 
-	// the colours are ordered from left up to right down
-	std::vector<juce::Colour> GetIndexBasedColours() {
-		auto colours = GetGridColours();
-		std::vector<juce::Colour> indexBasedColours;
-		indexBasedColours.reserve(widthDivision * heightDivision);
+	// where the camera image is shown, its aspect ratio fitted into the component. Empty before the first frame.
+	juce::Rectangle<float> GetImageBounds() const {
+		auto bounds = getLocalBounds().toFloat();
+		const int frameWidth = audioProcessor.analysis.GetFrameWidth();
+		const int frameHeight = audioProcessor.analysis.GetFrameHeight();
+		if (frameWidth <= 0 || frameHeight <= 0 || bounds.isEmpty()) return {};
 
-		for (const auto& xVec : colours) {
-			for (auto colour : xVec) {
-				indexBasedColours.push_back(colour);
-			}
+		float xToYRelation = frameWidth / (frameHeight*1.f);
+		float boundRatio = bounds.getWidth() / bounds.getHeight();
+		
+		if (boundRatio > xToYRelation) { 
+			bounds.setWidth(bounds.getHeight() * xToYRelation );
+			bounds.setX((getLocalBounds().getWidth() - bounds.getWidth()) * 0.5f);
+		} else {
+			bounds.setHeight(bounds.getWidth() / xToYRelation);
+			bounds.setY((getLocalBounds().getHeight() - bounds.getHeight()) * 0.5f);
 		}
+		return bounds;
+	}
+
+	// a region's polygon in component coordinates, for an image shown in bounds
+	static juce::Path GetOutline(const HueShift::RegionShape& region, juce::Rectangle<float> bounds) {
+		juce::Path outline;
+		for (size_t i = 0; i < region.polygon.size(); i++) {
+			const auto& point = region.polygon[i];
+			const juce::Point<float> position(bounds.getX() + point.x * bounds.getWidth(), bounds.getY() + point.y * bounds.getHeight());
+			if (i == 0) outline.startNewSubPath(position);
+			else outline.lineTo(position);
+		}
+		outline.closeSubPath();
+		return outline;
+	}
 
-		return indexBasedColours;
+	// row major, the colours are ordered from left up to right down
+	const HueShift::CellBuffer& GetCells() const {
+		return cells;
 	}
 };
 
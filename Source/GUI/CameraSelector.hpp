@@ -1,47 +1,54 @@
 #pragma once
 #include <JuceHeader.h>
-#include "Camera.h"
+#include "../Commons/CameraFeed.hpp"
 
 namespace HueShift {
 
-class CameraSelector : public juce::ComboBox {
+// the device list comes from the feed's cache, so opening the editor never waits for the OS to list cameras.
+class CameraSelector : public juce::ComboBox, public juce::Timer {
 private:
-	HueShift::Camera& camera;
+	HueShift::CameraFeed& feed;
+	int shownDevicesVersion = -1;
 
 	void ResetCameraOptions() {
-		clear();
+		clear(juce::dontSendNotification);
 
-		auto devices = CameraDevice::getAvailableDevices();
+		addItemList(feed.GetDevices(), 1); // ID indexes start at 1, so not 0 :/
+		setText(feed.GetSelectedName(), juce::dontSendNotification); // the camera keeps running while the editor is closed
+	}
+
+	void timerCallback() override {
+		const auto version = feed.GetDevicesVersion();
+		if (version == shownDevicesVersion) return;
 
-		addItemList(devices, 1); // ID indexes start at 1, so not 0 :/
+		shownDevicesVersion = version;
+		ResetCameraOptions();
+	}
 
+public:
+	CameraSelector(HueShift::CameraFeed& feed)
+	: feed(feed)
+	{
 		onChange = [this](){
 			int idx = getSelectedItemIndex();
 			auto name = getItemText(idx);
 
-			auto devices = CameraDevice::getAvailableDevices();
-			idx = devices.indexOf(name);
-
-			auto newCam = CameraDevice::openDevice(
-				idx,    // device idx
-				0,      // min w
-				0,      // min h
-				8000, // 1024,   // max w
-				8000, // 768,    // max h
-				true    // high quality mode
-			);
-
-			camera.SetCamera(newCam);
+			this->feed.Open(name); // returns right away, the grid keeps running on the old camera until the new one delivers
 		};
+
+		timerCallback();
+		startTimerHz(2);
 	}
 
-public:
-	CameraSelector(HueShift::Camera& camera)
-	: camera(camera)
-	{
-		ResetCameraOptions();
+	~CameraSelector() override {
+		stopTimer();
 	}
 
+	// a camera might have been plugged in since the last look
+	void showPopup() override {
+		feed.RefreshDevices();
+		juce::ComboBox::showPopup();
+	}
 };
 
 }
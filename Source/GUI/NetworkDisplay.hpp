@@ -1,18 +1,19 @@
 #pragma once
 
 #include "JuceHeader.h"
-#include "../Commons/HardwareListener.hpp"
+#include "../Commons/NetworkReactor.hpp"
 
 namespace HueShift{
 
 class NetworkDisplay : public juce::Component, public juce::Timer {
 private:
     int port = 0;
-    const MIDIListenerUDP& hardwareListener;
+    const NetworkReactor& network;
+    const int instanceId;
     juce::Label label;
 public:
-    NetworkDisplay(const MIDIListenerUDP& hardwareListener)
-    :   hardwareListener(hardwareListener) {
+    NetworkDisplay(const NetworkReactor& network, int instanceId)
+    :   network(network), instanceId(instanceId) {
         startTimerHz(1);
         label.setText("Port: 0000", juce::NotificationType::dontSendNotification);
         addAndMakeVisible(label);
@@ -20,9 +21,9 @@ public:
 
     void timerCallback() override {
         auto prevPort = port;
-        port = hardwareListener.GetActivePort();
+        port = network.GetHardwarePort();
         if (port != prevPort)
-            label.setText("Port: " + std::to_string(port), juce::NotificationType::dontSendNotification);
+            label.setText("Port: " + std::to_string(port) + " #" + std::to_string(instanceId), juce::NotificationType::dontSendNotification);
     }
 
     void paint(juce::Graphics& g) override {
@@ -36,4 +37,4 @@ public:
 };
 
 
-}
\ No newline at end of file
+}
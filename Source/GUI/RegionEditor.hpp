@@ -0,0 +1,164 @@
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+#include "CameraGrid.hpp"
+
+namespace HueShift{
+
+/*
+	Draws and edits the regions on top of the camera grid. While "draw regions" is on:
+		- a click adds a point to a new polygon, clicking its first point again closes it and it becomes the next voice
+		- the points of existing polygons can be dragged
+		- a right click drops the polygon being drawn, or removes the region under the mouse
+	Every finished change goes to the processor (which saves them), the grid shows the regions filled with their colour.
+	Painted masks (only from a saved project) can't be edited here, they keep their place in the list.
+*/
+class RegionEditor : public juce::Component {
+private:
+	HueShiftProcessor& audioProcessor;
+	CameraGrid& grid;
+
+	juce::ToggleButton drawing{"draw regions"};
+	juce::TextButton clear{"clear regions"};
+
+	std::vector<HueShift::RegionShape> shapes{}; // what is being edited, in the processor's order
+	std::vector<juce::Point<float>> newPolygon{}; // normalised, not closed yet
+	int draggedRegion = -1;
+	int draggedPoint = -1;
+
+	static constexpr float grabDistance = 8.f; // pixels
+
+	juce::Point<float> ToImage(juce::Point<float> position) const {
+		const auto bounds = grid.GetImageBounds();
+		return {
+			juce::jlimit(0.f, 1.f, (position.x - bounds.getX()) / bounds.getWidth()),
+			juce::jlimit(0.f, 1.f, (position.y - bounds.getY()) / bounds.getHeight())
+		};
+	}
+
+	juce::Point<float> ToComponent(juce::Point<float> point) const {
+		const auto bounds = grid.GetImageBounds();
+		return {bounds.getX() + point.x * bounds.getWidth(), bounds.getY() + point.y * bounds.getHeight()};
+	}
+
+	void Commit() {
+		audioProcessor.SetRegions(shapes);
+		repaint();
+	}
+
+	void SetEditing(bool isEditing) {
+		newPolygon.clear();
+		draggedRegion = draggedPoint = -1;
+		if (isEditing) shapes = audioProcessor.GetRegions();
+		setInterceptsMouseClicks(isEditing, true); // the grid below gets the clicks otherwise
+		repaint();
+	}
+
+	// the polygon point within grabDistance of position, false if there is none
+	bool FindPoint(juce::Point<float> position, int& region, int& point) const {
+		for (size_t i = 0; i < shapes.size(); i++) {
+			for (size_t j = 0; j < shapes[i].polygon.size(); j++) {
+				if (ToComponent(shapes[i].polygon[j]).getDistanceFrom(position) > grabDistance) continue;
+				region = static_cast<int>(i);
+				point = static_cast<int>(j);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void mouseDown(const juce::MouseEvent& event) override {
+		if (grid.GetImageBounds().isEmpty()) return; // no frame yet, nothing to draw on
+
+		if (event.mods.isPopupMenu()) {
+			if (!newPolygon.empty()) {
+				newPolygon.clear();
+				repaint();
+				return;
+			}
+			const auto bounds = grid.GetImageBounds();
+			for (size_t i = shapes.size(); i-- > 0;) {
+				if (shapes[i].polygon.size() < 3 || !CameraGrid::GetOutline(shapes[i], bounds).contains(event.position)) continue;
+				shapes.erase(shapes.begin() + static_cast<long>(i));
+				Commit();
+				return;
+			}
+			return;
+		}
+
+		if (newPolygon.empty() && FindPoint(event.position, draggedRegion, draggedPoint)) return;
+
+		const bool closes = newPolygon.size() >= 3 && ToComponent(newPolygon.front()).getDistanceFrom(event.position) <= grabDistance;
+		if (closes && shapes.size() < MAX_VOICES) {
+			HueShift::RegionShape shape{};
+			shape.polygon = newPolygon;
+			shapes.push_back(std::move(shape));
+			newPolygon.clear();
+			Commit();
+			return;
+		}
+		if (!closes) newPolygon.push_back(ToImage(event.position));
+		repaint();
+	}
+
+	void mouseDrag(const juce::MouseEvent& event) override {
+		if (draggedRegion < 0) return;
+		shapes[static_cast<size_t>(draggedRegion)].polygon[static_cast<size_t>(draggedPoint)] = ToImage(event.position);
+		repaint();
+	}
+
+	void mouseUp(const juce::MouseEvent&) override {
+		if (draggedRegion < 0) return;
+		draggedRegion = draggedPoint = -1;
+		Commit(); // once per drag, every SetRegions recompiles
+	}
+
+public:
+	RegionEditor(HueShiftProcessor& processor, CameraGrid& grid)
+	: audioProcessor(processor), grid(grid)
+	{
+		drawing.onClick = [this](){ SetEditing(drawing.getToggleState()); };
+		drawing.setTooltip("click to add points, click the first point to close a region. Drag points to move them, right click removes a region");
+		addAndMakeVisible(drawing);
+
+		clear.onClick = [this](){
+			shapes.clear();
+			newPolygon.clear();
+			Commit(); // back to the grid
+		};
+		clear.setTooltip("removes every region, the grid from the settings is used again");
+		addAndMakeVisible(clear);
+
+		SetEditing(false);
+	}
+
+	void paint(juce::Graphics& g) override {
+		if (!drawing.getToggleState()) return;
+		const auto bounds = grid.GetImageBounds();
+		if (bounds.isEmpty()) return;
+
+		g.setColour(juce::Colours::yellow);
+		for (size_t i = 0; i < shapes.size(); i++) {
+			if (shapes[i].polygon.size() < 3) continue;
+			const auto outline = CameraGrid::GetOutline(shapes[i], bounds);
+			g.strokePath(outline, juce::PathStrokeType(1.5f));
+			g.drawText(juce::String(i + 1), outline.getBounds(), juce::Justification::centred);
+			for (const auto& point : shapes[i].polygon) g.fillEllipse(juce::Rectangle<float>(6.f, 6.f).withCentre(ToComponent(point)));
+		}
+
+		g.setColour(juce::Colours::orange);
+		for (size_t i = 0; i < newPolygon.size(); i++) {
+			const auto position = ToComponent(newPolygon[i]);
+			g.fillEllipse(juce::Rectangle<float>(i == 0 ? 10.f : 6.f, i == 0 ? 10.f : 6.f).withCentre(position));
+			if (i > 0) g.drawLine(juce::Line<float>(ToComponent(newPolygon[i - 1]), position), 1.5f);
+		}
+	}
+
+	void resized() override {
+		auto buttons = getLocalBounds().removeFromTop(24);
+		drawing.setBounds(buttons.removeFromLeft(110));
+		clear.setBounds(buttons.removeFromLeft(100));
+	}
+};
+
+}
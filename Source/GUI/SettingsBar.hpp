@@ -0,0 +1,148 @@
+#pragma once
+#include <JuceHeader.h>
+#include <algorithm>
+#include <vector>
+
+namespace HueShift{
+
+// the processing settings in one row of small controls. Shows what the processor has (a loaded project included) when the
+// editor opens, every change goes straight to the processor's setters, which also keep it for the saved state.
+class SettingsBar : public juce::Component {
+private:
+	HueShiftProcessor& audioProcessor;
+	std::vector<juce::Component*> controls{}; // left to right, all the same width
+	juce::TooltipWindow tooltips{this}; // the controls are too small for labels, hovering tells what they do
+
+	juce::Slider motionGate{juce::Slider::LinearHorizontal, juce::Slider::TextBoxRight};
+	juce::ComboBox ccStreams;
+	juce::ComboBox whiteBalance;
+	juce::ToggleButton exposure{"exposure"};
+	juce::ComboBox cellSmoothing;
+	juce::ComboBox frequencyGlide;
+	juce::ComboBox midiThru;
+	juce::ToggleButton dinOutput{"DIN"};
+	juce::TextEditor oscTarget;
+
+	static juce::String ToText(const HueShift::OscTarget& target) {
+		return target.IsOn() ? juce::String(target.host) + ":" + juce::String(target.port) : juce::String();
+	}
+
+	// host:port, the port can be left out. Empty turns the output off, anything that doesn't work shows what is set again.
+	void ApplyOscTarget() {
+		const auto text = oscTarget.getText().trim();
+		const bool hasPort = text.containsChar(':');
+		const auto host = hasPort ? text.upToLastOccurrenceOf(":", false, false) : text;
+		const int port = hasPort ? text.fromLastOccurrenceOf(":", false, false).getIntValue() : OSC_SEND_PORT;
+		if (port <= 0 || port > 65535 || !audioProcessor.SetOscTarget(host, port)) {
+			oscTarget.setText(ToText(audioProcessor.GetProcessingSettings().oscTarget), false);
+		}
+	}
+
+	template <typename Control>
+	void AddControl(Control& control, const juce::String& tooltip) {
+		control.setTooltip(tooltip);
+		addAndMakeVisible(control);
+		controls.push_back(&control);
+	}
+
+public:
+	SettingsBar(HueShiftProcessor& processor)
+	: audioProcessor(processor)
+	{
+		const auto settings = audioProcessor.GetProcessingSettings();
+
+		motionGate.setRange(0.0, 0.2, 0.005); // a cell's motion is [0:1], anything past 0.2 is a lot already
+		motionGate.setValue(settings.motionGate, juce::dontSendNotification);
+		motionGate.setTextBoxStyle(juce::Slider::TextBoxRight, false, 40, 20);
+		motionGate.onValueChange = [this](){ audioProcessor.SetMotionGate(static_cast<float>(motionGate.getValue())); };
+		AddControl(motionGate, "motion gate: voices only pulse while their cell moves at least this much, 0 is off");
+
+		ccStreams.addItemList({"no CC streams", "CC 7 bit", "CC 14 bit", "NRPN"}, 1); // in CcStreamMode's order
+		ccStreams.setSelectedItemIndex(static_cast<int>(settings.ccStreams.mode), juce::dontSendNotification);
+		ccStreams.onChange = [this](){
+			auto streams = audioProcessor.GetProcessingSettings().ccStreams; // only the mode changes here
+			streams.mode = static_cast<HueShift::CcStreamMode>(ccStreams.getSelectedItemIndex());
+			audioProcessor.SetCcStreams(streams);
+		};
+		AddControl(ccStreams, "every cell's hue, saturation and brightness as controllers, next to the notes");
+
+		// the correction's other fields (black level, gains, the patch) keep what was saved
+		whiteBalance.addItemList({"no white balance", "grey world", "reference patch"}, 1); // in WhiteBalanceMode's order
+		whiteBalance.setSelectedItemIndex(static_cast<int>(settings.colourCorrection.whiteBalance), juce::dontSendNotification);
+		whiteBalance.onChange = [this](){
+			auto correction = audioProcessor.GetProcessingSettings().colourCorrection;
+			correction.whiteBalance = static_cast<HueShift::WhiteBalanceMode>(whiteBalance.getSelectedItemIndex());
+			audioProcessor.SetColourCorrection(correction);
+		};
+		AddControl(whiteBalance, "undoes the camera's white balance drifting: the frame's average, or the patch in the middle, is grey");
+
+		exposure.setToggleState(settings.colourCorrection.normaliseExposure, juce::dontSendNotification);
+		exposure.onClick = [this](){
+			auto correction = audioProcessor.GetProcessingSettings().colourCorrection;
+			correction.normaliseExposure = exposure.getToggleState();
+			audioProcessor.SetColourCorrection(correction);
+		};
+		AddControl(exposure, "keeps the frame's brightness steady while the camera's auto exposure moves");
+
+		// the ema amount and the band hysteresis keep what was saved, the median length is part of the choice
+		cellSmoothing.addItemList({"no smoothing", "smooth", "median of 3", "median of 5"}, 1);
+		const auto& smoothing = settings.cellSmoothing;
+		cellSmoothing.setSelectedItemIndex(smoothing.mode != HueShift::CellSmoothingMode::median ? static_cast<int>(smoothing.mode)
+			: (smoothing.medianLength >= 5 ? 3 : 2), juce::dontSendNotification);
+		cellSmoothing.onChange = [this](){
+			auto smoothing = audioProcessor.GetProcessingSettings().cellSmoothing;
+			const int index = cellSmoothing.getSelectedItemIndex();
+			smoothing.mode = static_cast<HueShift::CellSmoothingMode>(std::min(index, 2));
+			if (index >= 2) smoothing.medianLength = index == 3 ? 5 : 3;
+			audioProcessor.SetCellSmoothing(smoothing);
+		};
+		AddControl(cellSmoothing, "keeps camera noise from flipping cells between colours, the median ignores single noisy frames");
+
+		// the slew time keeps what was saved, unless it was 0 (which is the jump)
+		frequencyGlide.addItemList({"frequency jumps", "frequency slews", "frequency glides behind"}, 1);
+		const auto& glide = settings.frequencyGlide;
+		frequencyGlide.setSelectedItemIndex(glide.lookBehind ? 2 : (glide.slewSeconds > 0.f ? 1 : 0), juce::dontSendNotification);
+		frequencyGlide.onChange = [this](){
+			auto glide = audioProcessor.GetProcessingSettings().frequencyGlide;
+			const int index = frequencyGlide.getSelectedItemIndex();
+			glide.lookBehind = index == 2;
+			if (index == 0) glide.slewSeconds = 0.f;
+			else if (glide.slewSeconds <= 0.f) glide.slewSeconds = FREQUENCY_SLEW_SECONDS;
+			audioProcessor.SetFrequencyGlide(glide);
+		};
+		AddControl(frequencyGlide, "how the voices get to a new frame's frequency: at once, in a short slew, or over the whole time until the next frame (a frame later, but never a step)");
+
+		midiThru.addItemList({"no MIDI thru", "thru, not the notes", "thru, everything"}, 1); // in MidiPassthrough's order
+		midiThru.setSelectedItemIndex(static_cast<int>(settings.midiOutput.passthrough), juce::dontSendNotification);
+		midiThru.onChange = [this](){
+			HueShift::MidiOutputSettings output{};
+			output.passthrough = static_cast<HueShift::MidiPassthrough>(midiThru.getSelectedItemIndex());
+			audioProcessor.SetMidiOutput(output);
+		};
+		AddControl(midiThru, "which incoming MIDI goes on down the chain. Passed notes share the generated notes' channels");
+
+		dinOutput.setToggleState(settings.midiScheduler.bytesPerSecond > 0.f, juce::dontSendNotification);
+		dinOutput.onClick = [this](){
+			audioProcessor.SetMidiScheduler(dinOutput.getToggleState() ? HueShift::MidiSchedulerSettings::ForDin() : HueShift::MidiSchedulerSettings{});
+		};
+		AddControl(dinOutput, "limits the output to what a hardware MIDI cable carries, bursts get spread and pulses that don't fit dropped");
+
+		oscTarget.setTextToShowWhenEmpty("no OSC out", juce::Colours::grey);
+		oscTarget.setText(ToText(settings.oscTarget), false);
+		oscTarget.onReturnKey = [this](){ ApplyOscTarget(); };
+		oscTarget.onFocusLost = [this](){ ApplyOscTarget(); };
+		AddControl(oscTarget, juce::String("sends the cells and voices as OSC to host:port, like ") + OSC_SEND_HOST + ":" + juce::String(OSC_SEND_PORT) + ". Empty is off");
+	}
+
+	void paint(juce::Graphics& g) override {
+		g.fillAll(juce::Colours::black.withAlpha(.5f));
+	}
+
+	void resized() override {
+		auto bounds = getLocalBounds();
+		const int width = controls.empty() ? 0 : bounds.getWidth() / static_cast<int>(controls.size());
+		for (auto* control : controls) control->setBounds(bounds.removeFromLeft(width));
+	}
+};
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "JuceHeader.h"
+#include "../Commons/Telemetry.hpp"
+#include "../DSP/AnalysisGovernor.hpp"
+
+namespace HueShift{
+
+// one line of live numbers about the analysis, next to the port display.
+class TelemetryDisplay : public juce::Component, public juce::Timer {
+private:
+    const Telemetry& telemetry;
+    juce::Label label;
+public:
+    TelemetryDisplay(const Telemetry& telemetry)
+    :   telemetry(telemetry) {
+        startTimerHz(4);
+        addAndMakeVisible(label);
+    }
+
+    void timerCallback() override {
+        const auto level = telemetry.qualityLevel.load();
+        const auto milliseconds = telemetry.analysisMilliseconds.load();
+        const auto load = telemetry.analysisLoad.load();
+        const auto hz = telemetry.analysisHz.load();
+        const auto motion = telemetry.averageMotion.load();
+        const auto exposure = telemetry.exposureGain.load();
+        const auto whiteBalance = telemetry.whiteBalanceSpread.load();
+        const auto cellsInFull = telemetry.cellsInFull.load();
+        const auto heldBack = telemetry.bandChangesSuppressed.load();
+
+        label.setText(
+            juce::String("Quality: ") + AnalysisGovernor::GetLevelName(level)
+            + " | " + juce::String(milliseconds, 1) + " ms @ " + juce::String(hz) + " Hz"
+            + " | " + juce::String(juce::roundToInt(load * 100.f)) + "% CPU"
+            + " | " + juce::String(cellsInFull) + " cells in full"
+            + " | " + juce::String(static_cast<juce::int64>(heldBack)) + " band flips held"
+            + " | motion " + juce::String(motion * 100.f, 1) + "%"
+            + " | exposure x" + juce::String(exposure, 2) + " wb x" + juce::String(whiteBalance, 2),
+            juce::NotificationType::dontSendNotification
+        );
+    }
+
+    void paint(juce::Graphics& g) override {
+        g.fillAll(juce::Colours::black.withAlpha(.5f));
+    }
+
+    void resized() override {
+        label.setBounds(getLocalBounds());
+    }
+};
+
+
+}
@@ -12,29 +12,29 @@
 //==============================================================================
 HueShiftEditor::HueShiftEditor(HueShiftProcessor& p)
     : AudioProcessorEditor(&p), audioProcessor(p),
-    cameraSelector(camera),
-    cameraGrid(camera, p, 50),
-    network(audioProcessor.hardwareListener)
+    camera(p.cameraFeed),
+    cameraSelector(p.cameraFeed),
+    cameraGrid(p),
+    regionEditor(p, cameraGrid),
+    network(*audioProcessor.network, audioProcessor.GetInstanceId()),
+    telemetryDisplay(audioProcessor.telemetry),
+    settingsBar(p)
 {
     setSize (1500, 500);
     setResizable(true, true);
 
-    float scale = 1080/1920.f;
-    int x = 5;
-
-    cameraGrid.SetGridSettings(13, x, int(x*scale));
-
     addAndMakeVisible(camera);
     addAndMakeVisible(cameraSelector);
     addAndMakeVisible(cameraGrid);
+    addAndMakeVisible(regionEditor);
 
     addAndMakeVisible(network);
-    audioProcessor.isEditorActive = true;
+    addAndMakeVisible(telemetryDisplay);
+    addAndMakeVisible(settingsBar);
 }
 
 HueShiftEditor::~HueShiftEditor()
 {
-  audioProcessor.isEditorActive = false;
 }
 
 //==============================================================================
@@ -50,10 +50,14 @@ void HueShiftEditor::resized()
     auto upperTabsBounds = bounds.removeFromTop(bounds.getHeight()*0.05f);
     auto camSelectorBounds = upperTabsBounds.removeFromRight(upperTabsBounds.getWidth() * 0.2f);
     auto portNumberBounds = upperTabsBounds.removeFromLeft(upperTabsBounds.getWidth()*0.1f);
+    auto telemetryBounds = upperTabsBounds.removeFromLeft(upperTabsBounds.getWidth()*0.4f);
 
     cameraSelector.setBounds(camSelectorBounds);
     network.setBounds(portNumberBounds);
+    telemetryDisplay.setBounds(telemetryBounds);
+    settingsBar.setBounds(upperTabsBounds);
     camera.setBounds(bounds.removeFromRight(bounds.getWidth()*0.5f));
     cameraGrid.setBounds(bounds);
+    regionEditor.setBounds(bounds);
 
 }
@@ -13,7 +13,10 @@
 #include "GUI/Camera.h"
 #include "GUI/CameraSelector.hpp"
 #include "GUI/CameraGrid.hpp"
+#include "GUI/RegionEditor.hpp"
 #include "GUI/NetworkDisplay.hpp"
+#include "GUI/TelemetryDisplay.hpp"
+#include "GUI/SettingsBar.hpp"
 
 //==============================================================================
 /**
@@ -33,11 +36,14 @@ private:
     // access the processor object that created it.
     HueShiftProcessor& audioProcessor;
     
-    HueShift::Camera camera{};
+    HueShift::Camera camera;
     HueShift::CameraSelector cameraSelector;
     HueShift::CameraGrid cameraGrid; 
+    HueShift::RegionEditor regionEditor; // on top of the grid
 
     HueShift::NetworkDisplay network;
+    HueShift::TelemetryDisplay telemetryDisplay;
+    HueShift::SettingsBar settingsBar;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (HueShiftEditor)
 };
@@ -20,53 +20,227 @@ HueShiftProcessor::HueShiftProcessor()
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
                        ),
-                    handler(midiOutputBuffer),
-                    hardwareListener(handler, midiUpdateGuard),
-                    discoveryHandler()
+                    analysis(cameraFeed, regionCompiler, telemetry,
+                        [this]() { return GetGridSettings(); },
+                        [this]() { return GetCellDemand(); },
+                        [this](const HueShift::CellBuffer& cells) { PublishCells(cells); }),
+                    presets(handler)
 #endif
-{   
+{
+    instanceId = network->Register(networkCommands, handler);
+    oscOutput.SetInstanceId(instanceId);
+    analysis.startThread(juce::Thread::Priority::normal); // everything it publishes to exists by now
 }
 
 HueShiftProcessor::~HueShiftProcessor()
-{}
+{
+    analysis.stopThread(3000); // it publishes into members that are destroyed before it
+    network->Unregister(instanceId); // before networkCommands and the handler go away
+}
 
 //==============================================================================
 void HueShiftProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
     juce::ignoreUnused(sampleRate, samplesPerBlock);
 
-    std::unique_lock<std::mutex> lock(midiUpdateGuard, std::try_to_lock);
-    while (!lock.owns_lock()){
-        lock = std::unique_lock<std::mutex>{midiUpdateGuard, std::try_to_lock};
-    }
-
-    handler.Reset(sampleRate, Time::getMillisecondCounterHiRes() * 0.001);
+    handler.Reset(sampleRate, Time::getMillisecondCounterHiRes() * 0.001); // also reserves the MIDI output's worst case
+    sharedFeed.ResetClock();
 }
 
 void HueShiftProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
     juce::ignoreUnused(buffer);
-    if (hadEditor && !isEditorActive) {
-        hadEditor = false;
-        handler.Reset(handler.GetSampleRate(), Time::getMillisecondCounterHiRes() * 0.001);
-    }
+    const HueShift::RealtimeAudit::ScopedRealtimeSection realtimeSection;
+
+    // a plain copy out of the snapshot ring, keeps the previous cells if nothing was published yet.
+    publishedCells.Read(blockCells);
+
+    // everything the controllers sent since the last block, applied in order of arrival.
+    DrainNetworkCommands();
+
+    // the generated messages go straight into the host's buffer, next to the input that passes, see MidiOutputStage.
+    handler.Process(midiMessages, blockCells, buffer.getNumSamples(), blockCommands);
+    telemetry.samplesProcessed.store(handler.GetElapsedSamples(), std::memory_order_relaxed);
+    telemetry.ccMessagesSent.store(handler.GetCcSentCount(), std::memory_order_relaxed);
+    telemetry.ccThrottledBlocks.store(handler.GetCcThrottledCount(), std::memory_order_relaxed);
+    const auto& scheduler = handler.GetScheduler();
+    telemetry.midiCoalesced.store(scheduler.GetCoalescedCount(), std::memory_order_relaxed);
+    telemetry.midiDropped.store(scheduler.GetDroppedCount(), std::memory_order_relaxed);
+    telemetry.midiDeferred.store(scheduler.GetDeferredCount(), std::memory_order_relaxed);
+    telemetry.midiSpread.store(scheduler.GetSpreadCount(), std::memory_order_relaxed);
+    if (sharedFeed.IsOpen()) sharedFeed.PublishBlock(handler.GetVoiceState(), scheduler.GetSentNotes(), buffer.getNumSamples());
+}
 
-    try {
-        const std::lock_guard<std::mutex> lock(colourDataGuard);
-        handler.Process(midiMessages, colourData, buffer.getNumSamples());
-    } catch (std::logic_error&) {
-        std::cout << "couldn't gain lock for midihandler from processBlock\n";
-    }
+void HueShiftProcessor::DrainNetworkCommands() {
+    blockCommands.clear();
 
-    // swap with input buffer
-    midiMessages = midiOutputBuffer;
-    midiOutputBuffer.clear();
+    // every batch is what the network collected in one wakeup, already coalesced. A few per block, the rest waits.
+    for (int i = 0; i < NETWORK_BATCHES_PER_BLOCK && networkCommands.Pop(drainedBatch); i++) {
+        for (const auto& command : drainedBatch.commands) {
+            if (command.type == HueShift::VoiceCommand::Type::cameraHz) analysis.SetAnalysisHz(command.index); // not a voice command
+            else blockCommands.commands.push_back(command);
+        }
+    }
 }
 
 bool HueShiftProcessor::isVoiceEnabled(size_t row, size_t column, size_t amtColumns) const {
     return handler.isVoiceEnabled(column, row, amtColumns);
 }
 
+void HueShiftProcessor::PublishCells(const HueShift::CellBuffer& cells) {
+    publishedCells.Publish(cells);
+    sharedFeed.PublishCells(cells);
+    oscOutput.SendFrame(cells, handler.GetVoiceState());
+}
+
+bool HueShiftProcessor::ReadLatestCells(HueShift::CellBuffer& output) const {
+    return publishedCells.Read(output);
+}
+
+HueShift::CellDemand HueShiftProcessor::GetCellDemand() const {
+    // the streams send every cell's colour, and whoever looks at the grid should see what the analysis really finds
+    if (ccStreamsActive.load() || gridShowing.load()) return HueShift::CellDemand::All();
+
+    // frozen voices keep their frequency, whatever the cell shows
+    const auto voices = handler.GetVoiceState();
+    HueShift::CellDemand demand{};
+    demand.full = voices.enabled & ~voices.frozen;
+    return demand;
+}
+
+void HueShiftProcessor::SetGridShowing(bool isShowing) {
+    if (gridShowing.exchange(isShowing) != isShowing && isShowing) analysis.AnalyseNow(); // don't show the previews until the next frame
+}
+
+void HueShiftProcessor::SetMotionGate(float threshold) {
+    handler.SetMotionGate(threshold);
+    analysis.SetMotionGating(threshold > 0.f);
+
+    const std::lock_guard<std::mutex> lock(processingGuard);
+    processing.motionGate = threshold;
+}
+
+void HueShiftProcessor::SetCcStreams(const HueShift::CcStreamSettings& settings) {
+    handler.SetCcStreams(settings);
+    ccStreamsActive.store(settings.mode != HueShift::CcStreamMode::off);
+
+    const std::lock_guard<std::mutex> lock(processingGuard);
+    processing.ccStreams = settings;
+}
+
+void HueShiftProcessor::SetColourCorrection(const HueShift::ColourCorrectionSettings& settings) {
+    analysis.SetColourCorrection(settings);
+
+    const std::lock_guard<std::mutex> lock(processingGuard);
+    processing.colourCorrection = settings;
+}
+
+void HueShiftProcessor::SetCellSmoothing(const HueShift::CellSmoothingSettings& settings) {
+    analysis.SetCellSmoothing(settings);
+
+    const std::lock_guard<std::mutex> lock(processingGuard);
+    processing.cellSmoothing = settings;
+}
+
+void HueShiftProcessor::SetFrequencyGlide(const HueShift::FrequencyGlideSettings& settings) {
+    handler.SetFrequencyGlide(settings);
+
+    const std::lock_guard<std::mutex> lock(processingGuard);
+    processing.frequencyGlide = settings;
+}
+
+void HueShiftProcessor::SetMidiScheduler(const HueShift::MidiSchedulerSettings& settings) {
+    handler.SetMidiScheduler(settings);
+
+    const std::lock_guard<std::mutex> lock(processingGuard);
+    processing.midiScheduler = settings;
+}
+
+void HueShiftProcessor::SetMidiOutput(const HueShift::MidiOutputSettings& settings) {
+    handler.SetMidiOutput(settings);
+
+    const std::lock_guard<std::mutex> lock(processingGuard);
+    processing.midiOutput = settings;
+}
+
+HueShift::ProcessingSettings HueShiftProcessor::GetProcessingSettings() const {
+    const std::lock_guard<std::mutex> lock(processingGuard);
+    return processing;
+}
+
+void HueShiftProcessor::SetProcessingSettings(const HueShift::ProcessingSettings& settings) {
+    SetMotionGate(settings.motionGate);
+    SetCcStreams(settings.ccStreams);
+    SetColourCorrection(settings.colourCorrection);
+    SetCellSmoothing(settings.cellSmoothing);
+    SetMidiOutput(settings.midiOutput);
+    SetMidiScheduler(settings.midiScheduler);
+    SetFrequencyGlide(settings.frequencyGlide);
+    SetOscTarget(settings.oscTarget.host, settings.oscTarget.port);
+}
+
+bool HueShiftProcessor::SetOscTarget(const juce::String& host, int port) {
+    HueShift::OscTarget target{};
+    target.port = port;
+    if (!target.SetHost(host)) return false;
+
+    const std::lock_guard<std::mutex> lock(processingGuard); // also keeps SetTarget to one caller at a time
+    oscOutput.SetTarget(target);
+    processing.oscTarget = target;
+    return true;
+}
+
+HueShift::VoiceStateSnapshot HueShiftProcessor::GetVoiceState() const {
+    return handler.GetVoiceState();
+}
+
+HueShift::GridSettings HueShiftProcessor::GetGridSettings() const {
+    const std::lock_guard<std::mutex> lock(gridSettingsGuard);
+    return gridSettings;
+}
+
+void HueShiftProcessor::SetGridSettings(const HueShift::GridSettings& settings) {
+    const std::lock_guard<std::mutex> lock(gridSettingsGuard);
+    gridSettings = settings;
+}
+
+HueShift::PluginState HueShiftProcessor::GetCurrentState() const {
+    HueShift::PluginState state{};
+    state.grid = GetGridSettings();
+    state.regions = GetRegions();
+
+    // a preset that wasn't applied yet (no blocks processed since it was recalled) is what the user expects to be saved.
+    if (!presets.GetPendingVoices(state.voices)) state.voices = handler.GetVoiceState();
+
+    return state;
+}
+
+void HueShiftProcessor::StorePreset(const juce::String& name) {
+    presets.Store(name, GetCurrentState());
+}
+
+bool HueShiftProcessor::RecallPreset(const juce::String& name) {
+    HueShift::PluginState preset{};
+    if (!presets.Recall(name, preset)) return false;
+
+    SetGridSettings(preset.grid);
+    SetRegions(std::move(preset.regions));
+    return true;
+}
+
+juce::StringArray HueShiftProcessor::GetPresetNames() const {
+    return presets.GetNames();
+}
+
+void HueShiftProcessor::SetRegions(std::vector<HueShift::RegionShape> shapes) {
+    if (shapes.size() > MAX_VOICES) shapes.resize(MAX_VOICES); // one voice each
+    regionCompiler.SetShapes(std::move(shapes));
+}
+
+std::vector<HueShift::RegionShape> HueShiftProcessor::GetRegions() const {
+    return regionCompiler.GetShapes();
+}
+
 const juce::String HueShiftProcessor::getName() const
 {
     return juce::String("HueShift");
@@ -174,26 +348,50 @@ bool HueShiftProcessor::hasEditor() const
 
 juce::AudioProcessorEditor* HueShiftProcessor::createEditor()
 {
-    hadEditor = true;
     return new HueShiftEditor (*this);
     //return new juce::GenericAudioProcessorEditor(*this);
 }
 
 //==============================================================================
+// state layout: magic, version, the current PluginState, then the presets (see PluginState::Write and PresetBank::Write),
+// then the camera name (since version 3), then the ProcessingSettings (since version 4)
 void HueShiftProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    juce::ignoreUnused(destData);
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    juce::MemoryOutputStream stream(destData, false);
+    stream.writeInt(STATE_MAGIC);
+    stream.writeInt(STATE_VERSION);
+
+    GetCurrentState().Write(stream);
+    presets.Write(stream);
+    stream.writeString(cameraFeed.GetSelectedName());
+    GetProcessingSettings().Write(stream);
 }
 
 void HueShiftProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    juce::ignoreUnused(data, sizeInBytes);
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
-    
+    if (data == nullptr || sizeInBytes < 8) return;
+
+    juce::MemoryInputStream stream(data, static_cast<size_t>(sizeInBytes), false);
+    if (stream.readInt() != STATE_MAGIC) return;
+    const int version = stream.readInt();
+    if (version > STATE_VERSION) return; // made by a newer version, don't guess
+
+    HueShift::PluginState state{};
+    if (!HueShift::PluginState::Read(stream, state, version)) return;
+
+    SetGridSettings(state.grid);
+    SetRegions(state.regions); // none before version 5, back to the grid
+    presets.Apply(state);
+
+    if (stream.isExhausted() || !presets.Read(stream, version)) return;
+
+    // reopen the camera the project was saved with, so a show runs without anyone opening the editor
+    if (version < 3 || stream.isExhausted()) return;
+    const auto cameraName = stream.readString();
+    if (!cameraName.isEmpty()) cameraFeed.Open(cameraName); // in the background, loading doesn't wait for the device
+
+    HueShift::ProcessingSettings settings{};
+    if (version >= 4 && HueShift::ProcessingSettings::Read(stream, settings)) SetProcessingSettings(settings);
 }
 
 //==============================================================================
@@ -7,11 +7,21 @@
 */
 
 #pragma once
+#include <atomic>
 #include <mutex>
 #include <JuceHeader.h>
 #include "Commons/ParameterNaming.hpp"
 #include "DSP/MidiHandler.hpp"
-#include "Commons/HardwareListener.hpp"
+#include "Commons/NetworkReactor.hpp"
+#include "Commons/PluginState.hpp"
+#include "Commons/RealtimeAudit.hpp"
+#include "Commons/Telemetry.hpp"
+#include "Commons/CellBuffer.hpp"
+#include "Commons/SharedMemoryFeed.hpp"
+#include "Commons/OscLink.hpp"
+#include "DSP/RegionMask.hpp"
+#include "Commons/CameraFeed.hpp"
+#include "DSP/AnalysisEngine.hpp"
 
 //==============================================================================
 
@@ -60,18 +70,95 @@ public:
 
     //==============================================================================
     bool isVoiceEnabled(size_t row, size_t column, size_t amtColumns) const;
+    HueShift::VoiceStateSnapshot GetVoiceState() const; // lock free, safe from any thread
 
-    std::vector<juce::Colour> colourData; // should only be written to from the editor camera.
-    std::mutex colourDataGuard; // locks the colourData. ALWAYS USE IT
+    HueShift::GridSettings GetGridSettings() const;
+    void SetGridSettings(const HueShift::GridSettings& settings);
 
-    std::mutex midiUpdateGuard; // locks the midihandler from being accessed from other threads. ALWAYS USE IT
-    HueShift::MIDIListenerUDP hardwareListener;
-    HueShift::DiscoveryHandlerUDP discoveryHandler;
-    bool isEditorActive = false;
+    // presets hold the grid settings, the regions and the voice state. Don't call these from the audio thread.
+    void StorePreset(const juce::String& name);
+    bool RecallPreset(const juce::String& name);
+    juce::StringArray GetPresetNames() const;
+
+    // one voice per region, in order. An empty list goes back to the grid from the grid settings.
+    void SetRegions(std::vector<HueShift::RegionShape> shapes);
+    std::vector<HueShift::RegionShape> GetRegions() const;
+
+    // voices only pulse while something moves in their cell, see MidiHandler::SetMotionGate. 0 (the default) turns it off.
+    void SetMotionGate(float threshold);
+
+    // white balance and exposure normalisation before the colours are classified, off by default. See ColourNormaliser.
+    void SetColourCorrection(const HueShift::ColourCorrectionSettings& settings);
+
+    // smoothing of the cell colours over time and hysteresis at the band edges, against cells flipping between bands. See CellSmoother.
+    void SetCellSmoothing(const HueShift::CellSmoothingSettings& settings);
+
+    // per cell hue, saturation and brightness as controller streams next to the notes. Off by default. Not from the audio thread.
+    void SetCcStreams(const HueShift::CcStreamSettings& settings);
+
+    // how the pulse frequencies move between camera frames, a short slew by default. Not from the audio thread.
+    void SetFrequencyGlide(const HueShift::FrequencyGlideSettings& settings);
+
+    // how much MIDI the output may carry, what doesn't fit is spread, deferred or dropped. Unlimited bandwidth by default,
+    // MidiSchedulerSettings::ForDin for a hardware output. Not from the audio thread.
+    void SetMidiScheduler(const HueShift::MidiSchedulerSettings& settings);
+
+    // which of the incoming MIDI goes on down the chain, everything but the command notes by default. Not from the audio thread.
+    void SetMidiOutput(const HueShift::MidiOutputSettings& settings);
+
+    // where the per frame OSC bundles go, an empty host stops them. Off by default. False if the host is too long, nothing changes then.
+    // Not from the audio thread.
+    bool SetOscTarget(const juce::String& host, int port);
+
+    // what the Set* calls above last got, what the project saves. Not from the audio thread.
+    HueShift::ProcessingSettings GetProcessingSettings() const;
+
+    // hands a freshly analysed grid to the audio thread (and the shared memory feed and OSC). Never locks, the OSC send is one
+    // socket write. Only call it from the one thread running the analysis.
+    void PublishCells(const HueShift::CellBuffer& cells);
+    // the latest published cells for viewers, false if nothing was analysed yet. Lock free, any thread.
+    bool ReadLatestCells(HueShift::CellBuffer& output) const;
+
+    // the cells the analysis has to get right: the enabled voices that aren't frozen, every cell while the controller streams
+    // run or the grid is on screen. The rest only get a preview. Lock free, any thread.
+    HueShift::CellDemand GetCellDemand() const;
+    // the editor's grid tells when it is on screen, everything gets analysed in full while the user looks at it
+    void SetGridShowing(bool isShowing);
+
+    // this instance's id in the network protocols, unique within the process.
+    int GetInstanceId() const { return instanceId; }
+
+    juce::SharedResourcePointer<HueShift::NetworkReactor> network; // one for every instance in the process
+    HueShift::Telemetry telemetry;
+    HueShift::RegionCompiler regionCompiler; // user drawn regions replacing the uniform grid, compiled off-thread. Set them with SetRegions, they get saved.
+    HueShift::CameraFeed cameraFeed; // the camera and the analysis run without an editor, the editor only watches
+    HueShift::AnalysisEngine analysis;
 private:
-    juce::MidiBuffer midiOutputBuffer;
+    HueShift::SnapshotBuffer<HueShift::CellBuffer> publishedCells; // analysis -> audio thread
+    HueShift::CellBuffer blockCells{}; // the audio thread's copy of the latest cells
+    HueShift::SharedMemoryFeed sharedFeed; // only does something when built with HUESHIFT_SHM_FEED
+    HueShift::RealtimeAudit::Reporter realtimeAuditReporter; // only does something when built with HUESHIFT_RT_AUDIT
     HueShift::MidiHandler handler;
-    bool hadEditor = false;
+    HueShift::PresetBank presets;
+    HueShift::OscOutput oscOutput;
+
+    HueShift::CommandQueue networkCommands; // network -> audio thread
+    HueShift::CommandBatch drainedBatch{};
+    HueShift::ReadDataOutput blockCommands{}; // the audio thread's drained commands, reused every block
+    int instanceId = 0;
+
+    HueShift::GridSettings gridSettings{};
+    mutable std::mutex gridSettingsGuard; // never locked by the audio thread
+
+    HueShift::ProcessingSettings processing{}; // kept by the setters, the modules only take what they need
+    mutable std::mutex processingGuard; // never locked by the audio thread
+
+    std::atomic<bool> ccStreamsActive{false};
+    std::atomic<bool> gridShowing{false};
+
+    HueShift::PluginState GetCurrentState() const;
+    void SetProcessingSettings(const HueShift::ProcessingSettings& settings);
+    void DrainNetworkCommands(); // audio thread only
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HueShiftProcessor)
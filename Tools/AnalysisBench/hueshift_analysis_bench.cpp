@@ -0,0 +1,495 @@
+/*
+  ==============================================================================
+
+    Benchmark for the grid analysis with and without colour correction. Renders a grid of known colours,
+    lets the exposure, white balance and black level drift the way a camera on auto does under changing
+    stage light, and runs the analysis on it with every correction setup.
+
+    hueshift_analysis_bench [--frames 2000] [--width 1280] [--height 720] [--audit]
+
+    Prints per setup and statistic the median and 99th percentile cost of one frame, how often a cell ended up
+    in another colour band than the one that was painted (after the correction had a second to settle),
+    and how often a cell's band changed from one frame to the next.
+
+    Then what the dominant hue costs against the mean, on cells that are split between two colours (60:40): the cost per
+    frame, how much of a frame at ANALYSIS_HZ that is, and how often a cell came out in the band of its larger part.
+
+    Then the same frames as nv12 and yuyv, the way a webcam sends them: converted to ARGB first and analysed
+    (what a JUCE camera device does) against analysed straight from the planes, and how often both agree on the band.
+    The conversion here is plain scalar code, a camera backend's is usually faster, so the saving is an upper bound.
+
+    Last what the per cell motion costs: the same frames with motion on and off (see GridAnalyser::SetMotion),
+    without correction, as argb and nv12.
+
+    --audit only checks that a steady state frame doesn't allocate, lock or block: after warming up every frame's analysis,
+    smoothing and handoff (what AnalysisEngine does per frame) runs in a realtime section, in every mode. Prints what was
+    caught and exits with 1 if anything was. Needs a build with HUESHIFT_RT_AUDIT set to TRUE.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "Commons/RealtimeAudit.hpp"
+#include "Commons/SnapshotBuffer.hpp"
+#include "DSP/CellSmoother.hpp"
+#include "DSP/GridAnalyser.hpp"
+
+using namespace HueShift;
+
+namespace {
+
+constexpr int columns = 8, rows = 4;
+constexpr int settleFrames = 50;
+
+// the patch sits inside the cell at row 1, column 3, that cell doesn't count
+const juce::Rectangle<float> patch{0.39f, 0.28f, 0.09f, 0.2f};
+constexpr int patchCell = 1 * columns + 3;
+
+struct Drift {
+    float gain[3];
+    float black;
+};
+
+Drift GetDrift(int frame) {
+    const float exposure = 1.f + 0.4f * std::sin(frame * 0.0314f);
+    const float temperature = 0.25f * std::sin(frame * 0.019f);
+    return { { exposure * (1.f + temperature), exposure, exposure * (1.f - temperature) }, 10.f + 10.f * std::sin(frame * 0.0067f) };
+}
+
+juce::Colour GetPaintedColour(int cell) {
+    const auto& band = ColorInfo::GetColors()[static_cast<size_t>(cell) % ColorInfo::GetColors().size()];
+    return juce::Colour::fromHSV(band.GetCentreHue(), 0.55f + 0.1f * (cell % 4), 0.5f + 0.1f * (cell % 5), 1.f);
+}
+
+void Render(juce::Image& image, int frame, juce::uint32& noise) {
+    const auto drift = GetDrift(frame);
+    const juce::Image::BitmapData bitmap(image, juce::Image::BitmapData::writeOnly);
+    const auto layout = PixelLayout::FromBitmap(bitmap);
+    const int cellWidth = bitmap.width / columns, cellHeight = bitmap.height / rows;
+
+    for (int y = 0; y < bitmap.height; y++) {
+        for (int x = 0; x < bitmap.width; x++) {
+            const float u = static_cast<float>(x) / bitmap.width, v = static_cast<float>(y) / bitmap.height;
+            const bool inPatch = u >= patch.getX() && u < patch.getRight() && v >= patch.getY() && v < patch.getBottom();
+            const auto colour = inPatch ? juce::Colour::greyLevel(0.8f)
+                : GetPaintedColour(std::min(rows - 1, y / cellHeight) * columns + std::min(columns - 1, x / cellWidth));
+            const float rgb[3] = { colour.getFloatRed() * 255.f, colour.getFloatGreen() * 255.f, colour.getFloatBlue() * 255.f };
+
+            auto* pixel = bitmap.getPixelPointer(x, y);
+            const int channels[3] = { layout.red, layout.green, layout.blue };
+            for (int c = 0; c < 3; c++) {
+                noise = noise * 1664525u + 1013904223u;
+                const float grain = static_cast<float>(noise >> 24) / 32.f - 4.f; // +-4
+                pixel[channels[c]] = static_cast<juce::uint8>(juce::jlimit(0.f, 255.f, rgb[c] * drift.gain[c] + drift.black + grain));
+            }
+            if (layout.pixelStride == 4) pixel[3] = 255;
+        }
+    }
+}
+
+// every cell 60% its painted colour on the left and 40% another band's on the right, with the same grain
+void RenderSplit(juce::Image& image, juce::uint32& noise) {
+    const juce::Image::BitmapData bitmap(image, juce::Image::BitmapData::writeOnly);
+    const auto layout = PixelLayout::FromBitmap(bitmap);
+    const int cellWidth = bitmap.width / columns, cellHeight = bitmap.height / rows;
+
+    for (int y = 0; y < bitmap.height; y++) {
+        for (int x = 0; x < bitmap.width; x++) {
+            const int cell = std::min(rows - 1, y / cellHeight) * columns + std::min(columns - 1, x / cellWidth);
+            const auto colour = x % cellWidth < cellWidth * 6 / 10 ? GetPaintedColour(cell) : GetPaintedColour(cell + 3);
+            const float rgb[3] = { colour.getFloatRed() * 255.f, colour.getFloatGreen() * 255.f, colour.getFloatBlue() * 255.f };
+
+            auto* pixel = bitmap.getPixelPointer(x, y);
+            const int channels[3] = { layout.red, layout.green, layout.blue };
+            for (int c = 0; c < 3; c++) {
+                noise = noise * 1664525u + 1013904223u;
+                const float grain = static_cast<float>(noise >> 24) / 32.f - 4.f; // +-4
+                pixel[channels[c]] = static_cast<juce::uint8>(juce::jlimit(0.f, 255.f, rgb[c] + grain));
+            }
+            if (layout.pixelStride == 4) pixel[3] = 255;
+        }
+    }
+}
+
+struct Setup {
+    const char* name;
+    ColourCorrectionSettings settings;
+};
+
+// a frame the way the camera sends it, BT.601 limited range
+struct YuvPlanes {
+    YuvFormat format;
+    int width, height;
+    std::vector<uint8_t> luma, chroma; // yuyv only uses luma
+
+    YuvFrameView GetView() const {
+        YuvFrameView view{};
+        view.format = format;
+        view.width = width;
+        view.height = height;
+        view.planes[0] = luma.data();
+        view.strides[0] = format == YuvFormat::yuyv ? width * 2 : width;
+        if (format == YuvFormat::nv12) {
+            view.planes[1] = chroma.data();
+            view.strides[1] = (width + 1) / 2 * 2;
+        }
+        return view;
+    }
+};
+
+juce::uint8 ToByte(float value) {
+    return static_cast<juce::uint8>(juce::jlimit(0.f, 255.f, value + 0.5f));
+}
+
+YuvPlanes ToYuv(const juce::Image& image, YuvFormat format) {
+    const juce::Image::BitmapData bitmap(image, juce::Image::BitmapData::readOnly);
+    const auto layout = PixelLayout::FromBitmap(bitmap);
+    YuvPlanes planes{ format, bitmap.width, bitmap.height, {}, {} };
+    planes.luma.resize(static_cast<size_t>(format == YuvFormat::yuyv ? bitmap.width * 2 : bitmap.width) * bitmap.height);
+    if (format == YuvFormat::nv12) planes.chroma.resize(static_cast<size_t>((bitmap.width + 1) / 2 * 2) * ((bitmap.height + 1) / 2));
+
+    for (int y = 0; y < bitmap.height; y++) {
+        for (int x = 0; x < bitmap.width; x++) {
+            const auto* pixel = bitmap.getPixelPointer(x, y);
+            const float r = pixel[layout.red], g = pixel[layout.green], b = pixel[layout.blue];
+            const auto luma = ToByte(16.f + (0.299f * r + 0.587f * g + 0.114f * b) * 219.f / 255.f);
+            const auto cb = ToByte(128.f + (-0.168736f * r - 0.331264f * g + 0.5f * b) * 224.f / 255.f);
+            const auto cr = ToByte(128.f + (0.5f * r - 0.418688f * g - 0.081312f * b) * 224.f / 255.f);
+
+            // the chroma of the top left pixel of every pair (or square) stands for all of them
+            if (format == YuvFormat::yuyv) {
+                auto* line = planes.luma.data() + static_cast<size_t>(y) * bitmap.width * 2;
+                line[x * 2] = luma;
+                if (x % 2 == 0) { line[x * 2 + 1] = cb; line[x * 2 + 3] = cr; }
+            } else {
+                planes.luma[static_cast<size_t>(y) * bitmap.width + x] = luma;
+                if (x % 2 == 0 && y % 2 == 0) {
+                    auto* pair = planes.chroma.data() + static_cast<size_t>(y / 2) * ((bitmap.width + 1) / 2 * 2) + x;
+                    pair[0] = cb; pair[1] = cr;
+                }
+            }
+        }
+    }
+    return planes;
+}
+
+// what the camera backend does for every frame before the analysis gets to see it
+void ToArgb(const YuvFrameView& view, juce::Image& image) {
+    const juce::Image::BitmapData bitmap(image, juce::Image::BitmapData::writeOnly);
+    const auto layout = PixelLayout::FromBitmap(bitmap);
+    const YuvReader reader(view, ColourCorrection{});
+    float lumas[1], cbs[1], crs[1];
+
+    for (int y = 0; y < view.height; y++) {
+        auto* pixel = bitmap.getLinePointer(y);
+        for (int x = 0; x < view.width; x++, pixel += layout.pixelStride) {
+            reader.ReadRun(x, y, 1, lumas, cbs, crs);
+            pixel[layout.red] = ToByte(YccTransform::Apply(reader.raw.rgb[0], lumas[0], cbs[0], crs[0]));
+            pixel[layout.green] = ToByte(YccTransform::Apply(reader.raw.rgb[1], lumas[0], cbs[0], crs[0]));
+            pixel[layout.blue] = ToByte(YccTransform::Apply(reader.raw.rgb[2], lumas[0], cbs[0], crs[0]));
+            if (layout.pixelStride == 4) pixel[3] = 255;
+        }
+    }
+}
+
+int RunAudit(int width, int height, int amountOfFrames) {
+#if HUESHIFT_RT_AUDIT
+    std::printf("%dx%d, %dx%d grid, %d frames per mode, the first %d not audited\n\n", width, height, columns, rows, amountOfFrames, settleFrames);
+
+    ColourCorrectionSettings correction{};
+    correction.whiteBalance = WhiteBalanceMode::referencePatch;
+    correction.referencePatch = patch;
+    correction.normaliseExposure = correction.subtractBlack = true;
+
+    CellSmoothingSettings smoothing{};
+    smoothing.mode = CellSmoothingMode::median;
+    smoothing.medianLength = 5;
+
+    std::vector<RegionShape> shapes(2);
+    shapes[0].polygon = { {0.1f, 0.1f}, {0.5f, 0.1f}, {0.3f, 0.6f} };
+    shapes[1].polygon = { {0.5f, 0.5f}, {0.9f, 0.5f}, {0.9f, 0.9f}, {0.5f, 0.9f} };
+    const auto regions = CompiledRegions::Compile(shapes, width, height);
+
+    CellDemand demand{}; // every other cell a preview, like a grid with half the voices frozen
+    for (size_t cell = 0; cell < demand.full.size(); cell += 2) demand.full.set(cell);
+
+    juce::Image image(juce::Image::ARGB, width, height, false);
+    SnapshotBuffer<CellBuffer> handoff;
+    CellBuffer received{};
+
+    for (const bool yuv : { false, true }) {
+        for (const auto statistic : { CellStatistic::mean, CellStatistic::dominantHue }) {
+            for (const int layout : { 0, 1, 2 }) { // every cell in full, with previews, regions
+                GridAnalyser analyser;
+                analyser.SetColourCorrection(correction);
+                CellSmoother smoother;
+
+                GridSettings grid{};
+                grid.widthDivision = columns;
+                grid.heightDivision = rows;
+                grid.samplePoints = 64;
+                grid.statistic = statistic;
+
+                CellBuffer cells{};
+                juce::uint32 noise = 12345;
+                const auto violationsBefore = RealtimeAudit::GetViolationCount();
+
+                for (int frame = 0; frame < amountOfFrames; frame++) {
+                    Render(image, frame, noise);
+                    const auto planes = ToYuv(image, YuvFormat::nv12);
+                    const auto view = planes.GetView();
+                    const auto* frameRegions = layout == 2 ? &regions : nullptr;
+                    const auto* frameDemand = layout == 1 ? &demand : nullptr;
+
+                    if (frame >= settleFrames) RealtimeAudit::EnterRealtimeSection();
+                    if (yuv) analyser.Analyse(view, grid, cells, 1.f, frameRegions, frameDemand);
+                    else analyser.Analyse(image, grid, cells, 1.f, frameRegions, frameDemand);
+                    smoother.Process(cells, smoothing);
+                    handoff.Publish(cells);
+                    handoff.Read(received);
+                    if (frame >= settleFrames) RealtimeAudit::ExitRealtimeSection();
+                }
+
+                const char* layoutNames[] = { "full", "previews", "regions" };
+                std::printf("%-5s %-12s %-9s %llu violations\n", yuv ? "nv12" : "argb",
+                    statistic == CellStatistic::mean ? "mean" : "dominantHue", layoutNames[layout],
+                    static_cast<unsigned long long>(RealtimeAudit::GetViolationCount() - violationsBefore));
+            }
+        }
+    }
+
+    RealtimeAudit::Violation violation{};
+    while (RealtimeAudit::PopViolation(violation)) std::fprintf(stderr, "%s", RealtimeAudit::Describe(violation).c_str());
+    if (RealtimeAudit::GetDroppedCount() > 0) std::fprintf(stderr, "%llu more didn't fit in the queue\n", static_cast<unsigned long long>(RealtimeAudit::GetDroppedCount()));
+
+    const auto violations = RealtimeAudit::GetViolationCount();
+    std::printf("\n%s\n", violations == 0 ? "no allocations, locks or blocking calls" : "FAILED, see above");
+    return violations == 0 ? 0 : 1;
+#else
+    juce::ignoreUnused(width, height, amountOfFrames);
+    std::printf("--audit needs a build with HUESHIFT_RT_AUDIT set to TRUE in the root CMakeLists.txt\n");
+    return 2;
+#endif
+}
+
+double GetPercentile(std::vector<double> values, double fraction) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()))];
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    int amountOfFrames = 2000, width = 1280, height = 720;
+    bool audit = false;
+    for (int i = 1; i < argc; i++) {
+        const juce::String option(argv[i]);
+        if (option == "--audit") {
+            audit = true;
+            continue;
+        }
+        if (i + 1 >= argc) break;
+
+        if (option == "--frames") amountOfFrames = std::max(settleFrames + 1, atoi(argv[i + 1]));
+        else if (option == "--width") width = std::max(columns * 8, atoi(argv[i + 1]));
+        else if (option == "--height") height = std::max(rows * 8, atoi(argv[i + 1]));
+        i++;
+    }
+
+    if (audit) return RunAudit(width, height, amountOfFrames);
+
+    std::vector<Setup> setups;
+    setups.push_back({ "off", {} });
+    {
+        Setup setup{ "grey world", {} };
+        setup.settings.whiteBalance = WhiteBalanceMode::greyWorld;
+        setups.push_back(setup);
+        setup.name = "grey world + exposure + black";
+        setup.settings.normaliseExposure = setup.settings.subtractBlack = true;
+        setups.push_back(setup);
+    }
+    {
+        Setup setup{ "patch", {} };
+        setup.settings.whiteBalance = WhiteBalanceMode::referencePatch;
+        setup.settings.referencePatch = patch;
+        setups.push_back(setup);
+        setup.name = "patch + exposure + black";
+        setup.settings.normaliseExposure = setup.settings.subtractBlack = true;
+        setups.push_back(setup);
+    }
+
+    std::printf("%dx%d, %dx%d grid, %d frames\n\n", width, height, columns, rows, amountOfFrames);
+    std::printf("%-32s %-12s %9s %9s %11s %11s\n", "correction", "statistic", "p50 ms", "p99 ms", "wrong band", "band flips");
+
+    juce::Image image(juce::Image::ARGB, width, height, false);
+
+    for (const auto statistic : { CellStatistic::mean, CellStatistic::dominantHue }) {
+        for (const auto& setup : setups) {
+            GridAnalyser analyser;
+            analyser.SetColourCorrection(setup.settings);
+
+            GridSettings grid{};
+            grid.widthDivision = columns;
+            grid.heightDivision = rows;
+            grid.samplePoints = 64;
+            grid.statistic = statistic;
+
+            CellBuffer cells{};
+            std::vector<double> milliseconds;
+            std::vector<int> lastBands(columns * rows, -1);
+            long wrong = 0, flips = 0, counted = 0;
+            juce::uint32 noise = 12345; // the same frames for every setup
+
+            for (int frame = 0; frame < amountOfFrames; frame++) {
+                Render(image, frame, noise);
+                analyser.Analyse(image, grid, cells);
+                if (frame < settleFrames) continue;
+
+                milliseconds.push_back(analyser.GetLastAnalysisSeconds() * 1000.0);
+                for (int cell = 0; cell < static_cast<int>(cells.size()); cell++) {
+                    if (cell == patchCell) continue;
+
+                    const int band = static_cast<int>(ColorInfo::GetBandIndex(cells[static_cast<size_t>(cell)].GetColour().getHue()));
+                    const int painted = static_cast<int>(ColorInfo::GetBandIndex(GetPaintedColour(cell).getHue()));
+                    wrong += band != painted ? 1 : 0;
+                    flips += lastBands[static_cast<size_t>(cell)] >= 0 && lastBands[static_cast<size_t>(cell)] != band ? 1 : 0;
+                    lastBands[static_cast<size_t>(cell)] = band;
+                    counted++;
+                }
+            }
+
+            std::printf("%-32s %-12s %9.3f %9.3f %10.2f%% %10.2f%%\n", setup.name,
+                statistic == CellStatistic::mean ? "mean" : "dominantHue",
+                GetPercentile(milliseconds, 0.5), GetPercentile(milliseconds, 0.99),
+                100.0 * wrong / std::max(1l, counted), 100.0 * flips / std::max(1l, counted));
+        }
+    }
+
+    std::printf("\n%-12s %9s %9s %16s %12s\n", "split cells", "p50 ms", "p99 ms", "p99 of a frame", "right band");
+
+    for (const auto statistic : { CellStatistic::mean, CellStatistic::dominantHue }) {
+        GridAnalyser analyser;
+
+        GridSettings grid{};
+        grid.widthDivision = columns;
+        grid.heightDivision = rows;
+        grid.samplePoints = 64;
+        grid.statistic = statistic;
+
+        CellBuffer cells{};
+        std::vector<double> milliseconds;
+        long right = 0, counted = 0;
+        juce::uint32 noise = 12345;
+
+        for (int frame = 0; frame < amountOfFrames; frame++) {
+            RenderSplit(image, noise);
+            analyser.Analyse(image, grid, cells);
+            if (frame < settleFrames) continue;
+
+            milliseconds.push_back(analyser.GetLastAnalysisSeconds() * 1000.0);
+            for (int cell = 0; cell < static_cast<int>(cells.size()); cell++) {
+                const auto band = ColorInfo::GetBandIndex(cells[static_cast<size_t>(cell)].GetColour().getHue());
+                right += band == ColorInfo::GetBandIndex(GetPaintedColour(cell).getHue()) ? 1 : 0;
+                counted++;
+            }
+        }
+
+        const double p99 = GetPercentile(milliseconds, 0.99);
+        std::printf("%-12s %9.3f %9.3f %15.1f%% %11.2f%%\n", statistic == CellStatistic::mean ? "mean" : "dominantHue",
+            GetPercentile(milliseconds, 0.5), p99, 100.0 * p99 / (1000.0 / ANALYSIS_HZ), 100.0 * right / std::max(1l, counted));
+    }
+
+    std::printf("\n%-8s %-12s %13s %13s %13s %13s %8s %9s\n", "format", "statistic",
+        "argb p50 ms", "argb p99 ms", "yuv p50 ms", "yuv p99 ms", "saved", "same band");
+
+    juce::Image converted(juce::Image::ARGB, width, height, false);
+    for (const auto format : { YuvFormat::nv12, YuvFormat::yuyv }) {
+        for (const auto statistic : { CellStatistic::mean, CellStatistic::dominantHue }) {
+            GridAnalyser rgbAnalyser, yuvAnalyser;
+
+            GridSettings grid{};
+            grid.widthDivision = columns;
+            grid.heightDivision = rows;
+            grid.samplePoints = 64;
+            grid.statistic = statistic;
+
+            CellBuffer rgbCells{}, yuvCells{};
+            std::vector<double> rgbMilliseconds, yuvMilliseconds;
+            long same = 0, counted = 0;
+            juce::uint32 noise = 12345;
+
+            for (int frame = 0; frame < amountOfFrames; frame++) {
+                Render(image, frame, noise);
+                const auto planes = ToYuv(image, format);
+                const auto view = planes.GetView();
+
+                const auto startTicks = juce::Time::getHighResolutionTicks();
+                ToArgb(view, converted);
+                rgbAnalyser.Analyse(converted, grid, rgbCells);
+                const auto rgbSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+
+                yuvAnalyser.Analyse(view, grid, yuvCells);
+                if (frame < settleFrames) continue;
+
+                rgbMilliseconds.push_back(rgbSeconds * 1000.0);
+                yuvMilliseconds.push_back(yuvAnalyser.GetLastAnalysisSeconds() * 1000.0);
+                for (size_t cell = 0; cell < yuvCells.size(); cell++) {
+                    same += ColorInfo::GetBandIndex(rgbCells[cell].GetColour().getHue()) == ColorInfo::GetBandIndex(yuvCells[cell].GetColour().getHue()) ? 1 : 0;
+                    counted++;
+                }
+            }
+
+            const double rgbMedian = GetPercentile(rgbMilliseconds, 0.5), yuvMedian = GetPercentile(yuvMilliseconds, 0.5);
+            std::printf("%-8s %-12s %13.3f %13.3f %13.3f %13.3f %7.1f%% %8.2f%%\n",
+                format == YuvFormat::nv12 ? "nv12" : "yuyv", statistic == CellStatistic::mean ? "mean" : "dominantHue",
+                rgbMedian, GetPercentile(rgbMilliseconds, 0.99), yuvMedian, GetPercentile(yuvMilliseconds, 0.99),
+                100.0 * (1.0 - yuvMedian / std::max(1e-9, rgbMedian)), 100.0 * same / std::max(1l, counted));
+        }
+    }
+
+    std::printf("\n%-8s %-12s %12s %12s %12s %12s %9s\n", "format", "statistic",
+        "on p50 ms", "on p99 ms", "off p50 ms", "off p99 ms", "motion");
+
+    for (const bool yuv : { false, true }) {
+        for (const auto statistic : { CellStatistic::mean, CellStatistic::dominantHue }) {
+            GridAnalyser withMotion, withoutMotion;
+            withoutMotion.SetMotion(false);
+
+            GridSettings grid{};
+            grid.widthDivision = columns;
+            grid.heightDivision = rows;
+            grid.samplePoints = 64;
+            grid.statistic = statistic;
+
+            CellBuffer cells{};
+            std::vector<double> onMilliseconds, offMilliseconds;
+            juce::uint32 noise = 12345;
+
+            for (int frame = 0; frame < amountOfFrames; frame++) {
+                Render(image, frame, noise);
+                const auto planes = ToYuv(image, YuvFormat::nv12);
+
+                // alternating which one goes first, so neither always finds the frame in the cache
+                for (int pass = 0; pass < 2; pass++) {
+                    auto& analyser = (frame + pass) % 2 == 0 ? withMotion : withoutMotion;
+                    if (yuv) analyser.Analyse(planes.GetView(), grid, cells);
+                    else analyser.Analyse(image, grid, cells);
+                    if (frame >= settleFrames) (&analyser == &withMotion ? onMilliseconds : offMilliseconds).push_back(analyser.GetLastAnalysisSeconds() * 1000.0);
+                }
+            }
+
+            const double onMedian = GetPercentile(onMilliseconds, 0.5), offMedian = GetPercentile(offMilliseconds, 0.5);
+            std::printf("%-8s %-12s %12.3f %12.3f %12.3f %12.3f %8.1f%%\n",
+                yuv ? "nv12" : "argb", statistic == CellStatistic::mean ? "mean" : "dominantHue",
+                onMedian, GetPercentile(onMilliseconds, 0.99), offMedian, GetPercentile(offMilliseconds, 0.99),
+                100.0 * (onMedian / std::max(1e-9, offMedian) - 1.0));
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,249 @@
+/*
+  ==============================================================================
+
+    Real-time safety sweep. Always built with the realtime audit (see RealtimeAudit.hpp), builds a real HueShiftProcessor
+    and runs processBlock through every combination of grid size, block size and command mix, with synthetic camera
+    frames going through the analysis the whole time.
+
+    hueshift_audit_sweep [--seconds 1] [--sample-rate 48000]
+
+    grids:  1x1, 5x2, 8x4, 16x8 (MAX_VOICES)
+    blocks: 16, 64, 256, 512, 1024, 4096 samples
+    mixes:  quiet        nothing but the pulses
+            midi         command notes (freeze, octave) next to controllers, pitch bend, aftertouch and note offs that pass through
+            network      custom protocol toggles, sets, camera rate and resyncs, and OSC, from another thread
+            streams      the controller streams (7 bit, 14 bit and NRPN in turn), DIN bandwidth and the motion gate
+            everything   all of the above with everything passing through, preset recalls and grid changes while it plays
+
+    Every scenario warms up until the analysis delivers cells of its grid, then runs --seconds of audio inside the audit.
+    The audit's reporter prints every violation with its call site. Exits with 1 if there was any.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include "PluginProcessor.h"
+
+#if ! HUESHIFT_RT_AUDIT
+ #error "the sweep only makes sense with the realtime audit, see Tools/AuditSweep/CMakeLists.txt"
+#endif
+
+namespace {
+
+enum class Mix { quiet, midi, network, streams, everything };
+
+const char* GetName(Mix mix) {
+    switch (mix) {
+        case Mix::quiet: return "quiet";
+        case Mix::midi: return "midi";
+        case Mix::network: return "network";
+        case Mix::streams: return "streams";
+        default: return "everything";
+    }
+}
+
+double GetWallSeconds() {
+    return juce::Time::getMillisecondCounterHiRes() * 0.001;
+}
+
+// a grid of slowly turning colours with a moving bar, so the cells change band and have motion now and then
+void RenderFrame(juce::Image& image, double seconds, int columns, int rows) {
+    const juce::Image::BitmapData bitmap(image, juce::Image::BitmapData::writeOnly);
+    const int bar = static_cast<int>(seconds * 40.0) % std::max(1, bitmap.width);
+    for (int y = 0; y < bitmap.height; y++) {
+        for (int x = 0; x < bitmap.width; x++) {
+            const int cell = (y * rows / bitmap.height) * columns + x * columns / bitmap.width;
+            const float hue = static_cast<float>(std::fmod(cell * 0.13 + seconds * 0.05, 1.0));
+            bitmap.setPixelColour(x, y, std::abs(x - bar) < 4 ? juce::Colours::white : juce::Colour::fromHSV(hue, 0.8f, 0.8f, 1.f));
+        }
+    }
+}
+
+// every voice on, voice 0 frozen
+void SetState(HueShiftProcessor& processor, unsigned int columns, unsigned int rows) {
+    HueShift::PluginState state{};
+    state.grid.widthDivision = columns;
+    state.grid.heightDivision = rows;
+    state.voices.numVoices = state.grid.GetAmountOfCells();
+    for (size_t i = 0; i < state.voices.numVoices; i++) state.voices.enabled[i] = true;
+    state.voices.frozen[0] = true;
+
+    juce::MemoryOutputStream stream;
+    stream.writeInt(STATE_MAGIC);
+    stream.writeInt(STATE_VERSION);
+    state.Write(stream);
+    processor.setStateInformation(stream.getData(), static_cast<int>(stream.getDataSize()));
+}
+
+// the processing settings a mix runs with, the defaults for the others
+void SetMix(HueShiftProcessor& processor, Mix mix, int scenario) {
+    HueShift::CcStreamSettings streams{};
+    HueShift::MidiSchedulerSettings scheduler{};
+    HueShift::MidiOutputSettings output{};
+    float motionGate = 0.f;
+
+    if (mix == Mix::streams || mix == Mix::everything) {
+        const HueShift::CcStreamMode modes[] = { HueShift::CcStreamMode::cc7, HueShift::CcStreamMode::cc14, HueShift::CcStreamMode::nrpn };
+        streams.mode = modes[scenario % 3];
+        scheduler = HueShift::MidiSchedulerSettings::ForDin();
+        motionGate = 0.02f;
+    }
+    if (mix == Mix::everything) output.passthrough = HueShift::MidiPassthrough::all;
+
+    processor.SetCcStreams(streams);
+    processor.SetMidiScheduler(scheduler);
+    processor.SetMidiOutput(output);
+    processor.SetMotionGate(motionGate);
+}
+
+// what the hardware controllers and an OSC controller would send, over loopback
+class Controller {
+private:
+    juce::DatagramSocket socket{false};
+    HueShift::OscWriter<OSC_MAX_PACKET_BYTES> osc;
+    juce::Random random{7};
+    uint32_t sequence = 0;
+
+public:
+    void Send(HueShiftProcessor& processor, int amountOfVoices) {
+        const auto id = juce::String(processor.GetInstanceId());
+        const auto voice = [&]() { return juce::String(random.nextInt(amountOfVoices)); };
+
+        const auto text = "q-" + juce::String(++sequence) + ";f#" + id + "-" + voice() + ";o#" + id + "-" + voice() + ";s#" + id + "-" + voice()
+            + ";F#" + id + "-" + voice() + "=" + juce::String(random.nextInt(2)) + ";O#" + id + "-" + voice() + "=" + juce::String(random.nextInt(4))
+            + ";S#" + id + "-" + voice() + "=1;" + (sequence % 8 == 0 ? "c#" + id + "-" + juce::String(20 + random.nextInt(40)) + ";" : juce::String())
+            + (sequence % 16 == 0 ? "r#" + id + "-0;" : juce::String());
+        socket.write("127.0.0.1", processor.network->GetHardwarePort(), text.toRawUTF8(), static_cast<int>(text.getNumBytesAsUTF8()));
+
+        const int oscPort = processor.network->GetOscPort();
+        if (oscPort <= 0) return; // taken by another HueShift, the custom protocol covers the same path
+        const auto address = "/hueshift/" + id.toStdString() + "/freeze";
+        osc.BeginMessage(address.c_str(), "i");
+        osc.AddInt(random.nextInt(amountOfVoices));
+        osc.EndMessage();
+        socket.write("127.0.0.1", oscPort, osc.GetData(), static_cast<int>(osc.GetSize()));
+    }
+};
+
+// command notes and whatever else a host sends
+void AddMidi(juce::MidiBuffer& midi, juce::Random& random, int amountOfVoices, int blockSize) {
+    const int voice = 1 + random.nextInt(std::max(1, amountOfVoices - 1));
+    const auto velocity = static_cast<juce::uint8>(random.nextInt(4) == 0 ? 0 : 100); // 0 toggles the octave
+    midi.addEvent(juce::MidiMessage::noteOn(1, C1 + voice, velocity), random.nextInt(blockSize));
+    midi.addEvent(juce::MidiMessage::noteOff(1, C1 + voice), random.nextInt(blockSize));
+    midi.addEvent(juce::MidiMessage::aftertouchChange(1, C1 + voice, 64), random.nextInt(blockSize));
+    midi.addEvent(juce::MidiMessage::controllerEvent(1, 1, random.nextInt(128)), random.nextInt(blockSize));
+    midi.addEvent(juce::MidiMessage::pitchWheel(1, random.nextInt(16384)), random.nextInt(blockSize));
+    midi.addEvent(juce::MidiMessage::channelPressureChange(1, 32), random.nextInt(blockSize));
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    double seconds = 1.0, sampleRate = 48000.0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const juce::String option(argv[i]);
+        const double value = juce::String(argv[i + 1]).getDoubleValue();
+        if (option == "--seconds") seconds = value;
+        else if (option == "--sample-rate") sampleRate = value;
+    }
+    if (seconds <= 0.0 || sampleRate < 8000.0) {
+        std::fprintf(stderr, "usage: %s [--seconds s] [--sample-rate hz]\n", argv[0]);
+        return 1;
+    }
+
+    const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    auto processor = std::make_unique<HueShiftProcessor>();
+
+    const unsigned int grids[][2] = { {1, 1}, {5, 2}, {8, 4}, {16, 8} };
+    const int blockSizes[] = { 16, 64, 256, 512, 1024, 4096 };
+    const Mix mixes[] = { Mix::quiet, Mix::midi, Mix::network, Mix::streams, Mix::everything };
+
+    juce::Image frame(juce::Image::ARGB, 128, 72, true);
+    juce::MidiBuffer midi;
+    juce::Random random(42);
+    Controller controller;
+    HueShift::CellBuffer cells{};
+    uint64_t failedScenarios = 0;
+    int scenario = 0;
+
+    std::printf("%-6s %6s %-11s %7s %11s\n", "grid", "block", "mix", "blocks", "violations");
+
+    for (const auto& grid : grids) {
+        for (const int blockSize : blockSizes) {
+            for (const auto mix : mixes) {
+                const int amountOfVoices = static_cast<int>(grid[0] * grid[1]);
+                SetState(*processor, grid[0], grid[1]);
+                SetMix(*processor, mix, scenario++);
+                processor->prepareToPlay(sampleRate, blockSize);
+
+                juce::AudioBuffer<float> audio(2, blockSize);
+                const auto blocksPerSecond = sampleRate / blockSize;
+                const auto measuredBlocks = static_cast<int>(seconds * blocksPerSecond);
+                const auto controlEvery = std::max(1, static_cast<int>(blocksPerSecond / 50.0)); // about 50 times a second
+                const auto changeEvery = std::max(1, static_cast<int>(blocksPerSecond / 4.0));
+                double lastFrameSeconds = 0.0, simulatedSeconds = 0.0;
+
+                // warm up: at least half a second, and until the analysis caught up with the grid
+                uint64_t violationsBefore = 0;
+                const double warmUpDeadline = GetWallSeconds() + 5.0;
+                int block = 0;
+                for (bool measuring = false; !measuring || block < measuredBlocks; block++) {
+                    if (!measuring && block >= static_cast<int>(0.5 * blocksPerSecond)
+                        && ((processor->ReadLatestCells(cells) && cells.size() == static_cast<size_t>(amountOfVoices)) || GetWallSeconds() > warmUpDeadline))
+                    {
+                        measuring = true;
+                        block = 0;
+                        violationsBefore = HueShift::RealtimeAudit::GetViolationCount();
+                    }
+
+                    // the analysis runs on wall clock time, more frames than it takes would only cost time
+                    const double wallSeconds = GetWallSeconds();
+                    if (wallSeconds - lastFrameSeconds > 0.005) {
+                        RenderFrame(frame, simulatedSeconds, static_cast<int>(grid[0]), static_cast<int>(grid[1]));
+                        processor->cameraFeed.SubmitFrame(frame);
+                        lastFrameSeconds = wallSeconds;
+                    }
+
+                    midi.clear();
+                    const bool control = block % controlEvery == 0;
+                    if (control && (mix == Mix::midi || mix == Mix::everything)) AddMidi(midi, random, amountOfVoices, blockSize);
+                    if (control && (mix == Mix::network || mix == Mix::everything)) controller.Send(*processor, amountOfVoices);
+
+                    // the message thread changing things under the audio thread's feet
+                    if (measuring && mix == Mix::everything && block % changeEvery == changeEvery - 1) {
+                        processor->StorePreset("sweep");
+                        processor->RecallPreset("sweep");
+                        auto settings = processor->GetGridSettings();
+                        settings.statistic = settings.statistic == HueShift::CellStatistic::mean ? HueShift::CellStatistic::dominantHue : HueShift::CellStatistic::mean;
+                        settings.widthDivision = settings.widthDivision == grid[0] ? std::max(1u, grid[0] / 2) : grid[0];
+                        processor->SetGridSettings(settings);
+                    }
+
+                    processor->processBlock(audio, midi);
+                    simulatedSeconds += blockSize / sampleRate;
+                }
+
+                const auto violations = HueShift::RealtimeAudit::GetViolationCount() - violationsBefore;
+                failedScenarios += violations > 0 ? 1 : 0;
+                std::printf("%2ux%-3u %6d %-11s %7d %11llu%s\n", grid[0], grid[1], blockSize, GetName(mix), measuredBlocks,
+                    static_cast<unsigned long long>(violations), violations > 0 ? "  FAIL" : "");
+                std::fflush(stdout);
+            }
+        }
+    }
+
+    processor->releaseResources();
+    juce::Thread::sleep(500); // the reporter prints the call sites every 250 ms
+    processor.reset();
+
+    const auto total = HueShift::RealtimeAudit::GetViolationCount();
+    std::printf("\n%llu violations in %llu scenarios\n", static_cast<unsigned long long>(total), static_cast<unsigned long long>(failedScenarios));
+    std::printf(total > 0 ? "audit sweep failed\n" : "audit sweep passed\n");
+    return total > 0 ? 1 : 0;
+}
@@ -0,0 +1,212 @@
+/*
+  ==============================================================================
+
+    Follows the shared memory feed of a running HueShift (built with HUESHIFT_SHM_FEED).
+
+    hueshift_feed_reader [name]                 prints the live state, name defaults to /hueshift-1
+    hueshift_feed_reader [name] --check seconds reads as fast as it can for that long and checks
+                                                that everything it read is consistent. Exits with 1 if not.
+
+  ==============================================================================
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "HueShiftFeed.h"
+
+static double Now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/* latest frame, 0 if there is none yet */
+static int ReadFrame(const hueshift_feed* feed, hueshift_feed_frame* output) {
+    for (;;) {
+        const uint64_t count = __atomic_load_n(&feed->frameWriteCount, __ATOMIC_ACQUIRE);
+        if (count == 0) return 0;
+
+        const hueshift_feed_frame* slot = &feed->frames[(count - 1) % HUESHIFT_FEED_SLOTS];
+        const uint32_t before = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        if (before & 1u) continue;
+
+        memcpy(output, slot, sizeof(*output));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) == before) return 1;
+    }
+}
+
+static int ReadVoices(const hueshift_feed* feed, hueshift_feed_voices* output) {
+    for (;;) {
+        const uint64_t count = __atomic_load_n(&feed->voiceWriteCount, __ATOMIC_ACQUIRE);
+        if (count == 0) return 0;
+
+        const hueshift_feed_voices* slot = &feed->voices[(count - 1) % HUESHIFT_FEED_SLOTS];
+        const uint32_t before = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        if (before & 1u) continue;
+
+        memcpy(output, slot, sizeof(*output));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) == before) return 1;
+    }
+}
+
+/* 1 = got pulse *cursor, 0 = nothing new, -1 = lapped, *cursor jumped to the oldest pulse still there */
+static int ReadPulse(const hueshift_feed* feed, uint64_t* cursor, hueshift_feed_pulse* output) {
+    const uint64_t count = __atomic_load_n(&feed->pulseWriteCount, __ATOMIC_ACQUIRE);
+    if (*cursor >= count) return 0;
+
+    if (count - *cursor >= HUESHIFT_FEED_PULSE_CAPACITY) {
+        *cursor = count - HUESHIFT_FEED_PULSE_CAPACITY + 1;
+        return -1;
+    }
+
+    memcpy(output, &feed->pulses[*cursor % HUESHIFT_FEED_PULSE_CAPACITY], sizeof(*output));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    if (__atomic_load_n(&feed->pulseWriteCount, __ATOMIC_RELAXED) - *cursor >= HUESHIFT_FEED_PULSE_CAPACITY) {
+        *cursor = count - HUESHIFT_FEED_PULSE_CAPACITY + 1;
+        return -1;
+    }
+
+    (*cursor)++;
+    return 1;
+}
+
+static int IsBitSet(const uint8_t* bits, uint32_t index) {
+    return (bits[index / 8] >> (index % 8)) & 1u;
+}
+
+static void Print(const hueshift_feed_frame* frame, const hueshift_feed_voices* voices) {
+    printf("frame %llu (%ux%u)  block %llu  sample %llu\n",
+        (unsigned long long)frame->frameIndex, frame->width, frame->height,
+        (unsigned long long)voices->blockIndex, (unsigned long long)voices->sampleTime);
+
+    for (uint32_t row = 0; row < frame->height; row++) {
+        for (uint32_t column = 0; column < frame->width; column++) {
+            const uint32_t index = row * frame->width + column;
+            const hueshift_feed_cell* cell = &frame->cells[index];
+            const char state = index >= voices->numVoices ? ' ' : !IsBitSet(voices->enabled, index) ? '.' : IsBitSet(voices->frozen, index) ? '*' : '+';
+
+            printf(" %c#%06x %4.0fHz", state, cell->argb & 0xffffffu, index < voices->numVoices ? voices->frequencies[index] : 0.f);
+        }
+        printf("\n");
+    }
+}
+
+static int Check(const hueshift_feed* feed, double seconds) {
+    hueshift_feed_frame frame;
+    hueshift_feed_voices voices;
+    hueshift_feed_pulse pulse;
+
+    uint64_t lastFrame = 0, lastBlock = 0, lastVoiceSample = 0, lastPulseSample = 0;
+    uint64_t frames = 0, blocks = 0, pulses = 0, lapped = 0, errors = 0;
+    uint64_t cursor = __atomic_load_n(&feed->pulseWriteCount, __ATOMIC_ACQUIRE);
+
+    const double end = Now() + seconds;
+    while (Now() < end) {
+        if (ReadFrame(feed, &frame)) {
+            if (frame.frameIndex < lastFrame) { fprintf(stderr, "frame went back: %llu after %llu\n", (unsigned long long)frame.frameIndex, (unsigned long long)lastFrame); errors++; }
+            if ((uint64_t)frame.width * frame.height > HUESHIFT_FEED_MAX_CELLS) { fprintf(stderr, "frame %ux%u too big\n", frame.width, frame.height); errors++; }
+            if (frame.frameIndex != lastFrame) frames++;
+            lastFrame = frame.frameIndex;
+        }
+
+        if (ReadVoices(feed, &voices)) {
+            if (voices.blockIndex < lastBlock || voices.sampleTime < lastVoiceSample) {
+                /* a restart of the audio (prepareToPlay) resets both, only complain if one went back without the other */
+                if ((voices.blockIndex < lastBlock) != (voices.sampleTime < lastVoiceSample)) { fprintf(stderr, "block and sample clock disagree\n"); errors++; }
+            }
+            if (voices.numVoices > HUESHIFT_FEED_MAX_CELLS) { fprintf(stderr, "%u voices\n", voices.numVoices); errors++; }
+            if (voices.blockIndex != lastBlock) blocks++;
+            lastBlock = voices.blockIndex;
+            lastVoiceSample = voices.sampleTime;
+        }
+
+        for (int result; (result = ReadPulse(feed, &cursor, &pulse)) != 0;) {
+            if (result < 0) { lapped++; continue; }
+            if (pulse.voice >= HUESHIFT_FEED_MAX_CELLS) { fprintf(stderr, "pulse for voice %u\n", pulse.voice); errors++; }
+            if (pulse.sampleTime + 1000000 < lastPulseSample) { fprintf(stderr, "pulse went back in time\n"); errors++; }
+            lastPulseSample = pulse.sampleTime;
+            pulses++;
+        }
+    }
+
+    printf("%llu frames, %llu blocks, %llu pulses, lapped %llu times, %llu errors\n",
+        (unsigned long long)frames, (unsigned long long)blocks, (unsigned long long)pulses,
+        (unsigned long long)lapped, (unsigned long long)errors);
+
+    if (frames == 0 && blocks == 0) {
+        fprintf(stderr, "nothing was published, is the plugin running?\n");
+        return 1;
+    }
+    return errors == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    const char* name = HUESHIFT_FEED_NAME_PREFIX "1";
+    double checkSeconds = -1.0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--check") == 0 && i + 1 < argc) checkSeconds = atof(argv[++i]);
+        else name = argv[i];
+    }
+
+    const int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        fprintf(stderr, "can't open %s: %s\n", name, strerror(errno));
+        return 1;
+    }
+
+    void* memory = mmap(NULL, sizeof(hueshift_feed), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        fprintf(stderr, "can't map %s: %s\n", name, strerror(errno));
+        return 1;
+    }
+
+    const hueshift_feed* feed = (const hueshift_feed*)memory;
+    if (__atomic_load_n(&feed->magic, __ATOMIC_ACQUIRE) != HUESHIFT_FEED_MAGIC || feed->version != HUESHIFT_FEED_VERSION || feed->size != sizeof(hueshift_feed)) {
+        fprintf(stderr, "%s isn't a HueShift feed of this version\n", name);
+        return 1;
+    }
+    if (kill((pid_t)feed->writerPid, 0) != 0 && errno == ESRCH) fprintf(stderr, "warning: the writer (pid %u) is gone\n", feed->writerPid);
+
+    if (checkSeconds >= 0.0) return Check(feed, checkSeconds);
+
+    hueshift_feed_frame frame;
+    hueshift_feed_voices voices;
+    hueshift_feed_pulse pulse;
+    uint64_t cursor = __atomic_load_n(&feed->pulseWriteCount, __ATOMIC_ACQUIRE);
+
+    for (;;) {
+        memset(&frame, 0, sizeof(frame));
+        memset(&voices, 0, sizeof(voices));
+        ReadFrame(feed, &frame);
+        ReadVoices(feed, &voices);
+
+        printf("\033[H\033[2J");
+        Print(&frame, &voices);
+
+        int notes = 0;
+        for (int result; (result = ReadPulse(feed, &cursor, &pulse)) != 0;) {
+            if (result > 0 && pulse.isNoteOn) notes++;
+        }
+        printf("%d notes since last print\n", notes);
+        fflush(stdout);
+
+        const struct timespec interval = {0, 100000000L};
+        nanosleep(&interval, NULL);
+    }
+}
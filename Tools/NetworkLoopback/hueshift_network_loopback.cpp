@@ -0,0 +1,261 @@
+/*
+  ==============================================================================
+
+    Loopback test for the network input. Starts a NetworkReactor in this process, registers one instance with it
+    and sends commands to it over 127.0.0.1, the custom protocol to its hardware port and OSC to OSC_RECEIVE_PORT.
+    What comes out of the instance's CommandQueue has to be every command that was sent, once and in the order it was sent.
+
+    hueshift_network_loopback [--commands 200]
+
+    Cases: one command per packet (with and without the instance id), many per packet, sequence numbers with every packet
+    sent twice and a stale one at the end, OSC messages (toggles and sets), and OSC bundles.
+    Every command goes to its own voice, so nothing gets coalesced. The OSC cases need OSC_RECEIVE_PORT to be free,
+    so close any running HueShift first. Exits with 1 if a case got something else than it sent.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "Commons/NetworkReactor.hpp"
+
+using HueShift::VoiceCommand;
+
+namespace {
+
+constexpr double timeoutSeconds = 2.0;
+// packets sent before waiting for them to arrive. Loopback sends faster than anything reads, a socket's receive buffer
+// only holds a few hundred small packets and the queue NETWORK_QUEUE_SIZE batches, so a case that doesn't wait loses packets.
+constexpr int burst = 16;
+
+double GetSeconds() {
+    return juce::Time::getMillisecondCounterHiRes() * 0.001;
+}
+
+bool IsSet(VoiceCommand::Type type) {
+    return type == VoiceCommand::Type::setFreeze || type == VoiceCommand::Type::setOctave || type == VoiceCommand::Type::setSelect;
+}
+
+// toggles don't carry a value, the custom protocol leaves it at -1 and OSC at 0
+bool IsSame(const VoiceCommand& a, const VoiceCommand& b) {
+    return a.type == b.type && a.index == b.index && (!IsSet(a.type) || a.value == b.value);
+}
+
+char GetLetter(VoiceCommand::Type type) {
+    const char letters[] = { 'f', 'o', 's', 'F', 'O', 'S', 'c' }; // in VoiceCommand::Type's order
+    return letters[static_cast<int>(type)];
+}
+
+const char* GetOscName(VoiceCommand::Type type) {
+    switch (type) {
+        case VoiceCommand::Type::toggleFreeze: case VoiceCommand::Type::setFreeze: return "freeze";
+        case VoiceCommand::Type::toggleOctave: case VoiceCommand::Type::setOctave: return "octave";
+        default: return "select";
+    }
+}
+
+// the i th command of a case, cycling through every type. Indexes start at first, one per command.
+VoiceCommand MakeCommand(int i, int first, bool withCameraHz) {
+    const int types = withCameraHz ? 7 : 6;
+    VoiceCommand command{};
+    command.type = static_cast<VoiceCommand::Type>(i % types);
+    command.index = first + i;
+    command.value = command.type == VoiceCommand::Type::setOctave ? i % 4 : i % 2;
+    return command;
+}
+
+// <letter>[#<id>]-<index>[=<value>];
+std::string Encode(const VoiceCommand& command, int instanceId) {
+    std::string text(1, GetLetter(command.type));
+    if (instanceId > 0) text += INSTANCE_PREFIX + std::to_string(instanceId);
+    text += NUMBER_PREFIX + std::to_string(command.index);
+    if (IsSet(command.type)) text += VALUE_PREFIX + std::to_string(command.value);
+    return text + NUMBER_POSTFIX;
+}
+
+// /hueshift/<id>/<command> index [value]
+void AddOscMessage(HueShift::OscWriter<OSC_MAX_PACKET_BYTES>& writer, const VoiceCommand& command, int instanceId) {
+    const auto address = "/hueshift/" + std::to_string(instanceId) + "/" + GetOscName(command.type);
+    writer.BeginMessage(address.c_str(), IsSet(command.type) ? "ii" : "i");
+    writer.AddInt(command.index);
+    if (IsSet(command.type)) writer.AddInt(command.value);
+    writer.EndMessage();
+}
+
+class Receiver {
+private:
+    HueShift::CommandQueue& queue;
+    HueShift::CommandBatch batch{};
+
+public:
+    std::vector<VoiceCommand> received{};
+
+    Receiver(HueShift::CommandQueue& queue)
+    : queue(queue) {}
+
+    // everything that arrived so far
+    void Drain() {
+        while (queue.Pop(batch)) {
+            for (const auto& command : batch.commands) received.push_back(command);
+        }
+    }
+
+    // until expected commands came in, or the timeout
+    void Wait(size_t expected) {
+        const double deadline = GetSeconds() + timeoutSeconds;
+        while (received.size() < expected && GetSeconds() < deadline) {
+            Drain();
+            juce::Thread::sleep(1);
+        }
+    }
+
+    // the rest, and a little longer for anything that shouldn't come
+    void Finish(size_t expected) {
+        Wait(expected);
+        juce::Thread::sleep(50);
+        Drain();
+    }
+};
+
+bool Check(const char* name, const std::vector<VoiceCommand>& sent, const std::vector<VoiceCommand>& received) {
+    size_t matching = 0;
+    while (matching < sent.size() && matching < received.size() && IsSame(sent[matching], received[matching])) matching++;
+
+    const bool passed = matching == sent.size() && received.size() == sent.size();
+    std::printf("%-34s %5zu sent %5zu received  %s\n", name, sent.size(), received.size(), passed ? "ok" : "FAILED");
+    if (!passed && matching < std::max(sent.size(), received.size())) {
+        const auto describe = [](const std::vector<VoiceCommand>& commands, size_t i) {
+            return i < commands.size() ? std::string(1, GetLetter(commands[i].type)) + " " + std::to_string(commands[i].index) + " " + std::to_string(commands[i].value) : std::string("nothing");
+        };
+        std::printf("    first difference at %zu: sent %s, received %s\n", matching, describe(sent, matching).c_str(), describe(received, matching).c_str());
+    }
+    return passed;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    int amount = 200;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (juce::String(argv[i]) == "--commands") amount = std::max(1, atoi(argv[i + 1]));
+    }
+
+    HueShift::MidiHandler handler;
+    HueShift::CommandQueue queue;
+    HueShift::NetworkReactor reactor;
+    const int instanceId = reactor.Register(queue, handler);
+    Receiver receiver(queue);
+
+    const double bindDeadline = GetSeconds() + timeoutSeconds; // the OSC port is bound by the reactor's thread
+    while ((reactor.GetHardwarePort() <= 0 || reactor.GetOscPort() <= 0) && GetSeconds() < bindDeadline) juce::Thread::sleep(10);
+    if (reactor.GetHardwarePort() <= 0) {
+        std::fprintf(stderr, "the reactor couldn't bind its hardware port\n");
+        return 1;
+    }
+
+    juce::DatagramSocket sender{false};
+    sender.bindToPort(0);
+    const auto send = [&](int port, const void* data, size_t size) {
+        sender.write("127.0.0.1", port, data, static_cast<int>(size));
+    };
+    const int hardwarePort = reactor.GetHardwarePort();
+    bool passed = true;
+
+    // [1] one command per packet, every other one without an id (goes to the lowest instance, which is ours)
+    {
+        std::vector<VoiceCommand> sent;
+        receiver.received.clear();
+        for (int i = 0; i < amount; i++) {
+            const auto command = MakeCommand(i, 0, true);
+            const auto text = Encode(command, i % 2 == 0 ? instanceId : 0);
+            send(hardwarePort, text.data(), text.size());
+            sent.push_back(command);
+            if (i % burst == burst - 1) receiver.Wait(sent.size());
+        }
+        receiver.Finish(sent.size());
+        passed = Check("udp, one per packet", sent, receiver.received) && passed;
+    }
+
+    // [2] up to 10 commands per packet
+    {
+        std::vector<VoiceCommand> sent;
+        receiver.received.clear();
+        for (int start = 0; start < amount; start += 10) {
+            std::string text;
+            for (int i = start; i < std::min(amount, start + 10); i++) {
+                const auto command = MakeCommand(i, 10000, true);
+                text += Encode(command, instanceId);
+                sent.push_back(command);
+            }
+            send(hardwarePort, text.data(), text.size());
+            receiver.Wait(sent.size());
+        }
+        receiver.Finish(sent.size());
+        passed = Check("udp, many per packet", sent, receiver.received) && passed;
+    }
+
+    // [3] with sequence numbers every packet arrives twice, the second has to be dropped. So does one that's late.
+    {
+        std::vector<VoiceCommand> sent;
+        receiver.received.clear();
+        for (int i = 0; i < amount; i++) {
+            const auto command = MakeCommand(i, 20000, false);
+            const auto text = "q-" + std::to_string(i + 1) + ";" + Encode(command, instanceId);
+            send(hardwarePort, text.data(), text.size());
+            send(hardwarePort, text.data(), text.size());
+            sent.push_back(command);
+            if (i % (burst / 2) == burst / 2 - 1) receiver.Wait(sent.size());
+        }
+        const auto stale = "q-1;" + Encode(MakeCommand(0, 29999, false), instanceId);
+        send(hardwarePort, stale.data(), stale.size());
+        receiver.Finish(sent.size() + 1);
+        passed = Check("udp, sequence numbers and doubles", sent, receiver.received) && passed;
+    }
+
+    if (reactor.GetOscPort() <= 0) {
+        std::fprintf(stderr, "OSC port %d is taken, close other HueShift instances\n", OSC_RECEIVE_PORT);
+        return 1;
+    }
+
+    HueShift::OscWriter<OSC_MAX_PACKET_BYTES> writer;
+
+    // [4] one OSC message per packet
+    {
+        std::vector<VoiceCommand> sent;
+        receiver.received.clear();
+        for (int i = 0; i < amount; i++) {
+            const auto command = MakeCommand(i, 30000, false);
+            AddOscMessage(writer, command, instanceId);
+            send(reactor.GetOscPort(), writer.GetData(), writer.GetSize());
+            sent.push_back(command);
+            if (i % burst == burst - 1) receiver.Wait(sent.size());
+        }
+        receiver.Finish(sent.size());
+        passed = Check("osc, one per packet", sent, receiver.received) && passed;
+    }
+
+    // [5] bundles of up to 20 messages
+    {
+        std::vector<VoiceCommand> sent;
+        receiver.received.clear();
+        for (int start = 0; start < amount; start += 20) {
+            writer.BeginBundle();
+            for (int i = start; i < std::min(amount, start + 20); i++) {
+                const auto command = MakeCommand(i, 40000, false);
+                AddOscMessage(writer, command, instanceId);
+                sent.push_back(command);
+            }
+            send(reactor.GetOscPort(), writer.GetData(), writer.GetSize());
+            receiver.Wait(sent.size());
+        }
+        receiver.Finish(sent.size());
+        passed = Check("osc, bundles", sent, receiver.received) && passed;
+    }
+
+    reactor.Unregister(instanceId);
+    std::printf("\n%s\n", passed ? "every command arrived once and in order" : "FAILED");
+    return passed ? 0 : 1;
+}
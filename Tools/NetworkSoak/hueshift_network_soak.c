@@ -0,0 +1,229 @@
+/*
+  ==============================================================================
+
+    Soak test for the network side of a running HueShift. Simulates a lot of controllers on loopback,
+    each one freezing and unfreezing its own voice with set commands, and measures how long it takes
+    until the feedback packets show the change. Every 10th packet is sent twice to exercise duplicate suppression.
+
+    hueshift_network_soak --port <hardware port> [--host 127.0.0.1] [--instance 1] [--clients 32]
+                          [--seconds 30] [--rate 10] [--max-p99 <ms>]
+
+    The port is the one shown in the plugin's top bar. Prints latency percentiles every second.
+    With --max-p99 it exits with 1 if any second's 99th percentile was above that.
+
+  ==============================================================================
+*/
+
+#define _POSIX_C_SOURCE 200809L
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_CLIENTS 128
+#define MAX_VOICES 128
+#define MAX_SAMPLES 65536
+#define CONFIRM_TIMEOUT 1.0
+
+typedef struct {
+    int socket;
+    int voice;
+    uint32_t sequence;
+    int wantFrozen;
+    double sentAt; /* < 0 when nothing is waiting for confirmation */
+    double nextSendAt;
+
+    int hasState;
+    uint16_t feedbackSequence;
+    int numVoices;
+    uint8_t voices[MAX_VOICES];
+} Client;
+
+static double Now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static int CompareDoubles(const void* a, const void* b) {
+    const double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void Send(const Client* client, const char* text) {
+    send(client->socket, text, strlen(text), 0);
+}
+
+/* applies a feedback packet, returns 1 if it asked for a resync because the sequence skipped */
+static int ApplyFeedback(Client* client, const uint8_t* data, int size, int instanceId) {
+    if (size < 10 || data[0] != 'H' || data[1] != 'S' || data[2] != 'D' || data[3] != 1 || data[4] != instanceId) return 0;
+
+    const int full = data[5] & 1;
+    const uint16_t sequence = (uint16_t)((data[6] << 8) | data[7]);
+    const int numVoices = data[8];
+    const int entries = data[9];
+    if (size < 10 + 2 * entries) return 0;
+
+    if (!full) {
+        if (!client->hasState) return 0;
+        if (sequence != (uint16_t)(client->feedbackSequence + 1)) {
+            char request[32];
+            snprintf(request, sizeof(request), "r#%d-0;", instanceId);
+            Send(client, request);
+            client->hasState = 0;
+            return 1;
+        }
+    }
+    else {
+        memset(client->voices, 0, sizeof(client->voices));
+    }
+
+    for (int i = 0; i < entries; i++) {
+        const int voice = data[10 + 2 * i];
+        if (voice < MAX_VOICES) client->voices[voice] = data[11 + 2 * i];
+    }
+
+    client->numVoices = numVoices;
+    client->feedbackSequence = sequence;
+    client->hasState = 1;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    const char* host = "127.0.0.1";
+    int port = -1, instanceId = 1, amountOfClients = 32;
+    double seconds = 30.0, rate = 10.0, maxP99 = -1.0;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--host") == 0) host = argv[i + 1];
+        else if (strcmp(argv[i], "--port") == 0) port = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--instance") == 0) instanceId = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--clients") == 0) amountOfClients = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--seconds") == 0) seconds = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "--rate") == 0) rate = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "--max-p99") == 0) maxP99 = atof(argv[i + 1]);
+    }
+
+    if (port <= 0 || amountOfClients < 1 || rate <= 0.0) {
+        fprintf(stderr, "usage: %s --port <hardware port> [--host ip] [--instance id] [--clients n] [--seconds s] [--rate per second] [--max-p99 ms]\n", argv[0]);
+        return 1;
+    }
+    if (amountOfClients > MAX_CLIENTS) amountOfClients = MAX_CLIENTS;
+
+    struct sockaddr_in target;
+    memset(&target, 0, sizeof(target));
+    target.sin_family = AF_INET;
+    target.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, host, &target.sin_addr) != 1) {
+        fprintf(stderr, "bad host %s\n", host);
+        return 1;
+    }
+
+    static Client clients[MAX_CLIENTS];
+    struct pollfd handles[MAX_CLIENTS];
+    char text[64];
+
+    for (int i = 0; i < amountOfClients; i++) {
+        Client* client = &clients[i];
+        memset(client, 0, sizeof(*client));
+        client->socket = socket(AF_INET, SOCK_DGRAM, 0);
+        if (client->socket < 0 || connect(client->socket, (struct sockaddr*)&target, sizeof(target)) != 0) {
+            perror("socket");
+            return 1;
+        }
+        client->voice = -1;
+        client->sentAt = -1.0;
+
+        snprintf(text, sizeof(text), "q-0;r#%d-0;", instanceId);
+        Send(client, text);
+
+        handles[i].fd = client->socket;
+        handles[i].events = POLLIN;
+    }
+
+    static double samples[MAX_SAMPLES];
+    int amountOfSamples = 0, failed = 0;
+    long sent = 0, duplicates = 0, resyncs = 0, timeouts = 0;
+
+    const double start = Now();
+    double nextReport = start + 1.0;
+
+    while (Now() - start < seconds) {
+        const double now = Now();
+
+        for (int i = 0; i < amountOfClients; i++) {
+            Client* client = &clients[i];
+            if (!client->hasState || client->numVoices == 0) continue;
+
+            /* every client owns one voice, more clients than voices share */
+            if (client->voice < 0) {
+                client->voice = i % client->numVoices;
+                client->nextSendAt = now + (double)rand() / RAND_MAX / rate;
+            }
+
+            if (client->sentAt >= 0.0 && now - client->sentAt > CONFIRM_TIMEOUT) {
+                timeouts++;
+                client->sentAt = -1.0;
+            }
+            if (client->sentAt >= 0.0 || now < client->nextSendAt) continue;
+
+            client->wantFrozen = !((client->voices[client->voice] >> 1) & 1);
+            snprintf(text, sizeof(text), "q-%u;F#%d-%d=%d;", ++client->sequence, instanceId, client->voice, client->wantFrozen);
+            Send(client, text);
+            if (client->sequence % 10 == 0) {
+                Send(client, text);
+                duplicates++;
+            }
+
+            sent++;
+            client->sentAt = now;
+            client->nextSendAt = now + 1.0 / rate;
+        }
+
+        if (poll(handles, (nfds_t)amountOfClients, 1) > 0) {
+            for (int i = 0; i < amountOfClients; i++) {
+                if (!(handles[i].revents & POLLIN)) continue;
+
+                Client* client = &clients[i];
+                uint8_t packet[512];
+                int size;
+                while ((size = (int)recv(client->socket, packet, sizeof(packet), MSG_DONTWAIT)) > 0) {
+                    resyncs += ApplyFeedback(client, packet, size, instanceId);
+
+                    if (client->sentAt >= 0.0 && client->voice >= 0 && ((client->voices[client->voice] >> 1) & 1) == client->wantFrozen) {
+                        if (amountOfSamples < MAX_SAMPLES) samples[amountOfSamples++] = (Now() - client->sentAt) * 1000.0;
+                        client->sentAt = -1.0;
+                    }
+                }
+            }
+        }
+
+        if (Now() >= nextReport) {
+            nextReport += 1.0;
+            if (amountOfSamples == 0) {
+                printf("%4.0fs  no confirmations yet (sent %ld, timeouts %ld) - is audio running and the grid filled?\n", Now() - start, sent, timeouts);
+                continue;
+            }
+
+            qsort(samples, (size_t)amountOfSamples, sizeof(double), CompareDoubles);
+            const double p50 = samples[amountOfSamples / 2];
+            const double p99 = samples[(amountOfSamples * 99) / 100];
+            const double worst = samples[amountOfSamples - 1];
+            printf("%4.0fs  %5d confirmed  p50 %6.1f ms  p99 %6.1f ms  max %6.1f ms  sent %ld  dup %ld  resyncs %ld  timeouts %ld\n",
+                Now() - start, amountOfSamples, p50, p99, worst, sent, duplicates, resyncs, timeouts);
+
+            if (maxP99 > 0.0 && p99 > maxP99) failed = 1;
+            amountOfSamples = 0;
+        }
+    }
+
+    for (int i = 0; i < amountOfClients; i++) close(clients[i].socket);
+    if (failed) fprintf(stderr, "p99 went over %.1f ms\n", maxP99);
+    return failed || timeouts > sent / 100 ? 1 : 0;
+}
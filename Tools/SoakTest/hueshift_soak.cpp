@@ -0,0 +1,311 @@
+/*
+  ==============================================================================
+
+    Long running soak and drift test. Builds a real HueShiftProcessor and drives it as fast as it goes through
+    simulated hours: blocks of audio, synthetic camera frames, MIDI input, UDP commands, preset recalls and grid changes.
+
+    hueshift_soak [--hours 26] [--sample-rate 48000] [--block 512] [--report-hours 1]
+                  [--max-p99-us 2000] [--max-growth-mb 16]
+
+    Voice 0 is enabled and frozen, so its pulses have to stay on one grid from the first to the last block.
+    The default 26 hours pass 2^32 samples at 48 kHz, where a 32 bit sample counter would wrap and make the pulses jump.
+
+    Every simulated report interval it prints processBlock's p50/p99/p99.9/max, the memory in use and the pulse timing.
+    Exits with 1 if a pulse left the grid or went missing, the processor's sample count disagrees with ours,
+    the memory grew more than --max-growth-mb after the first interval, or an interval's p99 went over --max-p99-us.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <vector>
+#include "PluginProcessor.h"
+
+namespace {
+
+struct Options {
+    double hours = 26.0;
+    double sampleRate = 48000.0;
+    int blockSize = 512;
+    double reportHours = 1.0;
+    double maxP99Microseconds = 2000.0;
+    double maxGrowthMegabytes = 16.0;
+};
+
+double ToMegabytes(size_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+// what the process has in memory right now
+size_t GetResidentBytes() {
+    if (FILE* file = std::fopen("/proc/self/statm", "r")) {
+        long pages = 0, resident = 0;
+        const bool read = std::fscanf(file, "%ld %ld", &pages, &resident) == 2;
+        std::fclose(file);
+        if (read) return static_cast<size_t>(resident) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    }
+
+    // no procfs (mac), the high-water mark is the best there is
+    struct rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+   #if JUCE_MAC
+    return static_cast<size_t>(usage.ru_maxrss);
+   #else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+   #endif
+}
+
+size_t GetPeakResidentBytes() {
+    struct rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+   #if JUCE_MAC
+    return static_cast<size_t>(usage.ru_maxrss);
+   #else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+   #endif
+}
+
+float GetPercentile(std::vector<float>& values, double fraction) {
+    if (values.empty()) return 0.f;
+    const auto index = std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+    std::nth_element(values.begin(), values.begin() + static_cast<long>(index), values.end());
+    return values[index];
+}
+
+// voice 0 never changes frequency, the handler puts its pulses on multiples of one period counted from prepareToPlay.
+// The scheduler may move one later by its jitter tolerance, never earlier.
+struct PulseTracker {
+    std::vector<uint64_t> firstPulses{};
+    uint64_t period = 0;
+    uint64_t lastPulse = 0;
+    uint64_t pulses = 0;
+    uint64_t missed = 0;
+    uint64_t worstLateness = 0;
+
+    void Add(uint64_t time) {
+        pulses++;
+        if (period == 0) {
+            firstPulses.push_back(time);
+            if (firstPulses.size() > 16) period = GetMostCommonInterval();
+            lastPulse = time;
+            return;
+        }
+
+        worstLateness = std::max(worstLateness, time % period);
+        const uint64_t gap = time - lastPulse;
+        if (gap > period + period / 2) missed += (gap + period / 2) / period - 1;
+        lastPulse = time;
+    }
+
+    uint64_t GetMostCommonInterval() const {
+        std::map<uint64_t, int> counts;
+        for (size_t i = 1; i < firstPulses.size(); i++) counts[firstPulses[i] - firstPulses[i - 1]]++;
+        return std::max_element(counts.begin(), counts.end(), [](const auto& a, const auto& b) { return a.second < b.second; })->first;
+    }
+};
+
+// a grid of slowly turning colours, a different hue per cell
+void RenderFrame(juce::Image& image, double seconds, int columns, int rows) {
+    const juce::Image::BitmapData bitmap(image, juce::Image::BitmapData::writeOnly);
+    for (int y = 0; y < bitmap.height; y++) {
+        for (int x = 0; x < bitmap.width; x++) {
+            const int cell = (y * rows / bitmap.height) * columns + x * columns / bitmap.width;
+            const float hue = static_cast<float>(std::fmod(cell * 0.13 + seconds * 0.002, 1.0));
+            bitmap.setPixelColour(x, y, juce::Colour::fromHSV(hue, 0.8f, 0.8f, 1.f));
+        }
+    }
+}
+
+HueShift::PluginState GetStartState() {
+    HueShift::PluginState state{};
+    state.voices.numVoices = state.grid.GetAmountOfCells();
+    for (size_t i = 0; i < state.voices.numVoices; i++) state.voices.enabled[i] = true;
+    state.voices.frozen[0] = true;
+    return state;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    Options options{};
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const juce::String option(argv[i]);
+        const double value = juce::String(argv[i + 1]).getDoubleValue();
+        if (option == "--hours") options.hours = value;
+        else if (option == "--sample-rate") options.sampleRate = value;
+        else if (option == "--block") options.blockSize = static_cast<int>(value);
+        else if (option == "--report-hours") options.reportHours = value;
+        else if (option == "--max-p99-us") options.maxP99Microseconds = value;
+        else if (option == "--max-growth-mb") options.maxGrowthMegabytes = value;
+    }
+    if (options.hours <= 0.0 || options.sampleRate < 8000.0 || options.blockSize < 16 || options.reportHours <= 0.0) {
+        std::fprintf(stderr, "usage: %s [--hours h] [--sample-rate hz] [--block samples] [--report-hours h] [--max-p99-us us] [--max-growth-mb mb]\n", argv[0]);
+        return 1;
+    }
+
+    const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    auto processor = std::make_unique<HueShiftProcessor>();
+
+    // every voice on, voice 0 frozen
+    {
+        juce::MemoryOutputStream stream;
+        stream.writeInt(STATE_MAGIC);
+        stream.writeInt(STATE_VERSION);
+        GetStartState().Write(stream);
+        processor->setStateInformation(stream.getData(), static_cast<int>(stream.getDataSize()));
+    }
+
+    processor->prepareToPlay(options.sampleRate, options.blockSize);
+
+    const auto totalSamples = static_cast<uint64_t>(options.hours * 3600.0 * options.sampleRate);
+    const auto reportSamples = static_cast<uint64_t>(options.reportHours * 3600.0 * options.sampleRate);
+    const auto jitterSamples = static_cast<uint64_t>(MIDI_OUTPUT_JITTER_MS * 0.001 * options.sampleRate);
+    const auto frameSamples = static_cast<uint64_t>(options.sampleRate / 30.0);
+    const auto midiSamples = static_cast<uint64_t>(options.sampleRate * 2.0);
+    const auto networkSamples = static_cast<uint64_t>(options.sampleRate * 0.5);
+    const auto presetSamples = static_cast<uint64_t>(options.sampleRate * 3600.0);
+    const auto gridSamples = static_cast<uint64_t>(options.sampleRate * 3.0 * 3600.0);
+
+    juce::AudioBuffer<float> audio(2, options.blockSize);
+    juce::MidiBuffer midi;
+    juce::Image frame(juce::Image::ARGB, 128, 72, true);
+    juce::DatagramSocket socket(false);
+    juce::Random random(42);
+
+    PulseTracker pulses{};
+    std::vector<float> blockMicroseconds;
+    blockMicroseconds.reserve(static_cast<size_t>(reportSamples / static_cast<uint64_t>(options.blockSize)) + 1);
+    size_t baselineBytes = 0, worstGrowthBytes = 0;
+    bool failed = false, wrapReported = false;
+    uint32_t networkSequence = 0;
+    double lastFrameSubmitSeconds = 0.0;
+
+    uint64_t now = 0, nextFrame = 0, nextMidi = midiSamples, nextNetwork = networkSamples;
+    uint64_t nextPreset = presetSamples, nextGrid = gridSamples, nextReport = reportSamples;
+    bool bigGrid = false;
+
+    std::printf("soak: %.1f simulated hours at %.0f Hz, %d sample blocks, network port %d\n\n",
+        options.hours, options.sampleRate, options.blockSize, processor->network->GetHardwarePort());
+
+    while (now < totalSamples) {
+        const auto settings = processor->GetGridSettings();
+        const int amountOfVoices = static_cast<int>(settings.GetAmountOfCells());
+        midi.clear();
+
+        // the camera. The analysis runs on wall clock time, more frames than it can take would only cost time here.
+        const double wallSeconds = juce::Time::getMillisecondCounterHiRes() * 0.001;
+        if (now >= nextFrame && wallSeconds - lastFrameSubmitSeconds > 0.005) {
+            RenderFrame(frame, now / options.sampleRate, static_cast<int>(settings.widthDivision), static_cast<int>(settings.heightDivision));
+            processor->cameraFeed.SubmitFrame(frame);
+            lastFrameSubmitSeconds = wallSeconds;
+            nextFrame = now + frameSamples;
+        }
+
+        // control traffic, never for voice 0
+        if (now >= nextMidi && amountOfVoices > 1) {
+            const int voice = 1 + random.nextInt(amountOfVoices - 1);
+            const auto velocity = static_cast<juce::uint8>(random.nextInt(4) == 0 ? 0 : 100); // 0 toggles the octave
+            midi.addEvent(juce::MidiMessage::noteOn(1, C1 + voice, velocity), random.nextInt(options.blockSize));
+            nextMidi = now + midiSamples;
+        }
+        if (now >= nextNetwork && amountOfVoices > 1) {
+            const auto text = "q-" + juce::String(++networkSequence) + ";F#" + juce::String(processor->GetInstanceId())
+                + "-" + juce::String(1 + random.nextInt(amountOfVoices - 1)) + "=" + juce::String(random.nextInt(2)) + ";";
+            socket.write("127.0.0.1", processor->network->GetHardwarePort(), text.toRawUTF8(), static_cast<int>(text.getNumBytesAsUTF8()));
+            nextNetwork = now + networkSamples;
+        }
+        if (now >= nextPreset) {
+            processor->StorePreset("soak");
+            processor->RecallPreset("soak");
+            nextPreset = now + presetSamples;
+        }
+        if (now >= nextGrid) {
+            auto grid = settings;
+            bigGrid = !bigGrid;
+            grid.widthDivision = bigGrid ? 4 : 5;
+            grid.heightDivision = bigGrid ? 3 : 2;
+            processor->SetGridSettings(grid);
+            nextGrid = now + gridSamples;
+        }
+
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+        processor->processBlock(audio, midi);
+        const auto ticks = juce::Time::getHighResolutionTicks() - startTicks;
+        blockMicroseconds.push_back(static_cast<float>(juce::Time::highResolutionTicksToSeconds(ticks) * 1e6));
+
+        for (const auto metadata : midi) {
+            const auto message = metadata.getMessage();
+            if (message.isNoteOn() && message.getNoteNumber() == C1) pulses.Add(now + static_cast<uint64_t>(metadata.samplePosition));
+        }
+
+        now += static_cast<uint64_t>(options.blockSize);
+
+        if (!wrapReported && now > 0xffffffffull) {
+            std::printf("passed 2^32 samples at %.2f hours\n", now / options.sampleRate / 3600.0);
+            wrapReported = true;
+        }
+
+        if (now >= nextReport || now >= totalSamples) {
+            const auto bytes = GetResidentBytes();
+            if (baselineBytes == 0) baselineBytes = bytes; // the first interval fills every buffer there is
+            worstGrowthBytes = std::max(worstGrowthBytes, bytes > baselineBytes ? bytes - baselineBytes : 0);
+
+            const float p99 = GetPercentile(blockMicroseconds, 0.99);
+            std::printf("%7.2f h  block us p50 %6.1f p99 %6.1f p99.9 %7.1f max %8.1f  rss %7.1f MB (peak %7.1f)  pulses %llu late <= %llu missed %llu\n",
+                now / options.sampleRate / 3600.0,
+                GetPercentile(blockMicroseconds, 0.5), p99, GetPercentile(blockMicroseconds, 0.999), GetPercentile(blockMicroseconds, 1.0),
+                ToMegabytes(bytes), ToMegabytes(GetPeakResidentBytes()),
+                static_cast<unsigned long long>(pulses.pulses), static_cast<unsigned long long>(pulses.worstLateness),
+                static_cast<unsigned long long>(pulses.missed));
+            std::fflush(stdout);
+
+            if (p99 > options.maxP99Microseconds) {
+                std::printf("  FAIL p99 over %.0f us\n", options.maxP99Microseconds);
+                failed = true;
+            }
+            blockMicroseconds.clear();
+            nextReport = now + reportSamples;
+        }
+    }
+
+    const auto processed = processor->telemetry.samplesProcessed.load();
+    const auto& telemetry = processor->telemetry;
+    std::printf("\nframes analysed %llu, midi coalesced %llu dropped %llu deferred %llu spread %llu\n",
+        static_cast<unsigned long long>(telemetry.framesAnalysed.load()), static_cast<unsigned long long>(telemetry.midiCoalesced.load()),
+        static_cast<unsigned long long>(telemetry.midiDropped.load()), static_cast<unsigned long long>(telemetry.midiDeferred.load()),
+        static_cast<unsigned long long>(telemetry.midiSpread.load()));
+
+    if (pulses.period == 0) {
+        std::printf("FAIL voice 0 never pulsed steadily, did the analysis run?\n");
+        failed = true;
+    }
+    if (pulses.worstLateness > jitterSamples) {
+        std::printf("FAIL a pulse was %llu samples off its grid, more than the %llu the scheduler may add\n",
+            static_cast<unsigned long long>(pulses.worstLateness), static_cast<unsigned long long>(jitterSamples));
+        failed = true;
+    }
+    if (pulses.missed > 0) {
+        std::printf("FAIL %llu pulses went missing\n", static_cast<unsigned long long>(pulses.missed));
+        failed = true;
+    }
+    if (processed != now) {
+        std::printf("FAIL the processor counted %llu samples, we sent %llu\n", static_cast<unsigned long long>(processed), static_cast<unsigned long long>(now));
+        failed = true;
+    }
+    if (ToMegabytes(worstGrowthBytes) > options.maxGrowthMegabytes) {
+        std::printf("FAIL memory grew %.1f MB after the first interval\n", ToMegabytes(worstGrowthBytes));
+        failed = true;
+    }
+
+    processor->releaseResources();
+    processor.reset();
+
+    std::printf(failed ? "soak failed\n" : "soak passed\n");
+    return failed ? 1 : 0;
+}